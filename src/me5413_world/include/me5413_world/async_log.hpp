@@ -0,0 +1,217 @@
+/** async_log.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Asynchronous logging for the control loop: call sites only push a small binary record to a lock-free queue,
+ * formatting, deduplication and output happen on a background thread
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace me5413_world
+{
+
+enum class LogLevel
+{
+  Debug,
+  Info,
+  Warn,
+  Error
+};
+
+// Argument of a record, strings are kept by pointer and must outlive the record (e.g. literals)
+struct LogArg
+{
+  enum Type { INT, DOUBLE, STRING };
+  Type type;
+  union
+  {
+    long long i;
+    double d;
+    const char* s;
+  };
+};
+
+inline LogArg makeLogArg(const long long value) { LogArg arg; arg.type = LogArg::INT; arg.i = value; return arg; };
+inline LogArg makeLogArg(const int value) { return makeLogArg(static_cast<long long>(value)); };
+inline LogArg makeLogArg(const long value) { return makeLogArg(static_cast<long long>(value)); };
+inline LogArg makeLogArg(const unsigned value) { return makeLogArg(static_cast<long long>(value)); };
+inline LogArg makeLogArg(const unsigned long value) { return makeLogArg(static_cast<long long>(value)); };
+inline LogArg makeLogArg(const bool value) { return makeLogArg(static_cast<long long>(value)); };
+inline LogArg makeLogArg(const double value) { LogArg arg; arg.type = LogArg::DOUBLE; arg.d = value; return arg; };
+inline LogArg makeLogArg(const float value) { return makeLogArg(static_cast<double>(value)); };
+inline LogArg makeLogArg(const char* value) { LogArg arg; arg.type = LogArg::STRING; arg.s = value; return arg; };
+// The buffer of a std::string may be gone by the time the record is formatted
+LogArg makeLogArg(const std::string& value) = delete;
+
+const int kMaxLogArgs = 6;
+
+// One call site, created once by the logging macros
+class LogSite
+{
+ public:
+  // min_period [s] between two records of this site, 0 for no rate limit
+  LogSite(const LogLevel level, const double min_period, const char* file, const int line);
+
+  // Whether a record at now_ns passes the rate limit, counts it as suppressed otherwise
+  bool admit(const int64_t now_ns);
+  // Records suppressed since the last admitted one, resets the count
+  uint64_t takeSuppressed() { return num_suppressed_.exchange(0, std::memory_order_relaxed); };
+
+  LogLevel level() const { return level_; };
+  const char* file() const { return file_; };
+  int line() const { return line_; };
+
+ private:
+  const LogLevel level_;
+  const int64_t min_period_ns_;
+  const char* file_;
+  const int line_;
+  std::atomic<int64_t> last_ns_;
+  std::atomic<uint64_t> num_suppressed_;
+};
+
+struct LogRecord
+{
+  const LogSite* site;
+  const char* format;  // printf-style, must be a literal
+  int64_t stamp_ns;    // steady clock
+  uint64_t num_suppressed;
+  int num_args;
+  LogArg args[kMaxLogArgs];
+};
+
+// Formats a record with its printf-style format, the length modifiers of the format are ignored
+std::string formatLogRecord(const LogRecord& record);
+
+struct LoggerStats
+{
+  uint64_t enqueued;      // records pushed to the queue
+  uint64_t dropped;       // records lost because the queue was full
+  uint64_t suppressed;    // records rejected by the rate limit of their site
+  uint64_t deduplicated;  // records folded into a repeat count
+  uint64_t written;       // lines passed to the sink
+};
+
+typedef std::function<void(const LogLevel, const std::string&)> LogSink;
+
+class AsyncLogger
+{
+ public:
+  // capacity is rounded up to a power of 2. Identical consecutive records of a site within dedup_window [s]
+  // are written once, followed by a repeat count
+  explicit AsyncLogger(const int capacity = 1024, const double dedup_window = 10.0);
+  ~AsyncLogger();
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  // Logger shared by the whole process, writes to stderr until a sink is set
+  static AsyncLogger& global();
+
+  // Never blocks: returns false if the record was rate limited or the queue is full
+  template <typename... Args>
+  bool log(LogSite& site, const char* format, const Args&... args);
+
+  // The sink is only ever called from the background thread
+  void setSink(const LogSink& sink);
+  // Waits until every record enqueued so far has been handled
+  void flush();
+  LoggerStats stats() const;
+
+ private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    LogRecord record;
+  };
+
+  bool push(const LogRecord& record);
+  bool pop(LogRecord& record);
+  void drainLoop();
+  void handle(const LogRecord& record);
+  void flushRepeats();
+  void write(const LogLevel level, const std::string& line);
+
+  // Bounded multi-producer queue, consumed by the background thread only
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  std::atomic<size_t> enqueue_pos_;
+  size_t dequeue_pos_;
+
+  const int64_t dedup_window_ns_;
+  bool has_last_;
+  LogRecord last_;
+  uint64_t num_repeats_;
+  int64_t last_written_ns_;
+
+  std::mutex sink_mutex_;
+  LogSink sink_;
+
+  std::atomic<uint64_t> num_enqueued_;
+  std::atomic<uint64_t> num_dropped_;
+  std::atomic<uint64_t> num_suppressed_;
+  std::atomic<uint64_t> num_deduplicated_;
+  std::atomic<uint64_t> num_written_;
+  std::atomic<uint64_t> num_handled_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+// Nanoseconds on the steady clock
+int64_t logClockNow();
+
+template <typename... Args>
+bool AsyncLogger::log(LogSite& site, const char* format, const Args&... args)
+{
+  static_assert(sizeof...(Args) <= kMaxLogArgs, "Too many log arguments");
+
+  const int64_t now = logClockNow();
+  if (!site.admit(now))
+  {
+    this->num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  LogRecord record;
+  record.site = &site;
+  record.format = format;
+  record.stamp_ns = now;
+  record.num_suppressed = site.takeSuppressed();
+  record.num_args = sizeof...(Args);
+  const LogArg converted[] = {makeLogArg(args)..., LogArg()};
+  for (int i = 0; i < record.num_args; i++)
+  {
+    record.args[i] = converted[i];
+  }
+
+  return push(record);
+};
+
+} // namespace me5413_world
+
+// Usage mirrors ROS_INFO/ROS_WARN/ROS_WARN_THROTTLE, with a literal printf-style format
+#define ME5413_LOG_THROTTLE(level, period, ...) \
+  do \
+  { \
+    static ::me5413_world::LogSite me5413_log_site(level, period, __FILE__, __LINE__); \
+    ::me5413_world::AsyncLogger::global().log(me5413_log_site, __VA_ARGS__); \
+  } while (0)
+
+#define ME5413_LOG_DEBUG(...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Debug, 0.0, __VA_ARGS__)
+#define ME5413_LOG_INFO(...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Info, 0.0, __VA_ARGS__)
+#define ME5413_LOG_WARN(...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Warn, 0.0, __VA_ARGS__)
+#define ME5413_LOG_ERROR(...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Error, 0.0, __VA_ARGS__)
+#define ME5413_LOG_INFO_THROTTLE(period, ...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Info, period, __VA_ARGS__)
+#define ME5413_LOG_WARN_THROTTLE(period, ...) ME5413_LOG_THROTTLE(::me5413_world::LogLevel::Warn, period, __VA_ARGS__)
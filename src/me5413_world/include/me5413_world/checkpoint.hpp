@@ -0,0 +1,138 @@
+/** checkpoint.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Lightweight checkpoint of a plain struct in a memory-mapped file, for warm restarts
+ */
+
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace me5413_world
+{
+
+template <typename T>
+class Checkpoint
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Checkpoint data must be trivially copyable");
+
+ public:
+  Checkpoint() : fd_(-1), record_(nullptr) {};
+  ~Checkpoint() { close(); };
+  Checkpoint(const Checkpoint&) = delete;
+  Checkpoint& operator=(const Checkpoint&) = delete;
+
+  // Maps the file, creating it if needed, returns false on failure
+  bool open(const std::string& file_path);
+  void close();
+  bool isOpen() const { return record_ != nullptr; };
+
+  // Reads the last complete checkpoint, returns false if there is none
+  bool load(T& data) const;
+  // Writes a checkpoint, a crash while writing leaves it marked as incomplete
+  void save(const T& data);
+
+ private:
+  struct Record
+  {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t sequence;  // odd while a write is in progress
+    T data;
+  };
+  static constexpr uint32_t kMagic = 0x4d453534;  // "ME54"
+
+  int fd_;
+  Record* record_;
+};
+
+template <typename T>
+bool Checkpoint<T>::open(const std::string& file_path)
+{
+  close();
+
+  this->fd_ = ::open(file_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (this->fd_ < 0)
+  {
+    return false;
+  }
+  if (::ftruncate(this->fd_, sizeof(Record)) != 0)
+  {
+    close();
+    return false;
+  }
+
+  void* addr = ::mmap(nullptr, sizeof(Record), PROT_READ | PROT_WRITE, MAP_SHARED, this->fd_, 0);
+  if (addr == MAP_FAILED)
+  {
+    close();
+    return false;
+  }
+  this->record_ = static_cast<Record*>(addr);
+
+  return true;
+}
+
+template <typename T>
+void Checkpoint<T>::close()
+{
+  if (this->record_ != nullptr)
+  {
+    ::munmap(this->record_, sizeof(Record));
+    this->record_ = nullptr;
+  }
+  if (this->fd_ >= 0)
+  {
+    ::close(this->fd_);
+    this->fd_ = -1;
+  }
+}
+
+template <typename T>
+bool Checkpoint<T>::load(T& data) const
+{
+  if (this->record_ == nullptr || this->record_->magic != kMagic || this->record_->size != sizeof(T))
+  {
+    return false;
+  }
+
+  const uint64_t sequence = this->record_->sequence;
+  if (sequence == 0 || sequence % 2 != 0)
+  {
+    return false;
+  }
+  std::memcpy(&data, &this->record_->data, sizeof(T));
+
+  return true;
+}
+
+template <typename T>
+void Checkpoint<T>::save(const T& data)
+{
+  if (this->record_ == nullptr)
+  {
+    return;
+  }
+
+  // The page cache outlives the process, so no msync is needed to survive a node crash
+  this->record_->magic = kMagic;
+  this->record_->size = sizeof(T);
+  this->record_->sequence |= 1;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  std::memcpy(&this->record_->data, &data, sizeof(T));
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  this->record_->sequence++;
+}
+
+} // namespace me5413_world
@@ -0,0 +1,86 @@
+/** experiment.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Closed-loop tracking episodes without ROS or Gazebo, and the campaigns of episodes run by experiment_runner
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace me5413_world
+{
+
+enum class ControllerType
+{
+  PurePursuit,  // PurePursuitPipeline
+  Heading       // HeadingPipeline
+};
+
+// Controller parameters and scenario of one episode, written as a line of key=value pairs
+struct EpisodeSpec
+{
+  // Controller
+  ControllerType controller = ControllerType::PurePursuit;
+  double speed_target = 0.5;        // [m/s]
+  double Kp = 0.5;
+  double Ki = 0.2;
+  double Kd = 0.2;
+  double lookahead_gain = 0.5;      // [s], pure pursuit
+  double lookahead_distance = 1.0;  // [m], heading steering
+  double robot_length = 0.5;        // [m]
+
+  // Scenario
+  double track_A = 8.0;             // [m]
+  double track_B = 8.0;             // [m]
+  int track_wp_num = 500;
+  double duration = 120.0;          // [s] simulated
+  double dt = 0.1;                  // [s] control period
+  double initial_offset = 0.0;      // [m] to the left of the first waypoint
+  double initial_heading = 0.0;     // [deg] wrt the first waypoint
+  double actuator_lag = 0.2;        // [s] time constant of the velocity response
+  double position_noise = 0.0;      // [m] standard deviation of the measured position
+  double heading_noise = 0.0;       // [deg] standard deviation of the measured heading
+  uint64_t seed = 0;
+};
+
+struct EpisodeResult
+{
+  double rms_position_error = 0.0;  // [m] wrt the goal waypoint, as in path_publisher_node
+  double rms_heading_error = 0.0;   // [deg]
+  double rms_speed_error = 0.0;     // [m/s]
+  double max_position_error = 0.0;  // [m]
+  double progress = 0.0;            // fraction of the track reached
+  double lap_time = -1.0;           // [s] to reach the last waypoint, -1 if it was not reached
+  int num_steps = 0;
+  double wall_time = 0.0;           // [s] spent running the episode
+};
+
+// Canonical line of an episode, every key in a fixed order, so that equal specs give equal lines
+std::string formatEpisodeSpec(const EpisodeSpec& spec);
+// Keys missing from the line keep their value in spec. Returns false and sets error on an unknown key or a bad value
+bool parseEpisodeSpec(const std::string& line, EpisodeSpec& spec, std::string& error);
+std::string formatEpisodeResult(const EpisodeResult& result);
+bool parseEpisodeResult(const std::string& line, EpisodeResult& result, std::string& error);
+
+// Column names and values for a CSV row, in the order of the formatted lines
+std::vector<std::string> episodeSpecColumns();
+std::vector<std::string> episodeResultColumns();
+std::vector<std::string> episodeSpecValues(const EpisodeSpec& spec);
+std::vector<std::string> episodeResultValues(const EpisodeResult& result);
+
+// Reads a campaign: one line of key=value pairs per episode, '#' starts a comment. A comma-separated list of
+// values expands into one episode per value, and several lists on a line into their cartesian product, e.g.
+//   controller=pure_pursuit lookahead_gain=0.3,0.5,0.8 seed=0,1,2
+bool loadCampaign(const std::string& file_path, std::vector<EpisodeSpec>& specs, std::string& error);
+
+// Simulates the robot as a unicycle whose velocities follow the commands with a first-order lag, and runs the
+// tracking pipeline of the controller on its measured pose every dt. Deterministic for a given spec on every platform
+EpisodeResult runEpisode(const EpisodeSpec& spec);
+
+} // namespace me5413_world
@@ -0,0 +1,261 @@
+/** fixed_point.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Signed fixed-point scalar (Q16.16 by default) with the math functions used by the kernels,
+ * integer-only at runtime so the same kernels can run on a microcontroller without an FPU
+ */
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <cstdint>
+
+namespace me5413_world
+{
+
+template <int FRAC_BITS>
+class FixedPoint
+{
+  static_assert(FRAC_BITS > 0 && FRAC_BITS < 30, "FixedPoint needs 1 to 29 fractional bits");
+
+ public:
+  constexpr FixedPoint() : raw_(0) {};
+  // Conversions from floating point literals are folded at compile time
+  explicit constexpr FixedPoint(const double x) : raw_(int32_t(x * (int64_t(1) << FRAC_BITS) + (x >= 0? 0.5 : -0.5))) {};
+  explicit constexpr FixedPoint(const int x) : raw_(int32_t(x) * (int32_t(1) << FRAC_BITS)) {};
+
+  static constexpr FixedPoint fromRaw(const int32_t raw) { return FixedPoint(raw, RawTag()); };
+  constexpr int32_t raw() const { return raw_; };
+  explicit constexpr operator double() const { return double(raw_) / (int64_t(1) << FRAC_BITS); };
+  explicit constexpr operator float() const { return float(raw_) / (int64_t(1) << FRAC_BITS); };
+
+  constexpr FixedPoint operator-() const { return fromRaw(-raw_); };
+  constexpr FixedPoint operator+(const FixedPoint b) const { return fromRaw(raw_ + b.raw_); };
+  constexpr FixedPoint operator-(const FixedPoint b) const { return fromRaw(raw_ - b.raw_); };
+  // Products and quotients go through 64 bits and are rounded to the nearest LSB
+  constexpr FixedPoint operator*(const FixedPoint b) const
+  {
+    return fromRaw(int32_t((int64_t(raw_) * b.raw_ + (int64_t(1) << (FRAC_BITS - 1))) >> FRAC_BITS));
+  };
+  constexpr FixedPoint operator/(const FixedPoint b) const
+  {
+    return fromRaw(int32_t((int64_t(raw_) * (int64_t(1) << FRAC_BITS)) / b.raw_));
+  };
+
+  FixedPoint& operator+=(const FixedPoint b) { return *this = *this + b; };
+  FixedPoint& operator-=(const FixedPoint b) { return *this = *this - b; };
+  FixedPoint& operator*=(const FixedPoint b) { return *this = *this * b; };
+  FixedPoint& operator/=(const FixedPoint b) { return *this = *this / b; };
+
+  constexpr bool operator==(const FixedPoint b) const { return raw_ == b.raw_; };
+  constexpr bool operator!=(const FixedPoint b) const { return raw_ != b.raw_; };
+  constexpr bool operator<(const FixedPoint b) const { return raw_ < b.raw_; };
+  constexpr bool operator>(const FixedPoint b) const { return raw_ > b.raw_; };
+  constexpr bool operator<=(const FixedPoint b) const { return raw_ <= b.raw_; };
+  constexpr bool operator>=(const FixedPoint b) const { return raw_ >= b.raw_; };
+
+ private:
+  struct RawTag {};
+  constexpr FixedPoint(const int32_t raw, RawTag) : raw_(raw) {};
+
+  int32_t raw_;
+};
+
+// 16 integer bits cover +-32768 [m] or [deg], 16 fractional bits resolve 1.5e-5
+typedef FixedPoint<16> Q16_16;
+
+// Integer square root, floor(sqrt(x))
+inline uint64_t isqrt(uint64_t x)
+{
+  uint64_t result = 0;
+  uint64_t bit = uint64_t(1) << 62;
+  while (bit > x)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (x >= result + bit)
+    {
+      x -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+// Math functions found through argument-dependent lookup, next to the std:: ones for floating point
+
+template <int F>
+inline FixedPoint<F> fabs(const FixedPoint<F> x) { return x.raw() < 0? -x : x; }
+
+template <int F>
+inline bool isnan(const FixedPoint<F>) { return false; }
+
+template <int F>
+inline bool isinf(const FixedPoint<F>) { return false; }
+
+template <int F>
+inline FixedPoint<F> sqrt(const FixedPoint<F> x)
+{
+  return x.raw() <= 0? FixedPoint<F>() : FixedPoint<F>::fromRaw(int32_t(isqrt(uint64_t(x.raw()) << F)));
+}
+
+// Exact to one LSB. The sum of the squares fits in 64 bits, but the result does not always fit back in 32
+// (up to sqrt(2) times the largest value), so it saturates at the largest value
+template <int F>
+inline FixedPoint<F> hypot(const FixedPoint<F> x, const FixedPoint<F> y)
+{
+  const int64_t x_raw = x.raw();
+  const int64_t y_raw = y.raw();
+  const uint64_t result = isqrt(uint64_t(x_raw * x_raw) + uint64_t(y_raw * y_raw));
+  return FixedPoint<F>::fromRaw(result > uint64_t(INT32_MAX)? INT32_MAX : int32_t(result));
+}
+
+// Taylor series up to x^11 on [-pi/2, pi/2], evaluated with 30 fractional bits so that
+// the small coefficients keep their precision, the truncation error is below one LSB of Q16.16
+template <int F>
+inline FixedPoint<F> sin(const FixedPoint<F> angle)
+{
+  typedef FixedPoint<F> T;
+  const T pi(M_PI);
+  const T half_pi(M_PI / 2);
+
+  // Reduce to [-pi, pi], then fold onto [-pi/2, pi/2]
+  T x = angle;
+  while (x > pi)
+  {
+    x -= T(2 * M_PI);
+  }
+  while (x < -pi)
+  {
+    x += T(2 * M_PI);
+  }
+  if (x > half_pi)
+  {
+    x = pi - x;
+  }
+  else if (x < -half_pi)
+  {
+    x = -pi - x;
+  }
+
+  static constexpr int kBits = 30;
+  static constexpr int64_t kOne = int64_t(1) << kBits;
+  static constexpr int64_t kCoefficients[6] = {
+    int64_t(-kOne / 39916800.0), int64_t(kOne / 362880.0), int64_t(-kOne / 5040.0),
+    int64_t(kOne / 120.0), int64_t(-kOne / 6.0), kOne
+  };
+  const int64_t x_raw = int64_t(x.raw()) * (int64_t(1) << (kBits - F));
+  const int64_t x2_raw = (x_raw * x_raw) >> kBits;
+  int64_t result = kCoefficients[0];
+  for (int i = 1; i < 6; i++)
+  {
+    result = ((result * x2_raw) >> kBits) + kCoefficients[i];
+  }
+  result = (result * x_raw) >> kBits;
+
+  return T::fromRaw(int32_t((result + (int64_t(1) << (kBits - F - 1))) >> (kBits - F)));
+}
+
+template <int F>
+inline FixedPoint<F> cos(const FixedPoint<F> angle)
+{
+  return sin(angle + FixedPoint<F>(M_PI / 2));
+}
+
+// CORDIC in vectoring mode, shift-and-add only
+template <int F>
+inline FixedPoint<F> atan2(const FixedPoint<F> y, const FixedPoint<F> x)
+{
+  typedef FixedPoint<F> T;
+  static constexpr int kIterations = 24;
+  static constexpr T kAtanTable[kIterations] = {
+    T(7.853981633974483e-01), T(4.636476090008061e-01), T(2.449786631268641e-01), T(1.243549945467614e-01),
+    T(6.241880999595735e-02), T(3.123983343026828e-02), T(1.562372862047683e-02), T(7.812341060101111e-03),
+    T(3.906230131966972e-03), T(1.953122516478819e-03), T(9.765621895593195e-04), T(4.882812111948983e-04),
+    T(2.441406201493618e-04), T(1.220703118936702e-04), T(6.103515617420877e-05), T(3.051757811552610e-05),
+    T(1.525878906131576e-05), T(7.629394531101970e-06), T(3.814697265606496e-06), T(1.907348632810187e-06),
+    T(9.536743164059608e-07), T(4.768371582030889e-07), T(2.384185791015580e-07), T(1.192092895507807e-07)
+  };
+
+  if (x.raw() == 0 && y.raw() == 0)
+  {
+    return T();
+  }
+
+  // Rotate into the right half plane first, CORDIC converges within +-99 [deg]
+  int64_t x_raw = x.raw();
+  int64_t y_raw = y.raw();
+  T angle;
+  if (x_raw < 0)
+  {
+    angle = (y_raw >= 0)? T(M_PI) : T(-M_PI);
+    x_raw = -x_raw;
+    y_raw = -y_raw;
+  }
+
+  // Scale up for resolution, 64 bits leave room for the CORDIC gain
+  x_raw *= 65536;
+  y_raw *= 65536;
+  for (int i = 0; i < kIterations; i++)
+  {
+    const int64_t x_shift = x_raw >> i;
+    const int64_t y_shift = y_raw >> i;
+    if (y_raw > 0)
+    {
+      x_raw += y_shift;
+      y_raw -= x_shift;
+      angle += kAtanTable[i];
+    }
+    else
+    {
+      x_raw -= y_shift;
+      y_raw += x_shift;
+      angle -= kAtanTable[i];
+    }
+  }
+
+  // Back into [-pi, pi]
+  if (angle > T(M_PI))
+  {
+    angle -= T(2 * M_PI);
+  }
+  else if (angle < T(-M_PI))
+  {
+    angle += T(2 * M_PI);
+  }
+  return angle;
+}
+
+} // namespace me5413_world
+
+namespace std
+{
+
+template <int F>
+class numeric_limits<me5413_world::FixedPoint<F>>
+{
+ public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = true;
+  static constexpr bool is_integer = false;
+  static constexpr bool is_exact = true;
+  static constexpr bool has_infinity = false;
+  static constexpr bool has_quiet_NaN = false;
+  static constexpr me5413_world::FixedPoint<F> min() { return me5413_world::FixedPoint<F>::fromRaw(1); };
+  static constexpr me5413_world::FixedPoint<F> max() { return me5413_world::FixedPoint<F>::fromRaw(INT32_MAX); };
+  static constexpr me5413_world::FixedPoint<F> lowest() { return me5413_world::FixedPoint<F>::fromRaw(-INT32_MAX); };
+  static constexpr me5413_world::FixedPoint<F> epsilon() { return me5413_world::FixedPoint<F>::fromRaw(1); };
+};
+
+} // namespace std
@@ -0,0 +1,170 @@
+/** lap_statistics.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Per-lap tracking statistics with a bounded history of completed laps
+ */
+
+#pragma once
+
+#include <cmath>
+#include <deque>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+// Statistics of one completed lap
+struct LapRecord
+{
+  int lap;
+  double lap_time;            // [s]
+  double rms_position_error;  // [m]
+  double rms_heading_error;   // [deg]
+  double rms_speed_error;     // [m/s]
+  double max_position_error;  // [m]
+  double max_heading_error;   // [deg]
+  double max_speed_error;     // [m/s]
+  double average_speed;       // [m/s]
+};
+
+class LapStatistics
+{
+ public:
+  LapStatistics(const int history_size = 100);
+  ~LapStatistics() {};
+
+  // Clears the current lap and the history
+  void reset();
+  // Adds one sample to the current lap, the first sample starts the lap
+  void addSample(const double time, const double position_error, const double heading_error, const double speed_error, const double speed);
+  // Closes the current lap, stores its record in the history and starts the next lap at the same time
+  LapRecord finishLap(const double time);
+
+  const std::deque<LapRecord>& history() const { return history_; };
+  int numLaps() const { return num_laps_; };
+  double bestLapTime() const;
+  double meanLapTime() const;
+
+ private:
+  int history_size_;
+  std::deque<LapRecord> history_;
+  int num_laps_;
+
+  // Current lap
+  bool lap_started_;
+  double time_lap_start_;
+  long long num_samples_;
+  double sum_sqr_position_error_;
+  double sum_sqr_heading_error_;
+  double sum_sqr_speed_error_;
+  double max_position_error_;
+  double max_heading_error_;
+  double max_speed_error_;
+  double sum_speed_;
+};
+
+inline LapStatistics::LapStatistics(const int history_size) :
+  history_size_(std::max(history_size, 1))
+{
+  reset();
+};
+
+inline void LapStatistics::reset()
+{
+  this->history_.clear();
+  this->num_laps_ = 0;
+  this->lap_started_ = false;
+  this->time_lap_start_ = 0.0;
+  this->num_samples_ = 0;
+  this->sum_sqr_position_error_ = 0.0;
+  this->sum_sqr_heading_error_ = 0.0;
+  this->sum_sqr_speed_error_ = 0.0;
+  this->max_position_error_ = 0.0;
+  this->max_heading_error_ = 0.0;
+  this->max_speed_error_ = 0.0;
+  this->sum_speed_ = 0.0;
+};
+
+inline void LapStatistics::addSample(const double time, const double position_error, const double heading_error, const double speed_error, const double speed)
+{
+  if (!this->lap_started_)
+  {
+    this->time_lap_start_ = time;
+    this->lap_started_ = true;
+  }
+
+  this->num_samples_++;
+  this->sum_sqr_position_error_ += position_error * position_error;
+  this->sum_sqr_heading_error_ += heading_error * heading_error;
+  this->sum_sqr_speed_error_ += speed_error * speed_error;
+  this->max_position_error_ = std::max(this->max_position_error_, std::fabs(position_error));
+  this->max_heading_error_ = std::max(this->max_heading_error_, std::fabs(heading_error));
+  this->max_speed_error_ = std::max(this->max_speed_error_, std::fabs(speed_error));
+  this->sum_speed_ += speed;
+};
+
+inline LapRecord LapStatistics::finishLap(const double time)
+{
+  const double num_samples = std::max(this->num_samples_, 1LL);
+
+  LapRecord record;
+  record.lap = this->num_laps_;
+  record.lap_time = this->lap_started_? time - this->time_lap_start_ : 0.0;
+  record.rms_position_error = std::sqrt(this->sum_sqr_position_error_/num_samples);
+  record.rms_heading_error = std::sqrt(this->sum_sqr_heading_error_/num_samples);
+  record.rms_speed_error = std::sqrt(this->sum_sqr_speed_error_/num_samples);
+  record.max_position_error = this->max_position_error_;
+  record.max_heading_error = this->max_heading_error_;
+  record.max_speed_error = this->max_speed_error_;
+  record.average_speed = this->sum_speed_/num_samples;
+
+  // Keep only the most recent laps
+  this->history_.push_back(record);
+  while (int(this->history_.size()) > this->history_size_)
+  {
+    this->history_.pop_front();
+  }
+  this->num_laps_++;
+
+  // Start the next lap
+  this->lap_started_ = true;
+  this->time_lap_start_ = time;
+  this->num_samples_ = 0;
+  this->sum_sqr_position_error_ = 0.0;
+  this->sum_sqr_heading_error_ = 0.0;
+  this->sum_sqr_speed_error_ = 0.0;
+  this->max_position_error_ = 0.0;
+  this->max_heading_error_ = 0.0;
+  this->max_speed_error_ = 0.0;
+  this->sum_speed_ = 0.0;
+
+  return record;
+};
+
+inline double LapStatistics::bestLapTime() const
+{
+  double best_lap_time = 0.0;
+  for (const LapRecord& record : this->history_)
+  {
+    if (best_lap_time == 0.0 || record.lap_time < best_lap_time)
+    {
+      best_lap_time = record.lap_time;
+    }
+  }
+  return best_lap_time;
+};
+
+inline double LapStatistics::meanLapTime() const
+{
+  double sum_lap_time = 0.0;
+  for (const LapRecord& record : this->history_)
+  {
+    sum_lap_time += record.lap_time;
+  }
+  return this->history_.empty()? 0.0 : sum_lap_time/this->history_.size();
+};
+
+} // namespace me5413_world
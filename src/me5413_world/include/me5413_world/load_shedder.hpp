@@ -0,0 +1,116 @@
+/** load_shedder.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Degradation policy that sheds optional work when control cycles overrun their budget
+ */
+
+#pragma once
+
+#include <deque>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+// One change of the shedding level
+struct LoadSheddingTransition
+{
+  double time;        // [s]
+  int from_level;
+  int to_level;
+  double cycle_time;  // [s], duration of the cycle that triggered the transition
+};
+
+class LoadShedder
+{
+ public:
+  // Sheds one more level after overrun_cycles consecutive cycles over budget,
+  // restores one level after headroom_cycles consecutive cycles under half the budget
+  LoadShedder(const int max_level = 1, const double budget = 0.02, const int overrun_cycles = 3, const int headroom_cycles = 50, const int history_size = 100);
+  ~LoadShedder() {};
+
+  void setBudget(const double budget) { budget_ = budget; };
+  // Restores all levels and clears the history
+  void reset();
+  // Feeds the duration of the last cycle, returns true if the level changed
+  bool update(const double time, const double cycle_time);
+
+  int level() const { return level_; };
+  double budget() const { return budget_; };
+  const std::deque<LoadSheddingTransition>& transitions() const { return transitions_; };
+
+ private:
+  int max_level_;
+  double budget_;
+  int overrun_cycles_;
+  int headroom_cycles_;
+  int history_size_;
+
+  int level_;
+  int num_overruns_;
+  int num_headroom_;
+  std::deque<LoadSheddingTransition> transitions_;
+};
+
+inline LoadShedder::LoadShedder(const int max_level, const double budget, const int overrun_cycles, const int headroom_cycles, const int history_size) :
+  max_level_(max_level),
+  budget_(budget),
+  overrun_cycles_(overrun_cycles),
+  headroom_cycles_(headroom_cycles),
+  history_size_(std::max(history_size, 1))
+{
+  reset();
+};
+
+inline void LoadShedder::reset()
+{
+  this->level_ = 0;
+  this->num_overruns_ = 0;
+  this->num_headroom_ = 0;
+  this->transitions_.clear();
+};
+
+inline bool LoadShedder::update(const double time, const double cycle_time)
+{
+  // Count consecutive overruns and consecutive cycles with headroom, the band in between is the hysteresis
+  this->num_overruns_ = (cycle_time > this->budget_)? this->num_overruns_ + 1 : 0;
+  this->num_headroom_ = (cycle_time < 0.5 * this->budget_)? this->num_headroom_ + 1 : 0;
+
+  int new_level = this->level_;
+  if (this->num_overruns_ >= this->overrun_cycles_ && this->level_ < this->max_level_)
+  {
+    new_level = this->level_ + 1;
+  }
+  else if (this->num_headroom_ >= this->headroom_cycles_ && this->level_ > 0)
+  {
+    new_level = this->level_ - 1;
+  }
+  if (new_level == this->level_)
+  {
+    return false;
+  }
+
+  // Record the transition, keeping only the most recent ones
+  LoadSheddingTransition transition;
+  transition.time = time;
+  transition.from_level = this->level_;
+  transition.to_level = new_level;
+  transition.cycle_time = cycle_time;
+  this->transitions_.push_back(transition);
+  while (int(this->transitions_.size()) > this->history_size_)
+  {
+    this->transitions_.pop_front();
+  }
+
+  // Each level has to be earned again from scratch
+  this->level_ = new_level;
+  this->num_overruns_ = 0;
+  this->num_headroom_ = 0;
+
+  return true;
+};
+
+} // namespace me5413_world
@@ -4,7 +4,7 @@
  *
  * MIT License
  *
- * Commonly used math functions
+ * Commonly used math functions, templated on the scalar type (double, float or FixedPoint)
 */
 
 #pragma once
@@ -16,37 +16,44 @@ namespace me5413_world
 {
 
 // Return PI
-constexpr double pi() { return M_PI; }
+template <typename T = double>
+constexpr T pi() { return T(M_PI); }
 
 // Convert degrees to radians
-inline double deg2rad(const double x) { return x * pi() / 180; }
+template <typename T>
+inline T deg2rad(const T x) { return x * (pi<T>() / T(180.0)); }
 
 // Convert radians to degrees
-inline double rad2deg(const double x) { return x * 180 / pi(); }
+template <typename T>
+inline T rad2deg(const T x) { return x * (T(180.0) / pi<T>()); }
 
 // Convert metre per second to kilometers per hour
-inline double mps2kph(const double x) { return x * 3.6; }
+template <typename T>
+inline T mps2kph(const T x) { return x * T(3.6); }
 
 // Convert kilometers per hour to meter per second
-inline double kph2mps(const double x) { return x / 3.6; }
+template <typename T>
+inline T kph2mps(const T x) { return x / T(3.6); }
 
 // Convert angle into range [-pi, +pi]
-inline double unifyAngleRange(const double angle)
+template <typename T>
+inline T unifyAngleRange(const T angle)
 {
   auto new_angle = angle;
-  while (new_angle > pi())
+  while (new_angle > pi<T>())
   {
-    new_angle -= 2 * pi();
+    new_angle -= T(2.0) * pi<T>();
   }
-  while (new_angle < -pi())
+  while (new_angle < -pi<T>())
   {
-    new_angle += 2 * pi();
+    new_angle += T(2.0) * pi<T>();
   }
   return new_angle;
 }
 
 // Limit the value within [lower_bound, upper_bound]
-inline double limitWithinRange(const double value, const double lower_bound, const double upper_bound)
+template <typename T>
+inline T limitWithinRange(const T value, const T lower_bound, const T upper_bound)
 {
   auto new_value = std::max(value, lower_bound);
   new_value = std::min(new_value, upper_bound);
@@ -54,9 +61,12 @@ inline double limitWithinRange(const double value, const double lower_bound, con
 }
 
 // Check if a value is legal (not nan or inf)
-inline bool isLegal(const double x)
+template <typename T>
+inline bool isLegal(const T x)
 {
-  return (std::isnan(x) || std::isinf(x))? false : true;
+  using std::isnan;
+  using std::isinf;
+  return (isnan(x) || isinf(x))? false : true;
 }
 
 } // end of namespace me5413_world
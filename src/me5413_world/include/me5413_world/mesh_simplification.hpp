@@ -0,0 +1,50 @@
+/** mesh_simplification.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * STL input/output, convex hulls and quadric edge-collapse decimation, used to build
+ * low-polygon collision meshes for the robot description
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace me5413_world
+{
+
+struct Vec3
+{
+  double x, y, z;
+};
+
+// Indexed triangle mesh, triangles are counter-clockwise seen from outside
+struct TriangleMesh
+{
+  std::vector<Vec3> vertices;
+  std::vector<std::array<int, 3>> triangles;
+};
+
+// Reads an ASCII or binary STL, welding the vertices that share the exact same coordinates.
+// Returns false if the file cannot be read or is not an STL
+bool readStl(const std::string& filename, TriangleMesh& mesh);
+// Writes a binary STL, with the facet normals computed from the triangles
+bool writeStl(const std::string& filename, const TriangleMesh& mesh, const std::string& header = "me5413_world");
+
+// Incremental convex hull of the vertices, O(n * h) for h hull faces.
+// Returns false if the vertices are degenerate (all on a plane)
+bool convexHull(const std::vector<Vec3>& points, TriangleMesh& hull);
+
+// Garland & Heckbert quadric error edge collapse, down to at most target_triangles.
+// Collapses that would flip a triangle or break the manifold are skipped, so the result may keep
+// more triangles than asked for if nothing else can be collapsed. Returns the number of triangles kept
+int decimate(TriangleMesh& mesh, const int target_triangles);
+
+// Largest distance from a vertex of the original mesh to the simplified surface
+double maxDeviation(const TriangleMesh& original, const TriangleMesh& simplified);
+
+} // namespace me5413_world
@@ -0,0 +1,124 @@
+/** metrics.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Counters, gauges and histograms served in the Prometheus text format by an embedded HTTP server.
+ * Updates are lock-free atomics, so a scrape never blocks the control loop
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace me5413_world
+{
+
+class Counter
+{
+ public:
+  Counter() : value_(0) {};
+  void increment(const uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); };
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); };
+
+ private:
+  std::atomic<uint64_t> value_;
+};
+
+class Gauge
+{
+ public:
+  Gauge() : value_(0.0) {};
+  void set(const double value) { value_.store(value, std::memory_order_relaxed); };
+  double value() const { return value_.load(std::memory_order_relaxed); };
+
+ private:
+  std::atomic<double> value_;
+};
+
+class Histogram
+{
+ public:
+  // bounds are the upper bounds of the buckets, in increasing order, +Inf is implicit
+  explicit Histogram(const std::vector<double>& bounds);
+  // Non-finite values are skipped
+  void observe(const double value);
+
+  const std::vector<double>& bounds() const { return bounds_; };
+  // Cumulative counts, one per bound plus +Inf
+  std::vector<uint64_t> cumulativeCounts() const;
+  double sum() const { return sum_.load(std::memory_order_relaxed); };
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); };
+
+ private:
+  std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<double> sum_;
+  std::atomic<uint64_t> count_;
+};
+
+// Upper bounds start, start * factor, ..., count of them
+std::vector<double> exponentialBuckets(const double start, const double factor, const int count);
+// Upper bounds start, start + width, ..., count of them
+std::vector<double> linearBuckets(const double start, const double width, const int count);
+
+class MetricsRegistry
+{
+ public:
+  MetricsRegistry() {};
+  ~MetricsRegistry() {};
+
+  // Register a metric at startup, the returned reference stays valid for the lifetime of the registry
+  Counter& counter(const std::string& name, const std::string& help);
+  Gauge& gauge(const std::string& name, const std::string& help);
+  Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+  // All metrics in the Prometheus text exposition format (version 0.0.4)
+  std::string render() const;
+
+ private:
+  struct Entry
+  {
+    std::string name;
+    std::string help;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  };
+
+  mutable std::mutex mutex_;
+  std::deque<Entry> entries_;
+};
+
+// Serves GET /metrics on a background thread, one connection at a time
+class MetricsServer
+{
+ public:
+  explicit MetricsServer(const MetricsRegistry& registry);
+  ~MetricsServer();
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  // Binds to address:port (127.0.0.1 keeps it local), returns false if the socket cannot be opened
+  bool start(const std::string& address, const int port);
+  void stop();
+
+ private:
+  void serve();
+  void handleConnection(const int fd);
+
+  const MetricsRegistry& registry_;
+  int listen_fd_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,185 @@
+/** network_impairment.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Seeded model of a degraded link: delay, jitter, bursty drops, reordering and a bandwidth cap
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+enum class DelayDistribution
+{
+  Constant,
+  Uniform,     // delay +- jitter
+  Normal,      // jitter is the standard deviation
+  Exponential  // delay + an exponential tail of mean jitter
+};
+
+// Returns false if the name is unknown
+inline bool parseDelayDistribution(const std::string& name, DelayDistribution& distribution)
+{
+  if (name == "constant") distribution = DelayDistribution::Constant;
+  else if (name == "uniform") distribution = DelayDistribution::Uniform;
+  else if (name == "normal") distribution = DelayDistribution::Normal;
+  else if (name == "exponential") distribution = DelayDistribution::Exponential;
+  else return false;
+  return true;
+};
+
+struct ImpairmentConfig
+{
+  DelayDistribution distribution = DelayDistribution::Constant;
+  double delay = 0.0;                // [s]
+  double jitter = 0.0;               // [s]
+  double drop_probability = 0.0;     // long-run fraction of messages dropped
+  double drop_burst_length = 1.0;    // mean number of consecutive drops
+  double reorder_probability = 0.0;  // chance that a message skips the delay and overtakes the queued ones
+  double bandwidth = 0.0;            // [bytes/s], 0 for unlimited
+  double queue_limit = 1e6;          // [bytes] waiting for the bandwidth, more are dropped
+};
+
+struct ImpairmentStats
+{
+  uint64_t num_received = 0;
+  uint64_t num_dropped = 0;        // by the drop model
+  uint64_t num_queue_dropped = 0;  // by the bandwidth cap
+  uint64_t num_reordered = 0;
+};
+
+// Decides the fate of each message in arrival order. The random draws only come from a 64-bit Mersenne Twister,
+// whose sequence is fixed by the standard, so a seed gives the same drops and delays on every platform.
+// Like TCPROS, messages leave in arrival order unless they are reordered on purpose
+class ImpairmentModel
+{
+ public:
+  ImpairmentModel(const ImpairmentConfig& config = ImpairmentConfig(), const uint64_t seed = 0);
+  ~ImpairmentModel() {};
+
+  // Time at which a message of size bytes arriving at now leaves, or a negative value if it is dropped
+  double process(const double now, const size_t size);
+
+  const ImpairmentConfig& config() const { return config_; };
+  const ImpairmentStats& stats() const { return stats_; };
+
+ private:
+  double uniform();
+  double normal();
+  double sampleDelay();
+  bool sampleDrop();
+
+  ImpairmentConfig config_;
+  ImpairmentStats stats_;
+  std::mt19937_64 rng_;
+  bool in_drop_burst_;
+  double link_free_time_;  // [s] when the last message accepted has been transmitted
+  double last_departure_;  // [s] of the last message kept in order
+};
+
+inline ImpairmentModel::ImpairmentModel(const ImpairmentConfig& config, const uint64_t seed) :
+  config_(config),
+  rng_(seed),
+  in_drop_burst_(false),
+  link_free_time_(-INFINITY),
+  last_departure_(-INFINITY)
+{};
+
+inline double ImpairmentModel::uniform()
+{
+  // 53 random bits in [0, 1)
+  return (this->rng_() >> 11) * (1.0 / 9007199254740992.0);
+};
+
+inline double ImpairmentModel::normal()
+{
+  // Box-Muller, one of the pair is enough
+  const double u1 = 1.0 - uniform();
+  const double u2 = uniform();
+  return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+};
+
+inline double ImpairmentModel::sampleDelay()
+{
+  double delay = this->config_.delay;
+  switch (this->config_.distribution)
+  {
+    case DelayDistribution::Constant:
+      break;
+    case DelayDistribution::Uniform:
+      delay += this->config_.jitter * (2.0 * uniform() - 1.0);
+      break;
+    case DelayDistribution::Normal:
+      delay += this->config_.jitter * normal();
+      break;
+    case DelayDistribution::Exponential:
+      delay += -this->config_.jitter * std::log(1.0 - uniform());
+      break;
+  }
+
+  return std::max(delay, 0.0);
+};
+
+inline bool ImpairmentModel::sampleDrop()
+{
+  // Two-state Markov chain (Gilbert model): every message of a burst is dropped, bursts last drop_burst_length
+  // messages on average and start often enough to drop drop_probability of the messages in the long run
+  const double p = std::min(std::max(this->config_.drop_probability, 0.0), 1.0);
+  if (p <= 0.0 || p >= 1.0)
+  {
+    return p >= 1.0;
+  }
+  const double end_burst = 1.0 / std::max(this->config_.drop_burst_length, 1.0);
+  const double start_burst = std::min(p * end_burst / (1.0 - p), 1.0);
+  this->in_drop_burst_ = (uniform() < (this->in_drop_burst_? 1.0 - end_burst : start_burst));
+
+  return this->in_drop_burst_;
+};
+
+inline double ImpairmentModel::process(const double now, const size_t size)
+{
+  // Always draw the same number of values per message, so that one decision does not shift the next ones
+  this->stats_.num_received++;
+  const bool drop = sampleDrop();
+  const double delay = sampleDelay();
+  const bool reorder = (uniform() < this->config_.reorder_probability);
+  if (drop)
+  {
+    this->stats_.num_dropped++;
+    return -1.0;
+  }
+
+  // Bandwidth cap: messages are transmitted one after the other, and dropped when too many bytes are waiting
+  double transmitted = now;
+  if (this->config_.bandwidth > 0.0)
+  {
+    const double start = std::max(now, this->link_free_time_);
+    if ((start - now) * this->config_.bandwidth > this->config_.queue_limit)
+    {
+      this->stats_.num_queue_dropped++;
+      return -1.0;
+    }
+    this->link_free_time_ = start + size / this->config_.bandwidth;
+    transmitted = this->link_free_time_;
+  }
+
+  if (reorder)
+  {
+    this->stats_.num_reordered++;
+    return transmitted;
+  }
+  this->last_departure_ = std::max(transmitted + delay, this->last_departure_);
+
+  return this->last_departure_;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,116 @@
+/** odom_load_generator_node.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Declarations for OdomLoadGeneratorNode class
+ */
+
+#ifndef ODOM_LOAD_GENERATOR_NODE_H_
+#define ODOM_LOAD_GENERATOR_NODE_H_
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/ros.h>
+#include <nav_msgs/Path.h>
+#include <nav_msgs/Odometry.h>
+#include <geometry_msgs/Twist.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+// Response of the nodes during one rate step
+struct LoadStepResult
+{
+  double target_rate;          // [Hz]
+  double offered_rate;         // [Hz] odometry actually sent
+  double odom_processed_rate;  // [Hz] odometry processed by the path publisher (one tf each)
+  double odom_age_mean;        // [s] from sending an odometry to the path publisher processing it
+  double odom_age_p99;         // [s]
+  double local_path_rate;      // [Hz]
+  double local_path_jitter;    // [s] std of the local path period
+  double cmd_vel_rate;         // [Hz]
+};
+
+struct SentOdometry
+{
+  double x, y;
+  double time;  // [s] ros time when it was sent
+};
+
+class OdomLoadGeneratorNode
+{
+ public:
+  OdomLoadGeneratorNode();
+  virtual ~OdomLoadGeneratorNode();
+
+ private:
+  void publishLoop();
+  nav_msgs::OdometryPtr createOdometry(const double t);
+  void tfCallback(const tf2_msgs::TFMessage::ConstPtr& tf);
+  void localPathCallback(const nav_msgs::Path::ConstPtr& path);
+  void cmdVelCallback(const geometry_msgs::Twist::ConstPtr& cmd_vel);
+  void startStep(const int step);
+  LoadStepResult finishStep();
+  void writeResults() const;
+
+  // ROS declaration
+  ros::NodeHandle nh_;
+  ros::Publisher pub_odom_;
+  ros::Subscriber sub_tf_;
+  ros::Subscriber sub_local_path_;
+  ros::Subscriber sub_cmd_vel_;
+
+  // Motion along the track
+  std::vector<Pose2D> path_;
+  std::vector<double> path_s_;
+  double speed_;
+  std::string world_frame_;
+  std::string robot_frame_;
+
+  // Disturbances
+  std::mt19937 rng_;
+  double position_noise_;
+  double heading_noise_;
+  double speed_noise_;
+  double jitter_;
+  int burst_size_;
+  double burst_period_;
+  double out_of_order_probability_;
+
+  // Rate steps
+  std::vector<double> rates_;
+  double step_duration_;
+  std::string output_file_;
+  std::vector<LoadStepResult> results_;
+
+  // Shared between the publishing thread and the callbacks
+  std::mutex mutex_;
+  int step_;
+  double step_start_;
+  uint64_t num_sent_;
+  std::deque<SentOdometry> sent_;  // last 2s, in send order
+  uint64_t num_tf_;
+  std::vector<double> odom_ages_;
+  uint64_t num_local_paths_;
+  std::vector<double> local_path_periods_;
+  double last_local_path_;
+  uint64_t num_cmd_vels_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+} // namespace me5413_world
+
+#endif // ODOM_LOAD_GENERATOR_NODE_H_
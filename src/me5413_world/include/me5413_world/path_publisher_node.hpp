@@ -13,16 +13,22 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <map>
+#include <atomic>
 
 #include <ros/ros.h>
 #include <ros/console.h>
 #include <std_msgs/Float32.h>
+#include <std_msgs/Float32MultiArray.h>
 #include <nav_msgs/Path.h>
 #include <nav_msgs/Odometry.h>
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TransformStamped.h>
+#include <visualization_msgs/MarkerArray.h>
+#include <std_srvs/Empty.h>
 
 #include <tf2/convert.h>
 #include <tf2/LinearMath/Matrix3x3.h>
@@ -32,12 +38,59 @@
 #include <tf2_ros/transform_broadcaster.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
+#include <gazebo_msgs/SetModelState.h>
 #include <dynamic_reconfigure/server.h>
+#include <dynamic_reconfigure/Reconfigure.h>
 #include <me5413_world/path_publisherConfig.h>
+#include <me5413_world/ResetEpisode.h>
+#include <me5413_world/QueryPath.h>
+#include <me5413_world/PlanMission.h>
+#include <me5413_world/LapSummary.h>
+#include <me5413_world/LoadShedding.h>
+#include <me5413_world/CycleTiming.h>
+
+#include "me5413_world/tracking_utils.hpp"
+#include "me5413_world/lap_statistics.hpp"
+#include "me5413_world/waypoint_error_map.hpp"
+#include "me5413_world/trail_buffer.hpp"
+#include "me5413_world/path_query.hpp"
+#include "me5413_world/route_graph.hpp"
+#include "me5413_world/racing_line.hpp"
+#include "me5413_world/load_shedder.hpp"
+#include "me5413_world/checkpoint.hpp"
+#include "me5413_world/metrics.hpp"
+#include "me5413_world/ros_log_sink.hpp"
 
 namespace me5413_world
 {
 
+// Progress and metrics saved for warm restarts
+struct PublisherCheckpoint
+{
+  double stamp;
+  // Version of the global path
+  double track_A_axis;
+  double track_B_axis;
+  int track_wp_num;
+  uint64_t route_id;  // mission followed instead of the lemniscate, 0 for none
+  // Progress and metric accumulators
+  int current_id;
+  long long num_time_steps;
+  double sum_sqr_position_error;
+  double sum_sqr_heading_error;
+  double sum_sqr_speed_error;
+};
+
+// Racing line optimized on the thread pool, picked up by the timer once done
+struct RacingLineJob
+{
+  std::vector<double> key;
+  RacingLine line;
+  bool success = false;
+  std::string error;
+  std::atomic<bool> done{false};
+};
+
 class PathPublisherNode
 {
  public:
@@ -46,20 +99,38 @@ class PathPublisherNode
 
  private:
   void timerCallback(const ros::TimerEvent &);
+  void heatmapTimerCallback(const ros::TimerEvent &);
+  void trailTimerCallback(const ros::TimerEvent &);
   void robotOdomCallback(const nav_msgs::Odometry::ConstPtr &odom);
+  bool resetEpisodeCallback(me5413_world::ResetEpisode::Request &req, me5413_world::ResetEpisode::Response &res);
+  bool queryPathCallback(me5413_world::QueryPath::Request &req, me5413_world::QueryPath::Response &res);
+  bool planMissionCallback(me5413_world::PlanMission::Request &req, me5413_world::PlanMission::Response &res);
+  void loadRoutes();
+  bool planMission(const std::vector<std::string> &goals, const bool loop, std::string &message, double &length);
+  void resetEpisode();
   void publishGlobalPath();
-  void publishLocalPath(const geometry_msgs::Pose &robot_pose, const int n_wp_prev, const int n_wp_post);
-
-  std::vector<geometry_msgs::PoseStamped> createGlobalPath(const double A, const double B, const double t_res);
-  int closestWaypoint(const geometry_msgs::Pose &robot_pose, const nav_msgs::Path &path, const int id_start);
-  int nextWaypoint(const geometry_msgs::Pose &robot_pose, const nav_msgs::Path &path, const int id_start);
+  // Returns false if no local path was published, goal_id_ is then left as it was
+  bool publishLocalPath(const geometry_msgs::Pose &robot_pose, const int n_wp_prev, const int n_wp_post);
+  void publishLapSummary(const LapRecord &record);
+  int computeLocalWindowSize(const int id_next, const int n_wp_max);
+  void updateLoadShedding(const double cycle_time);
+  void publishCycleTiming(const double cycle_time);
+  void saveCheckpoint();
+  void restoreCheckpoint();
+  void setupMetrics();
+
+  void createGlobalPath(const double A, const double B, const double t_res);
+  const RacingLine* findRacingLine(const std::vector<Pose2D> &centreline, const std::vector<double> &key);
+  void collectRacingLine();
   double getYawFromOrientation(const geometry_msgs::Quaternion &orientation);
+  Pose2D convertPoseToPose2D(const geometry_msgs::Pose &pose);
   tf2::Transform convertPoseToTransform(const geometry_msgs::Pose &pose);
-  std::pair<double, double> calculatePoseError(const geometry_msgs::Pose &pose_robot, const geometry_msgs::Pose &pose_goal);
 
   // ROS declaration
   ros::NodeHandle nh_;
   ros::Timer timer_;
+  ros::Timer heatmap_timer_;
+  ros::Timer trail_timer_;
   tf2_ros::Buffer tf2_buffer_;
   tf2_ros::TransformListener tf2_listener_;
   tf2_ros::TransformBroadcaster tf2_bcaster_;
@@ -67,6 +138,12 @@ class PathPublisherNode
   dynamic_reconfigure::Server<me5413_world::path_publisherConfig>::CallbackType f;
 
   ros::Subscriber sub_robot_odom_;
+  ros::ServiceServer srv_reset_episode_;
+  ros::ServiceServer srv_query_path_;
+  ros::ServiceServer srv_plan_mission_;
+  ros::ServiceClient client_set_model_state_;
+  ros::ServiceClient client_tracker_reset_;
+  ros::ServiceClient client_tracker_reconfigure_;
 
   ros::Publisher pub_global_path_;
   ros::Publisher pub_local_path_;
@@ -76,16 +153,43 @@ class PathPublisherNode
   ros::Publisher pub_rms_position_error_;
   ros::Publisher pub_rms_heading_error_;
   ros::Publisher pub_rms_speed_error_;
+  ros::Publisher pub_lap_summary_;
+  ros::Publisher pub_error_heatmap_;
+  ros::Publisher pub_waypoint_errors_;
+  ros::Publisher pub_trail_;
+  ros::Publisher pub_load_shedding_;
+  ros::Publisher pub_cycle_timing_;
+  ros::Publisher pub_speed_target_;
 
   // Robot pose
   std::string world_frame_;
   std::string robot_frame_;
+  std::string robot_model_;
+  geometry_msgs::Pose pose_world_start_;
 
   geometry_msgs::Pose pose_world_goal_;
   nav_msgs::Odometry odom_world_robot_;
 
+  std::vector<Pose2D> global_path_;
+  std::vector<double> global_path_s_;
   nav_msgs::Path global_path_msg_;
   nav_msgs::Path local_path_msg_;
+  std::vector<Pose2D> query_poses_;
+
+  // Route graph of the site, the global path follows a mission through it instead of the lemniscate when planned
+  RouteGraph route_graph_;
+  ContractionHierarchy route_hierarchy_;
+  std::unique_ptr<RouteSearch> route_search_;
+  double route_waypoint_spacing_;
+  std::vector<Pose2D> route_path_;
+  uint64_t route_id_;  // hash of route_path_, 0 when it is empty
+
+  // Racing lines of the lemniscate, cached per track configuration. The global path keeps one waypoint per
+  // waypoint of the centreline, so the progress carries over when the line replaces it
+  std::map<std::vector<double>, RacingLine> racing_lines_;
+  std::shared_ptr<RacingLineJob> racing_job_;
+  std::vector<double> racing_speeds_;  // speed profile of the global path, empty when it is not a racing line
+  std_msgs::Float32 speed_target_;
 
   std_msgs::Float32 abs_position_error_;
   std_msgs::Float32 abs_heading_error_;
@@ -95,10 +199,48 @@ class PathPublisherNode
   std_msgs::Float32 rms_speed_error_;
 
   int current_id_;
+  int goal_id_;
   long long num_time_steps_;
   double sum_sqr_position_error_;
   double sum_sqr_heading_error_;
   double sum_sqr_speed_error_;
+
+  // Continuous laps
+  LapStatistics lap_stats_;
+
+  // Errors per waypoint
+  WaypointErrorMap error_map_;
+  double heatmap_max_error_;
+  int num_heatmap_updates_;
+
+  // Driven trail, shown as line strips of trail_chunk_size_ points, only the changed ones are sent
+  TrailBuffer trail_;
+  int trail_chunk_size_;
+  uint64_t trail_published_end_;
+  bool trail_cleared_;
+  int num_trail_subscribers_;
+  int num_trail_updates_;
+
+  // Load shedding
+  LoadShedder load_shedder_;
+
+  // Warm restart
+  Checkpoint<PublisherCheckpoint> checkpoint_;
+  bool checkpoint_restored_;
+  double checkpoint_max_age_;
+
+  // Prometheus metrics, the hot path only updates atomics
+  MetricsRegistry metrics_;
+  MetricsServer metrics_server_;
+  Counter* metric_cycles_;
+  Counter* metric_cycle_overruns_;
+  Histogram* metric_cycle_duration_;
+  Histogram* metric_path_regeneration_;
+  Histogram* metric_position_error_;
+  Histogram* metric_heading_error_;
+  Histogram* metric_speed_error_;
+  Histogram* metric_local_path_bytes_;
+  Gauge* metric_shedding_level_;
 };
 
 } // namespace me5413_world
@@ -0,0 +1,222 @@
+/** path_query.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Segments of a path by arc length, waypoint index or around a pose, resampled at a given resolution
+ */
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "me5413_world/math_utils.hpp"
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+// Read-only view of a path and its cumulative arc length, the queries never copy the path
+class PathView
+{
+ public:
+  // closed: the last waypoint is followed by the first one, and arc lengths past the end continue on the next lap
+  PathView(const std::vector<Pose2D>& path, const std::vector<double>& s, const bool closed);
+
+  // Length of one lap, including the closing segment of a closed path
+  double length() const { return length_; };
+  // Arc length of waypoint id, which may be past the end of a closed path
+  double arcLengthAt(const long id) const;
+  // Pose at arc length s_query, on the segment that starts at the waypoint before it
+  Pose2D poseAt(const double s_query) const;
+  // Arc length of the projection of (x, y) on the path. The closest segment is searched over the whole path,
+  // ignoring the segments heading more than 90 degrees away from yaw, so the crossing of a figure 8 is not ambiguous
+  double project(const double x, const double y, const double yaw) const;
+  // Clamps the range to the path if it is open, and to one lap if it is closed. Returns false if it is empty
+  bool clampRange(double& s_start, double& s_end) const;
+  // Poses from s_start to s_end, every resolution [m], or at the waypoints in between if resolution is 0.
+  // Both ends are included, after clampRange
+  void segment(double s_start, double s_end, const double resolution, std::vector<Pose2D>& poses) const;
+
+ private:
+  // Wraps onto the first lap if closed, clamps to the path otherwise
+  double normalize(const double s_query) const;
+  int segmentAt(const double s_lap) const;
+
+  const std::vector<Pose2D>& path_;
+  const std::vector<double>& s_;
+  bool closed_;
+  double length_;
+};
+
+inline PathView::PathView(const std::vector<Pose2D>& path, const std::vector<double>& s, const bool closed) :
+  path_(path),
+  s_(s),
+  closed_(closed && path.size() > 1),
+  length_(s.empty()? 0.0 : s.back())
+{
+  if (this->closed_)
+  {
+    this->length_ += std::hypot(path.front().x - path.back().x, path.front().y - path.back().y);
+  }
+};
+
+inline double PathView::arcLengthAt(const long id) const
+{
+  const long num_wp = this->s_.size();
+  if (!this->closed_)
+  {
+    return this->s_[std::min(std::max(id, 0L), num_wp - 1)];
+  }
+  const long lap = (id >= 0)? id / num_wp : -((-id + num_wp - 1) / num_wp);
+  return lap * this->length_ + this->s_[id - lap * num_wp];
+};
+
+inline double PathView::normalize(const double s_query) const
+{
+  if (!this->closed_ || this->length_ <= 0.0)
+  {
+    return limitWithinRange(s_query, 0.0, this->s_.back());
+  }
+  const double s_lap = std::fmod(s_query, this->length_);
+  return (s_lap < 0.0)? s_lap + this->length_ : s_lap;
+};
+
+inline int PathView::segmentAt(const double s_lap) const
+{
+  // Last waypoint at or before s_lap
+  const int id = int(std::upper_bound(this->s_.begin(), this->s_.end(), s_lap) - this->s_.begin()) - 1;
+  return std::max(id, 0);
+};
+
+inline Pose2D PathView::poseAt(const double s_query) const
+{
+  const double s_lap = normalize(s_query);
+  const int id = segmentAt(s_lap);
+  const int num_wp = this->path_.size();
+  if (id + 1 >= num_wp && !this->closed_)
+  {
+    return this->path_.back();
+  }
+
+  // Waypoints are oriented along the segment that starts from them
+  const Pose2D& from = this->path_[id];
+  const Pose2D& to = this->path_[(id + 1) % num_wp];
+  const double s_to = (id + 1 < num_wp)? this->s_[id + 1] : this->length_;
+  const double ratio = (s_to > this->s_[id])? (s_lap - this->s_[id]) / (s_to - this->s_[id]) : 0.0;
+  Pose2D pose;
+  pose.x = from.x + ratio * (to.x - from.x);
+  pose.y = from.y + ratio * (to.y - from.y);
+  pose.yaw = from.yaw;
+
+  return pose;
+};
+
+inline double PathView::project(const double x, const double y, const double yaw) const
+{
+  const int num_wp = this->path_.size();
+  const int num_segments = this->closed_? num_wp : num_wp - 1;
+  if (num_segments <= 0)
+  {
+    return 0.0;
+  }
+
+  double min_dist = std::numeric_limits<double>::max();
+  double s_closest = 0.0;
+  for (int i = 0; i < num_segments; i++)
+  {
+    const Pose2D& from = this->path_[i];
+    const Pose2D& to = this->path_[(i + 1) % num_wp];
+    if (std::fabs(unifyAngleRange(from.yaw - yaw)) > M_PI / 2.0)
+    {
+      continue;
+    }
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length_sqr = dx * dx + dy * dy;
+    const double ratio = (length_sqr > 0.0)? limitWithinRange(((x - from.x) * dx + (y - from.y) * dy) / length_sqr, 0.0, 1.0) : 0.0;
+    const double dist = std::hypot(from.x + ratio * dx - x, from.y + ratio * dy - y);
+    if (dist < min_dist)
+    {
+      min_dist = dist;
+      s_closest = this->s_[i] + ratio * std::sqrt(length_sqr);
+    }
+  }
+
+  return s_closest;
+};
+
+inline bool PathView::clampRange(double& s_start, double& s_end) const
+{
+  if (this->path_.empty())
+  {
+    return false;
+  }
+  if (this->closed_)
+  {
+    s_end = std::min(s_end, s_start + this->length_);
+  }
+  else
+  {
+    s_start = normalize(s_start);
+    s_end = normalize(s_end);
+  }
+
+  return s_end >= s_start;
+};
+
+inline void PathView::segment(double s_start, double s_end, const double resolution, std::vector<Pose2D>& poses) const
+{
+  poses.clear();
+  if (!clampRange(s_start, s_end))
+  {
+    return;
+  }
+
+  if (resolution > 0.0)
+  {
+    const long num_steps = long(std::floor((s_end - s_start) / resolution));
+    poses.reserve(num_steps + 2);
+    for (long k = 0; k <= num_steps; k++)
+    {
+      poses.push_back(poseAt(s_start + k * resolution));
+    }
+    if (s_end - (s_start + num_steps * resolution) > 1e-6 * resolution)
+    {
+      poses.push_back(poseAt(s_end));
+    }
+    return;
+  }
+
+  // Waypoints in between, unrolled over the laps of a closed path
+  const int num_wp = this->path_.size();
+  const double lap_offset = this->closed_? std::floor(s_start / this->length_) * this->length_ : 0.0;
+  long id = std::lower_bound(this->s_.begin(), this->s_.end(), s_start - lap_offset) - this->s_.begin();
+  poses.push_back(poseAt(s_start));
+  for (; id < 2L * num_wp; id++)
+  {
+    if (id >= num_wp && !this->closed_)
+    {
+      break;
+    }
+    const double s_id = lap_offset + arcLengthAt(id);
+    if (s_id >= s_end)
+    {
+      break;
+    }
+    if (s_id > s_start)
+    {
+      poses.push_back(this->path_[id % num_wp]);
+    }
+  }
+  if (s_end > s_start)
+  {
+    poses.push_back(poseAt(s_end));
+  }
+};
+
+} // namespace me5413_world
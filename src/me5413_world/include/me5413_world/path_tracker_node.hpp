@@ -23,6 +23,7 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/TransformStamped.h>
+#include <std_srvs/Empty.h>
 
 #include <tf2/convert.h>
 #include "angles/angles.h"
@@ -36,12 +37,26 @@
 
 #include <dynamic_reconfigure/server.h>
 #include <me5413_world/path_trackerConfig.h>
+#include <me5413_world/LoadShedding.h>
+#include <me5413_world/CycleTiming.h>
 
 #include "me5413_world/pid.hpp"
+#include "me5413_world/load_shedder.hpp"
+#include "me5413_world/checkpoint.hpp"
+#include "me5413_world/metrics.hpp"
+#include "me5413_world/ros_log_sink.hpp"
 
 namespace me5413_world 
 {
 
+// Controller state saved for warm restarts
+struct TrackerCheckpoint
+{
+  double stamp;
+  double pid_integral;
+  double pid_pre_error;
+};
+
 class PathTrackerNode
 {
  public:
@@ -51,6 +66,14 @@ class PathTrackerNode
  private:
   void robotOdomCallback(const nav_msgs::Odometry::ConstPtr& odom);
   void localPathCallback(const nav_msgs::Path::ConstPtr& path);
+  void speedTargetCallback(const std_msgs::Float32::ConstPtr& speed_target);
+  bool resetCallback(std_srvs::Empty::Request& req, std_srvs::Empty::Response& res);
+  void updateLoadShedding(const double cycle_time);
+  // Ages [s] of the inputs of the cycle, when it started
+  void publishCycleTiming(const double cycle_time, const double local_path_age, const double odom_age);
+  void saveCheckpoint();
+  void restoreCheckpoint();
+  void setupMetrics();
 
   tf2::Transform convertPoseToTransform(const geometry_msgs::Pose& pose);
   geometry_msgs::Twist computeControlOutputs(const nav_msgs::Odometry& odom_robot, const geometry_msgs::Pose& pose_goal);
@@ -62,7 +85,11 @@ class PathTrackerNode
   ros::NodeHandle nh_;
   ros::Subscriber sub_robot_odom_;
   ros::Subscriber sub_local_path_;
+  ros::Subscriber sub_speed_target_;
   ros::Publisher pub_cmd_vel_;
+  ros::Publisher pub_load_shedding_;
+  ros::Publisher pub_cycle_timing_;
+  ros::ServiceServer srv_reset_;
 
   tf2_ros::Buffer tf2_buffer_;
   tf2_ros::TransformListener tf2_listener_;
@@ -76,9 +103,32 @@ class PathTrackerNode
   nav_msgs::Odometry odom_world_robot_;
   geometry_msgs::Pose pose_world_goal_;
 
+  // Speed target of the publisher, on a racing line
+  double speed_target_;
+  ros::Time speed_target_stamp_;
+
   // Controllers
   control::PID pid_;
 
+  // Load shedding
+  LoadShedder load_shedder_;
+
+  // Warm restart
+  Checkpoint<TrackerCheckpoint> checkpoint_;
+  bool checkpoint_restored_;
+  double checkpoint_max_age_;
+
+  // Prometheus metrics, the hot path only updates atomics
+  MetricsRegistry metrics_;
+  MetricsServer metrics_server_;
+  Counter* metric_cycles_;
+  Counter* metric_cycle_overruns_;
+  Histogram* metric_cycle_duration_;
+  Histogram* metric_local_path_bytes_;
+  Gauge* metric_linear_cmd_;
+  Gauge* metric_angular_cmd_;
+  Gauge* metric_shedding_level_;
+
   // std::vector<tf2::Vector3> path_points_;
 };
 
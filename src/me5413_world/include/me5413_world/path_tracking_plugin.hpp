@@ -0,0 +1,98 @@
+/** path_tracking_plugin.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Declarations for PathTrackingPlugin class
+ */
+
+#ifndef PATH_TRACKING_PLUGIN_H_
+#define PATH_TRACKING_PLUGIN_H_
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/common/common.hh>
+#include <gazebo/physics/physics.hh>
+#include <ignition/math/Pose3.hh>
+
+#include "me5413_world/tracking_utils.hpp"
+#include "me5413_world/tracking_pipeline.hpp"
+
+namespace me5413_world
+{
+
+// Runs path generation, progress tracking and control inside Gazebo, without any ROS transport
+class PathTrackingPlugin : public gazebo::ModelPlugin
+{
+ public:
+  PathTrackingPlugin();
+  virtual ~PathTrackingPlugin() {};
+
+  void Load(gazebo::physics::ModelPtr model, sdf::ElementPtr sdf) override;
+
+ private:
+  void onUpdate(const gazebo::common::UpdateInfo& info);
+  void controlStep();
+  void applyCommand(const double linear_speed, const double angular_speed);
+  void finishEpisode();
+  void resetEpisode();
+  Pose2D getRobotPose() const;
+
+  template <typename T>
+  T getParam(const sdf::ElementPtr& sdf, const std::string& name, const T& default_value) const;
+
+  // Gazebo declaration
+  gazebo::physics::ModelPtr model_;
+  gazebo::physics::WorldPtr world_;
+  gazebo::event::ConnectionPtr update_connection_;
+  std::vector<gazebo::physics::JointPtr> left_wheels_;
+  std::vector<gazebo::physics::JointPtr> right_wheels_;
+  ignition::math::Pose3d pose_start_;
+
+  // Track settings
+  double speed_target_;
+  double track_A_axis_;
+  double track_B_axis_;
+  int track_wp_num_;
+  int local_prev_wp_num_;
+
+  // Controller settings
+  double control_period_;
+  double robot_length_;
+  double lookahead_distance_;
+  double wheel_radius_;
+  double wheel_separation_;
+  double pid_Kp_;
+  double pid_Ki_;
+  double pid_Kd_;
+
+  // Episode settings
+  int num_episodes_;
+  double episode_timeout_;
+  std::string results_file_;
+
+  // Controllers
+  PurePursuitPipeline pipeline_;
+
+  // Episode state
+  gazebo::common::Time time_last_control_;
+  gazebo::common::Time time_episode_start_;
+  std::chrono::steady_clock::time_point wall_episode_start_;
+  double linear_cmd_;
+  double angular_cmd_;
+  bool finished_;
+
+  int episode_id_;
+  long long num_time_steps_;
+  double sum_sqr_position_error_;
+  double sum_sqr_heading_error_;
+  double sum_sqr_speed_error_;
+};
+
+} // namespace me5413_world
+
+#endif // PATH_TRACKING_PLUGIN_H_
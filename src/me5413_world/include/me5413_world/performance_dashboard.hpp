@@ -0,0 +1,141 @@
+/** performance_dashboard.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Declarations for the PerformanceDashboard rqt plugin
+ */
+
+#ifndef PERFORMANCE_DASHBOARD_H_
+#define PERFORMANCE_DASHBOARD_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <ros/ros.h>
+#include <std_msgs/Float32.h>
+#include <geometry_msgs/Twist.h>
+#include <me5413_world/CycleTiming.h>
+#include <me5413_world/LoadShedding.h>
+#include <me5413_world/RtfGovernorStatus.h>
+
+#include <rqt_gui_cpp/plugin.h>
+#include <QWidget>
+#include <QString>
+#include <QTimer>
+#include <QLabel>
+#include <QComboBox>
+#include <QCheckBox>
+
+#include "me5413_world/rolling_histogram.hpp"
+
+namespace me5413_world
+{
+
+// Bars of a histogram with its percentiles, drawn from a copy of the bins so painting never waits for ROS
+class HistogramPlot : public QWidget
+{
+ public:
+  // Values are displayed multiplied by scale, in unit
+  HistogramPlot(const QString& title, const QString& unit, const double scale, QWidget* parent = nullptr);
+
+  void setData(const RollingHistogram& histogram);
+  // Vertical line at value, e.g. the cycle budget. NaN hides it
+  void setMarker(const double value) { marker_ = value; };
+
+ protected:
+  void paintEvent(QPaintEvent* event) override;
+
+ private:
+  // Horizontal position of value in [0, 1]
+  double position(const double value) const;
+
+  QString title_;
+  QString unit_;
+  double scale_;
+  std::vector<uint32_t> bins_;
+  double min_value_;
+  double max_value_;
+  bool log_scale_;
+  size_t count_;
+  double p50_, p95_, p99_;
+  double marker_;
+};
+
+// Rolling histograms of the callback durations, message ages, control rate and tracking errors.
+// ROS callbacks only bin one sample, and the plots are refreshed from a Qt timer when their bins changed
+class PerformanceDashboard : public rqt_gui_cpp::Plugin
+{
+  Q_OBJECT
+
+ public:
+  PerformanceDashboard();
+  virtual ~PerformanceDashboard() {};
+
+  void initPlugin(qt_gui_cpp::PluginContext& context) override;
+  void shutdownPlugin() override;
+  void saveSettings(qt_gui_cpp::Settings& plugin_settings, qt_gui_cpp::Settings& instance_settings) const override;
+  void restoreSettings(const qt_gui_cpp::Settings& plugin_settings, const qt_gui_cpp::Settings& instance_settings) override;
+
+ private slots:
+  void refresh();
+  void windowChanged(int index);
+
+ private:
+  enum PanelId
+  {
+    TRACKER_CYCLE = 0,
+    PUBLISHER_CYCLE,
+    LOCAL_PATH_AGE,
+    ODOM_AGE,
+    CONTROL_RATE,
+    POSITION_ERROR,
+    HEADING_ERROR,
+    SPEED_ERROR,
+    NUM_PANELS
+  };
+
+  struct Panel
+  {
+    RollingHistogram histogram;
+    HistogramPlot* plot;
+    uint64_t shown_version;
+    double marker;
+  };
+
+  void addPanel(const PanelId id, const QString& title, const QString& unit, const double scale, const RollingHistogram& histogram);
+  void addSample(const PanelId id, const double value);
+
+  void cycleTimingCallback(const me5413_world::CycleTiming::ConstPtr& timing);
+  void loadSheddingCallback(const me5413_world::LoadShedding::ConstPtr& load_shedding);
+  void rtfGovernorCallback(const me5413_world::RtfGovernorStatus::ConstPtr& status);
+  void cmdVelCallback(const geometry_msgs::Twist::ConstPtr& cmd_vel);
+  void errorCallback(const std_msgs::Float32::ConstPtr& error, const PanelId id);
+
+  // ROS declaration
+  std::vector<ros::Subscriber> subs_;
+
+  // Qt widgets, owned by widget_
+  QWidget* widget_;
+  QLabel* status_label_;
+  QComboBox* window_box_;
+  QCheckBox* pause_box_;
+  QTimer* timer_;
+
+  // Shared with the ROS callbacks
+  std::mutex mutex_;
+  std::vector<Panel> panels_;
+  std::map<std::string, int> shedding_levels_;   // by node, from the cycle timing
+  std::map<std::string, int> num_transitions_;   // by node, from the load shedding transitions
+  me5413_world::RtfGovernorStatus rtf_status_;
+  bool rtf_received_;
+  ros::Time last_cmd_vel_time_;
+};
+
+} // namespace me5413_world
+
+#endif // PERFORMANCE_DASHBOARD_H_
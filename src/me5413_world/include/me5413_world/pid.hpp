@@ -4,74 +4,110 @@
  * 
  * MIT License
  * 
- * Implementation of PID controller
+ * Implementation of PID controller, templated on the scalar type
  */
 
 #pragma once
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 namespace control
 {
-class PID
+template <typename T>
+class BasicPID
 {
  public:
-  PID() {};
-  PID(double dt, double max, double min, double Kp, double Kd, double Ki);
-  ~PID() {};
-
-  void updateSettings(const double Kp, const double Kd, const double Ki);
+  BasicPID() {};
+  BasicPID(T dt, T max, T min, T Kp, T Kd, T Ki);
+  ~BasicPID() {};
+
+  void updateSettings(const T Kp, const T Kd, const T Ki);
+  // Clears the integral and the previous error
+  void reset();
+  // Internal state, to checkpoint and restore the controller
+  T getIntegral() const { return integral_; };
+  T getPreviousError() const { return pre_error_; };
+  // Terms of the last output, for tracing
+  T getPTerm() const { return P_term_; };
+  T getITerm() const { return I_term_; };
+  T getDTerm() const { return D_term_; };
+  void setState(const T integral, const T pre_error);
   // Returns the manipulated variable given a setpoint and current process value
-  double calculate(const double setpoint, const double pv);
+  T calculate(const T setpoint, const T pv);
 
  private:
-  double dt_;
-  double max_;
-  double min_;
-  double Kp_;
-  double Kd_;
-  double Ki_;
-  double pre_error_;
-  double integral_;
+  T dt_;
+  T max_;
+  T min_;
+  T Kp_;
+  T Kd_;
+  T Ki_;
+  T pre_error_;
+  T integral_;
+  T P_term_;
+  T I_term_;
+  T D_term_;
 };
+typedef BasicPID<double> PID;
 
-PID::PID(double dt, double max, double min, double Kp, double Kd, double Ki) :
+template <typename T>
+BasicPID<T>::BasicPID(T dt, T max, T min, T Kp, T Kd, T Ki) :
   dt_(dt),
   max_(max),
   min_(min),
   Kp_(Kp),
   Kd_(Kd),
   Ki_(Ki),
-  pre_error_(0),
-  integral_(0) 
+  pre_error_(0.0),
+  integral_(0.0),
+  P_term_(0.0),
+  I_term_(0.0),
+  D_term_(0.0)
 {};
 
-void PID::updateSettings(const double Kp, const double Kd, const double Ki)
+template <typename T>
+void BasicPID<T>::updateSettings(const T Kp, const T Kd, const T Ki)
 {
   this->Kp_ = Kp;
   this->Kd_ = Kd;
   this->Ki_ = Ki;
 };
 
-double PID::calculate(const double setpoint, const double pv)
+template <typename T>
+void BasicPID<T>::reset()
+{
+  this->pre_error_ = T(0.0);
+  this->integral_ = T(0.0);
+};
+
+template <typename T>
+void BasicPID<T>::setState(const T integral, const T pre_error)
+{
+  this->integral_ = integral;
+  this->pre_error_ = pre_error;
+};
+
+template <typename T>
+T BasicPID<T>::calculate(const T setpoint, const T pv)
 {
   // Calculate error
-  double error = setpoint - pv;
+  T error = setpoint - pv;
 
   // Proportional term
-  const double P_term = Kp_ * error;
+  const T P_term = Kp_ * error;
 
   // Integral term
   integral_ += error * dt_;
-  const double I_term = Ki_ * integral_;
+  const T I_term = Ki_ * integral_;
 
   // Derivative term
-  const double derivative = (error - pre_error_) / dt_;
-  const double D_term = Kd_ * derivative;
+  const T derivative = (error - pre_error_) / dt_;
+  const T D_term = Kd_ * derivative;
 
   // Calculate total output
-  double output = P_term + I_term + D_term;
+  T output = P_term + I_term + D_term;
 
   // Restrict to max/min
   output = std::min(output, max_);
@@ -79,6 +115,9 @@ double PID::calculate(const double setpoint, const double pv)
 
   // Save error to previous error
   pre_error_ = error;
+  P_term_ = P_term;
+  I_term_ = I_term;
+  D_term_ = D_term;
 
   return output;
 };
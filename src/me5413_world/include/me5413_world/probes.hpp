@@ -0,0 +1,36 @@
+/** probes.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * USDT (SystemTap / bpftrace / perf) static probes of the provider me5413_world.
+ * A probe is a single nop until a tracer attaches, and compiles to nothing without sys/sdt.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef ME5413_WITH_USDT
+#include <sys/sdt.h>
+#define ME5413_PROBE1(name, a1) STAP_PROBE1(me5413_world, name, a1)
+#define ME5413_PROBE2(name, a1, a2) STAP_PROBE2(me5413_world, name, a1, a2)
+#define ME5413_PROBE3(name, a1, a2, a3) STAP_PROBE3(me5413_world, name, a1, a2, a3)
+#else
+#define ME5413_PROBE1(name, a1) do {} while (0)
+#define ME5413_PROBE2(name, a1, a2) do {} while (0)
+#define ME5413_PROBE3(name, a1, a2, a3) do {} while (0)
+#endif
+
+namespace me5413_world
+{
+
+// Tracers only read integer arguments reliably, so real values are passed in millionths (um, udeg, urad/s, ...)
+inline int64_t toProbeMicro(const double x)
+{
+  return std::isfinite(x)? int64_t(std::llround(x * 1e6)) : 0;
+}
+
+} // namespace me5413_world
@@ -0,0 +1,85 @@
+/** racing_line.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Minimum curvature racing line within a corridor around a closed centreline, and its speed profile
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+// Cholesky factorization of a symmetric positive definite matrix whose non-zeros are within bandwidth of the
+// diagonal, wrapping around the corners as for a closed path. The wrapped corners only fill the last bandwidth
+// rows of the factor, so factorizing and solving both take O(n bandwidth^2)
+class CyclicBandedCholesky
+{
+ public:
+  CyclicBandedCholesky() : size_(0), bandwidth_(0) {};
+
+  // band[i * (bandwidth + 1) + k] is A(i, (i + k) % n), for k in [0, bandwidth]. Returns false if A is not
+  // positive definite or n <= 2 * bandwidth
+  bool factorize(const int n, const int bandwidth, const std::vector<double>& band);
+  // Solves A x = b in place
+  void solve(std::vector<double>& x) const;
+
+  int size() const { return size_; };
+
+ private:
+  // Entry (i, j) of the factor, j <= i
+  double& factor(const int i, const int j);
+  double factor(const int i, const int j) const;
+
+  int size_;
+  int bandwidth_;
+  std::vector<double> band_;    // rows before the last bandwidth ones: L(i, i - k) at i * (bandwidth + 1) + k
+  std::vector<double> border_;  // last bandwidth rows, dense: L(n - bandwidth + r, j) at r * n + j
+};
+
+struct RacingLineOptions
+{
+  double corridor_width = 1.0;      // [m] the line stays within half of it on each side of the centreline
+  double max_speed = 1.0;           // [m/s]
+  double max_lateral_accel = 0.5;   // [m/s^2]
+  double max_accel = 0.5;           // [m/s^2]
+  double max_decel = 0.5;           // [m/s^2]
+  double knot_spacing = 0.25;       // [m] between the optimized offsets, interpolated in between
+  int max_iterations = 100;         // of the primal-dual QP solver, each one factorizes a banded system
+};
+
+struct RacingLine
+{
+  std::vector<Pose2D> path;         // one waypoint per waypoint of the centreline
+  std::vector<double> speeds;       // [m/s] at every waypoint
+  std::vector<double> offsets;      // [m] from the centreline, positive to the left
+  double max_curvature = 0.0;       // [1/m]
+  double lap_time = 0.0;            // [s] following the speed profile
+  double centreline_max_curvature = 0.0;
+  double centreline_lap_time = 0.0; // [s] with the same limits on the centreline
+  double length_weight = 0.0;       // [1/m^2] of the length against the curvature, for the fastest lap
+  int num_iterations = 0;
+  bool converged = false;           // the optimality conditions hold, otherwise the best feasible offsets found
+};
+
+// Offsets of the closed centreline along its normals minimizing the integral of the squared curvature of the line
+// plus a weight times its length, both to second order around the centreline. The QP with box constraints is solved
+// by a primal-dual active set method, where every iteration factorizes a cyclic pentadiagonal system in O(n), and
+// finished by a primal active set method if the active sets cycle. A few weights are tried, from the pure minimum
+// curvature line to the shortest one, and the line of the fastest lap under the speed profile is kept. The last
+// waypoint may repeat the first one, as in createLemniscatePath
+bool optimizeRacingLine(const std::vector<Pose2D>& centreline, const RacingLineOptions& options, RacingLine& line,
+                        std::string& error);
+
+// Fastest speeds along a closed path under the lateral and longitudinal acceleration limits
+std::vector<double> computeSpeedProfile(const std::vector<Pose2D>& path, const RacingLineOptions& options);
+double computeLapTime(const std::vector<Pose2D>& path, const std::vector<double>& speeds);
+
+} // namespace me5413_world
@@ -0,0 +1,185 @@
+/** rolling_histogram.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Histogram of the samples of the last few seconds, updated incrementally for live displays
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+// Fixed bins over [min_value, max_value], linear or logarithmic, out of range samples go to the first or last bin.
+// Each sample is binned once when it is added and unbinned when it leaves the window, so adding is O(1) amortized
+// and reading the bins or a percentile never touches the samples
+class RollingHistogram
+{
+ public:
+  // capacity bounds the memory: when more samples arrive within the window, the oldest ones leave early
+  RollingHistogram(const double min_value = 0.0, const double max_value = 1.0, const int num_bins = 50,
+                   const bool log_scale = false, const double window = 10.0, const size_t capacity = 4096);
+  ~RollingHistogram() {};
+
+  void add(const double time, const double value);
+  // Drops the samples older than now - window
+  void expire(const double now);
+  void clear();
+  void setWindow(const double window) { window_ = window; };
+
+  // Value below which a fraction q of the samples in the window fall, interpolated within its bin
+  double percentile(const double q) const;
+  double binEdge(const int bin) const;
+
+  const std::vector<uint32_t>& bins() const { return bins_; };
+  size_t count() const { return size_; };
+  double window() const { return window_; };
+  double minValue() const { return min_value_; };
+  double maxValue() const { return max_value_; };
+  bool logScale() const { return log_scale_; };
+  // Changes whenever the bins change, so that a display can skip redrawing
+  uint64_t version() const { return version_; };
+
+ private:
+  struct Sample
+  {
+    double time;
+    int bin;
+  };
+
+  int binOf(const double value) const;
+  void popOldest();
+
+  double min_value_;
+  double max_value_;
+  bool log_scale_;
+  double window_;
+  double scale_;  // bins per unit, or per unit of log
+  std::vector<uint32_t> bins_;
+  std::vector<Sample> ring_;
+  size_t head_;  // oldest sample
+  size_t size_;
+  double last_time_;
+  uint64_t version_;
+};
+
+inline RollingHistogram::RollingHistogram(const double min_value, const double max_value, const int num_bins,
+                                          const bool log_scale, const double window, const size_t capacity) :
+  min_value_(min_value),
+  max_value_(std::max(max_value, min_value)),
+  log_scale_(log_scale && min_value > 0.0),
+  window_(window),
+  bins_(std::max(num_bins, 1), 0),
+  ring_(std::max(capacity, size_t(1))),
+  head_(0),
+  size_(0),
+  last_time_(-INFINITY),
+  version_(0)
+{
+  const double span = this->log_scale_? std::log(this->max_value_ / this->min_value_) : this->max_value_ - this->min_value_;
+  this->scale_ = (span > 0.0)? this->bins_.size() / span : 0.0;
+};
+
+inline int RollingHistogram::binOf(const double value) const
+{
+  const double offset = this->log_scale_? std::log(std::max(value, this->min_value_) / this->min_value_) : value - this->min_value_;
+  const double bin = std::floor(offset * this->scale_);
+  if (!(bin > 0.0))
+  {
+    return 0;  // NaN included
+  }
+
+  return int(std::min(bin, double(this->bins_.size() - 1)));
+};
+
+inline double RollingHistogram::binEdge(const int bin) const
+{
+  if (this->scale_ <= 0.0)
+  {
+    return this->min_value_;
+  }
+
+  return this->log_scale_? this->min_value_ * std::exp(bin / this->scale_) : this->min_value_ + bin / this->scale_;
+};
+
+inline void RollingHistogram::popOldest()
+{
+  this->bins_[this->ring_[this->head_].bin]--;
+  this->head_ = (this->head_ + 1) % this->ring_.size();
+  this->size_--;
+};
+
+inline void RollingHistogram::add(const double time, const double value)
+{
+  // The clock went back, after a simulation reset or a bag loop
+  if (time < this->last_time_)
+  {
+    clear();
+  }
+  this->last_time_ = time;
+
+  if (this->size_ == this->ring_.size())
+  {
+    popOldest();
+  }
+  const int bin = binOf(value);
+  this->ring_[(this->head_ + this->size_) % this->ring_.size()] = Sample{time, bin};
+  this->bins_[bin]++;
+  this->size_++;
+  this->version_++;
+};
+
+inline void RollingHistogram::expire(const double now)
+{
+  const size_t size = this->size_;
+  while (this->size_ > 0 && this->ring_[this->head_].time < now - this->window_)
+  {
+    popOldest();
+  }
+  if (this->size_ != size)
+  {
+    this->version_++;
+  }
+};
+
+inline void RollingHistogram::clear()
+{
+  std::fill(this->bins_.begin(), this->bins_.end(), 0);
+  this->head_ = 0;
+  this->size_ = 0;
+  this->last_time_ = -INFINITY;
+  this->version_++;
+};
+
+inline double RollingHistogram::percentile(const double q) const
+{
+  if (this->size_ == 0)
+  {
+    return NAN;
+  }
+
+  const double rank = std::min(std::max(q, 0.0), 1.0) * this->size_;
+  double below = 0.0;
+  for (size_t i = 0; i < this->bins_.size(); i++)
+  {
+    if (this->bins_[i] > 0 && below + this->bins_[i] >= rank)
+    {
+      const double ratio = (rank - below) / this->bins_[i];
+      const double lower = binEdge(i);
+      const double upper = binEdge(i + 1);
+      return this->log_scale_? lower * std::pow(upper / lower, ratio) : lower + ratio * (upper - lower);
+    }
+    below += this->bins_[i];
+  }
+
+  return this->max_value_;
+};
+
+} // namespace me5413_world
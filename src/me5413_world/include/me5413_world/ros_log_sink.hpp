@@ -0,0 +1,41 @@
+/** ros_log_sink.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Sink of the asynchronous logger into rosconsole, so its records also reach /rosout
+ */
+
+#pragma once
+
+#include <string>
+
+#include <ros/ros.h>
+#include <ros/console.h>
+
+#include "me5413_world/async_log.hpp"
+
+namespace me5413_world
+{
+
+inline void rosLogSink(const LogLevel level, const std::string& line)
+{
+  switch (level)
+  {
+    case LogLevel::Debug:
+      ROS_DEBUG("%s", line.c_str());
+      break;
+    case LogLevel::Info:
+      ROS_INFO("%s", line.c_str());
+      break;
+    case LogLevel::Warn:
+      ROS_WARN("%s", line.c_str());
+      break;
+    case LogLevel::Error:
+      ROS_ERROR("%s", line.c_str());
+      break;
+  }
+};
+
+} // namespace me5413_world
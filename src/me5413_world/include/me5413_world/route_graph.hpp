@@ -0,0 +1,179 @@
+/** route_graph.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Topological route graph of a site, with shortest path queries and the stitching of routes into a path
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+struct RoutePoint
+{
+  double x;
+  double y;
+};
+
+struct RouteNode
+{
+  std::string name;
+  double x;
+  double y;
+};
+
+// Directed arc, a two-way edge gives two arcs sharing the same geometry
+struct RouteArc
+{
+  int from;
+  int to;
+  double length;    // [m] along the geometry, never shorter than the straight line, so A* stays exact
+  int first_point;  // geometry between the two nodes, excluding them, in RouteGraph::points()
+  int num_points;
+  bool reversed;    // the geometry is walked backwards
+};
+
+// Sequence of arcs from a node to another
+struct Route
+{
+  std::vector<int> arcs;
+  double length = 0.0;
+};
+
+// Nodes and arcs, with the outgoing arcs of each node stored contiguously once finalize() is called
+class RouteGraph
+{
+ public:
+  RouteGraph() : finalized_(false) {};
+
+  // Returns the id of the node, or -1 if the name is taken
+  int addNode(const std::string& name, const double x, const double y);
+  // Edge through the intermediate points, in both directions unless one_way. Returns false for unknown nodes
+  bool addEdge(const int from, const int to, const std::vector<RoutePoint>& via, const bool one_way);
+  // Builds the adjacency, needed before any query
+  void finalize();
+
+  int findNode(const std::string& name) const;
+  int numNodes() const { return nodes_.size(); };
+  int numArcs() const { return arcs_.size(); };
+  const RouteNode& node(const int id) const { return nodes_[id]; };
+  const RouteArc& arc(const int id) const { return arcs_[id]; };
+  const std::vector<RoutePoint>& points() const { return points_; };
+
+  // Outgoing arcs of a node, as arc ids in [outBegin, outEnd) of outArcs()
+  int outBegin(const int node) const { return out_offsets_[node]; };
+  int outEnd(const int node) const { return out_offsets_[node + 1]; };
+  const std::vector<int>& outArcs() const { return out_arcs_; };
+
+ private:
+  std::vector<RouteNode> nodes_;
+  std::vector<RouteArc> arcs_;
+  std::vector<RoutePoint> points_;
+  std::unordered_map<std::string, int> node_ids_;
+  std::vector<int> out_offsets_;
+  std::vector<int> out_arcs_;
+  bool finalized_;
+};
+
+// Reads a route graph, one declaration per line, '#' starts a comment:
+//   node <name> <x> <y>
+//   edge <from> <to> [oneway] [<x> <y> ...]   intermediate points of the geometry, in order from <from>
+bool loadRouteGraph(const std::string& file_path, RouteGraph& graph, std::string& error);
+
+// Dijkstra and A* on a finalized graph. The search state is reused and reset lazily, so a query only touches
+// the nodes it visits
+class RouteSearch
+{
+ public:
+  explicit RouteSearch(const RouteGraph& graph);
+
+  // Both return false if the target cannot be reached
+  bool dijkstra(const int source, const int target, Route& route);
+  // Straight line distance as the heuristic
+  bool astar(const int source, const int target, Route& route);
+
+  int numSettled() const { return num_settled_; };
+
+ private:
+  bool search(const int source, const int target, const bool use_heuristic, Route& route);
+
+  const RouteGraph& graph_;
+  std::vector<double> dist_;
+  std::vector<int> parent_arc_;
+  std::vector<uint32_t> visited_;  // search in which dist_ and parent_arc_ were last set
+  std::vector<std::pair<double, int>> heap_;
+  uint32_t search_id_;
+  int num_settled_;
+};
+
+// Contraction hierarchy: nodes are contracted one by one, from the least important, adding shortcut arcs that
+// keep the shortest distances between the remaining nodes. A query is then a bidirectional Dijkstra that only
+// climbs the hierarchy, and settles a small fraction of the nodes a plain Dijkstra would
+class ContractionHierarchy
+{
+ public:
+  ContractionHierarchy() : graph_(nullptr), num_original_arcs_(0), search_id_(0), num_settled_(0) {};
+
+  // Preprocesses a finalized graph, which must outlive the hierarchy
+  void build(const RouteGraph& graph);
+  bool query(const int source, const int target, Route& route);
+
+  bool empty() const { return rank_.empty(); };
+  int numShortcuts() const { return int(arcs_.size()) - num_original_arcs_; };
+  int numSettled() const { return num_settled_; };
+
+ private:
+  struct Arc
+  {
+    int from;
+    int to;
+    double length;
+    int child_first;   // shortcuts: the two arcs it replaces, -1 for an arc of the graph
+    int child_second;
+  };
+
+  struct UpwardArc
+  {
+    int head;  // higher ranked node
+    double length;
+    int arc;
+  };
+
+  // Search state of one direction
+  struct Direction
+  {
+    std::vector<double> dist;
+    std::vector<int> parent_arc;
+    std::vector<uint32_t> visited;
+    std::vector<std::pair<double, int>> heap;
+  };
+
+  void unpack(const int arc, std::vector<int>& graph_arcs) const;
+
+  const RouteGraph* graph_;
+  std::vector<Arc> arcs_;
+  int num_original_arcs_;
+  std::vector<int> rank_;
+  std::vector<int> up_offsets_[2];  // forward: arcs to higher ranks, backward: reversed arcs from higher ranks
+  std::vector<UpwardArc> up_arcs_[2];
+  Direction directions_[2];
+  uint32_t search_id_;
+  int num_settled_;
+};
+
+// Poses along the legs of a mission one after the other, one every spacing [m] and oriented towards the next one,
+// like the waypoints of the lemniscate track
+std::vector<Pose2D> stitchRoutes(const RouteGraph& graph, const std::vector<Route>& legs, const double spacing);
+
+} // namespace me5413_world
@@ -0,0 +1,70 @@
+/** rtf_governor_node.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Declarations for RtfGovernorNode class
+ */
+
+#ifndef RTF_GOVERNOR_NODE_H_
+#define RTF_GOVERNOR_NODE_H_
+
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <gazebo_msgs/GetPhysicsProperties.h>
+#include <gazebo_msgs/SetPhysicsProperties.h>
+#include <me5413_world/RtfGovernorStatus.h>
+
+#include "me5413_world/load_shedder.hpp"
+
+namespace me5413_world
+{
+
+// One rung of the ladder of physics settings, from the most accurate to the cheapest
+struct PhysicsSettings
+{
+  double max_step_size;  // [s]
+  int solver_iterations;
+};
+
+class RtfGovernorNode
+{
+ public:
+  RtfGovernorNode();
+  virtual ~RtfGovernorNode() {};
+
+ private:
+  void timerCallback(const ros::WallTimerEvent&);
+  bool readPhysics();
+  void buildLadder(const double min_step_size, const double max_step_size, const int min_iterations, const int max_iterations);
+  bool applySettings(const int level);
+  void startWindow();
+  double gazeboCpuTime() const;
+
+  // ROS declaration
+  ros::NodeHandle nh_;
+  ros::WallTimer timer_;
+  ros::Publisher pub_status_;
+  ros::ServiceClient client_get_physics_;
+  ros::ServiceClient client_set_physics_;
+
+  // Settings
+  double target_rtf_;
+  double tolerance_;
+  gazebo_msgs::GetPhysicsProperties::Response physics_;  // as found at startup, only the step, rate and iterations are changed
+  std::vector<PhysicsSettings> ladder_;
+  LoadShedder shedder_;
+
+  // Current measurement window
+  int gazebo_pid_;
+  ros::Time window_sim_start_;
+  ros::WallTime window_wall_start_;
+  double window_cpu_start_;  // [s] CPU time of gzserver, negative if it cannot be read
+};
+
+} // namespace me5413_world
+
+#endif // RTF_GOVERNOR_NODE_H_
@@ -0,0 +1,107 @@
+/** thread_pool.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Work-stealing thread pool with parallel-for and task graph APIs, one per process
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+namespace me5413_world
+{
+
+struct WorkerStats
+{
+  uint64_t num_tasks;   // tasks executed
+  uint64_t num_steals;  // tasks taken from the queue of another worker
+  double busy_time;     // [s] spent executing tasks
+};
+
+class ThreadPool
+{
+ public:
+  // num_threads <= 0 uses all hardware threads, worker i is pinned to cpus[i % cpus.size()] if cpus is not empty
+  explicit ThreadPool(const int num_threads = 0, const std::vector<int>& cpus = std::vector<int>());
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Pool shared by the whole process, created on first use with
+  // ME5413_NUM_THREADS workers pinned to ME5413_CPU_AFFINITY (e.g. "0,2,4") if set
+  static ThreadPool& global();
+
+  // Queues a task, on the queue of the calling worker if called from inside a task
+  void submit(std::function<void()> task);
+  // Calls body(chunk_begin, chunk_end) on chunks of at most grain_size indices, returns when all are done.
+  // The calling thread works on the chunks too, so nested calls from inside a task do not deadlock.
+  // The first exception thrown by body is rethrown once all chunks are done
+  void parallelFor(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body);
+  // Runs one queued task on the calling thread, returns false if there was none
+  bool runPendingTask();
+
+  int size() const { return workers_.size(); };
+  std::vector<WorkerStats> stats() const;
+  void resetStats();
+
+ private:
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;  // owner works at the back, thieves steal from the front
+    std::thread thread;
+    std::atomic<uint64_t> num_tasks;
+    std::atomic<uint64_t> num_steals;
+    std::atomic<uint64_t> busy_ns;
+  };
+
+  void workerLoop(const int id);
+  // Own queue first (LIFO, cache-warm), then steal the oldest task of another worker
+  bool popTask(const int id, std::function<void()>& task, bool& stolen);
+  void execute(const int id, std::function<void()>& task, const bool stolen);
+  // Index of the calling thread in this pool, -1 for outside threads
+  int workerId() const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  std::atomic<int> num_pending_;
+  std::atomic<unsigned> next_queue_;
+  bool stopping_;
+};
+
+// Tasks with dependencies, each runs as soon as all its dependencies are done
+class TaskGraph
+{
+ public:
+  TaskGraph() {};
+  ~TaskGraph() {};
+
+  // Returns the id of the new task
+  int addTask(std::function<void()> task);
+  // Task after only starts once task before is done
+  void addDependency(const int before, const int after);
+  // Runs every task on the pool and returns when all are done, the graph can be run again.
+  // Returns false without running anything if the dependencies have a cycle, rethrows the first exception of a task
+  bool run(ThreadPool& pool = ThreadPool::global());
+
+  int size() const { return tasks_.size(); };
+
+ private:
+  std::vector<std::function<void()>> tasks_;
+  std::vector<std::vector<int>> successors_;
+  std::vector<int> num_dependencies_;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,163 @@
+/** timer_wheel.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Hashed timer wheel for scheduling large numbers of delayed items
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+// Items are hashed by their due tick into num_slots slots, so scheduling is O(1) and advancing by one tick
+// only visits one slot. Items due in a later turn of the wheel wait in the slot. Items are due at the end
+// of their tick, and the ones due at the same tick fire in the order they were scheduled
+template <class T>
+class TimerWheel
+{
+ public:
+  TimerWheel(const double tick = 0.001, const int num_slots = 1024);
+  ~TimerWheel() {};
+
+  // Empties the wheel and starts it at start_time, otherwise it starts at the first time it is advanced or scheduled
+  void reset(const double start_time);
+  // Items due before the last advance fire at the next one, so advance to now before scheduling
+  void schedule(const double time, T item);
+  // Fires fire(item) for every item due by now
+  template <class F>
+  void advance(const double now, F&& fire);
+  // Fires every item in due order, whatever the time
+  template <class F>
+  void flush(F&& fire);
+
+  size_t size() const { return size_; };
+  bool empty() const { return size_ == 0; };
+  double tick() const { return tick_; };
+
+ private:
+  struct Entry
+  {
+    uint64_t tick;
+    T item;
+  };
+
+  template <class F>
+  void fireSlot(const uint64_t tick, F& fire);
+
+  double tick_;
+  std::vector<std::vector<Entry>> slots_;
+  bool started_;
+  double start_time_;
+  uint64_t next_tick_;  // first tick not processed yet
+  size_t size_;
+};
+
+template <class T>
+TimerWheel<T>::TimerWheel(const double tick, const int num_slots) :
+  tick_(tick),
+  slots_(std::max(num_slots, 1)),
+  started_(false),
+  start_time_(0.0),
+  next_tick_(0),
+  size_(0)
+{};
+
+template <class T>
+void TimerWheel<T>::reset(const double start_time)
+{
+  for (std::vector<Entry>& slot : this->slots_)
+  {
+    slot.clear();
+  }
+  this->started_ = true;
+  this->start_time_ = start_time;
+  this->next_tick_ = 0;
+  this->size_ = 0;
+};
+
+template <class T>
+void TimerWheel<T>::schedule(const double time, T item)
+{
+  if (!this->started_)
+  {
+    reset(time);
+  }
+
+  // Never before the next tick to process, so that nothing is missed
+  const double ticks = std::ceil((time - this->start_time_) / this->tick_);
+  const uint64_t tick = std::max(static_cast<uint64_t>(std::max(ticks, 0.0)), this->next_tick_);
+  this->slots_[tick % this->slots_.size()].push_back(Entry{tick, std::move(item)});
+  this->size_++;
+};
+
+template <class T>
+template <class F>
+void TimerWheel<T>::advance(const double now, F&& fire)
+{
+  if (!this->started_)
+  {
+    reset(now);
+  }
+  const double elapsed = std::floor((now - this->start_time_) / this->tick_);
+  if (elapsed < 0.0)
+  {
+    return;
+  }
+
+  // Visit the ticks one by one while anything is scheduled, an empty wheel jumps straight to now
+  const uint64_t last_tick = static_cast<uint64_t>(elapsed);
+  while (this->next_tick_ <= last_tick && this->size_ > 0)
+  {
+    fireSlot(this->next_tick_, fire);
+    this->next_tick_++;
+  }
+  this->next_tick_ = std::max(this->next_tick_, last_tick + 1);
+};
+
+template <class T>
+template <class F>
+void TimerWheel<T>::flush(F&& fire)
+{
+  while (this->size_ > 0)
+  {
+    fireSlot(this->next_tick_, fire);
+    this->next_tick_++;
+  }
+};
+
+template <class T>
+template <class F>
+void TimerWheel<T>::fireSlot(const uint64_t tick, F& fire)
+{
+  // Fire the entries of this turn in order, and keep the ones of later turns
+  std::vector<Entry>& slot = this->slots_[tick % this->slots_.size()];
+  size_t num_kept = 0;
+  for (size_t i = 0; i < slot.size(); i++)
+  {
+    if (slot[i].tick <= tick)
+    {
+      fire(slot[i].item);
+      this->size_--;
+    }
+    else
+    {
+      if (num_kept != i)
+      {
+        slot[num_kept] = std::move(slot[i]);
+      }
+      num_kept++;
+    }
+  }
+  slot.erase(slot.begin() + num_kept, slot.end());
+};
+
+} // namespace me5413_world
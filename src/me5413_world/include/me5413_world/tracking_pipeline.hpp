@@ -0,0 +1,223 @@
+/** tracking_pipeline.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Tracking cycle assembled at compile time from policies (path source, waypoint projector,
+ * lookahead rule, steering law and speed controller), so the whole cycle can be inlined
+ */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "me5413_world/pid.hpp"
+#include "me5413_world/fixed_point.hpp"
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+// Path source policies, called once to generate the global path
+
+template <typename T>
+struct LemniscatePath
+{
+  LemniscatePath(const double A = 8.0, const double B = 8.0, const int num_wp = 500) : A(A), B(B), num_wp(num_wp) {};
+  std::vector<BasicPose2D<T>> operator()() const { return castPath<T>(createLemniscatePath(A, B, 1.0/num_wp)); };
+
+  double A;
+  double B;
+  int num_wp;
+};
+
+// Waypoint projector policies, return the next waypoint searching forward from id_start
+
+template <typename T>
+struct ForwardSearchProjector
+{
+  int operator()(const BasicPose2D<T>& robot, const BasicPose2D<T>* path, const int num_wp, const int id_start) const
+  {
+    return nextWaypoint(robot, path, num_wp, id_start);
+  };
+};
+
+// Lookahead policies, return the lookahead distance [m] given the forward speed [m/s]
+
+template <typename T>
+struct SpeedScaledLookahead
+{
+  explicit SpeedScaledLookahead(const T gain = T(0.5)) : gain(gain) {};
+  T operator()(const T forward_speed) const { return computeLookaheadDistance(forward_speed, gain); };
+
+  T gain;
+};
+
+template <typename T>
+struct FixedLookahead
+{
+  explicit FixedLookahead(const T distance = T(1.0)) : distance(distance) {};
+  T operator()(const T) const { return distance; };
+
+  T distance;
+};
+
+// Steering policies, return the angular velocity command towards the goal
+
+template <typename T>
+struct PurePursuitSteering
+{
+  explicit PurePursuitSteering(const T robot_length = T(0.5)) : robot_length(robot_length) {};
+  T operator()(const BasicPose2D<T>& robot, const BasicPose2D<T>& goal, const T lookahead_distance) const
+  {
+    return computeSteering(robot, goal, robot_length, lookahead_distance);
+  };
+
+  T robot_length;
+};
+
+template <typename T>
+struct HeadingSteering
+{
+  T operator()(const BasicPose2D<T>& robot, const BasicPose2D<T>& goal, const T) const
+  {
+    return computeHeadingSteering(robot, goal);
+  };
+};
+
+// Speed controller policies, return the linear velocity command
+
+template <typename T>
+struct PIDSpeedController
+{
+  PIDSpeedController(const T dt = T(0.1), const T Kp = T(0.5), const T Ki = T(0.2), const T Kd = T(0.2)) :
+    pid(dt, T(1.0), T(-1.0), Kp, Kd, Ki) {};
+  T operator()(const T speed_target, const T speed) { return pid.calculate(speed_target, speed); };
+  void reset() { pid.reset(); };
+
+  control::BasicPID<T> pid;
+};
+
+// Robot state fed to one cycle
+template <typename T>
+struct TrackingInput
+{
+  BasicPose2D<T> robot;
+  T forward_speed;  // [m/s], along the robot heading, for the lookahead
+  T speed;          // [m/s], norm of the velocity, for the speed controller
+};
+
+// Commands and progress after one cycle
+template <typename T>
+struct TrackingOutput
+{
+  int id_next;
+  int id_goal;
+  int id_metric;  // goal of the error metrics of the path publisher
+  T linear_cmd;
+  T angular_cmd;
+};
+
+template <typename T, typename PathSource, typename Projector, typename Lookahead, typename Steering, typename SpeedController>
+class TrackingPipeline
+{
+ public:
+  TrackingPipeline(const PathSource& path_source = PathSource(), const Projector& projector = Projector(),
+                   const Lookahead& lookahead = Lookahead(), const Steering& steering = Steering(),
+                   const SpeedController& speed_controller = SpeedController(), const int local_prev_wp_num = 10);
+  ~TrackingPipeline() {};
+
+  // Restarts from the first waypoint with a fresh speed controller
+  void reset();
+  // One control cycle, the goal is the waypoint after the robot on the local path (as in path_tracker_node)
+  TrackingOutput<T> step(const TrackingInput<T>& input, const T speed_target);
+  // Consecutive cycles over a batch of inputs, in one loop
+  void run(const TrackingInput<T>* inputs, const int num_inputs, const T speed_target, TrackingOutput<T>* outputs);
+
+  const std::vector<BasicPose2D<T>>& path() const { return path_; };
+  int currentId() const { return current_id_; };
+
+ private:
+  Projector projector_;
+  Lookahead lookahead_;
+  Steering steering_;
+  SpeedController speed_controller_;
+  int local_prev_wp_num_;
+
+  std::vector<BasicPose2D<T>> path_;
+  int current_id_;
+};
+
+template <typename T, typename PathSource, typename Projector, typename Lookahead, typename Steering, typename SpeedController>
+TrackingPipeline<T, PathSource, Projector, Lookahead, Steering, SpeedController>::TrackingPipeline(
+  const PathSource& path_source, const Projector& projector, const Lookahead& lookahead, const Steering& steering,
+  const SpeedController& speed_controller, const int local_prev_wp_num) :
+  projector_(projector),
+  lookahead_(lookahead),
+  steering_(steering),
+  speed_controller_(speed_controller),
+  local_prev_wp_num_(local_prev_wp_num),
+  path_(path_source()),
+  current_id_(0)
+{};
+
+template <typename T, typename PathSource, typename Projector, typename Lookahead, typename Steering, typename SpeedController>
+void TrackingPipeline<T, PathSource, Projector, Lookahead, Steering, SpeedController>::reset()
+{
+  this->current_id_ = 0;
+  this->speed_controller_.reset();
+};
+
+template <typename T, typename PathSource, typename Projector, typename Lookahead, typename Steering, typename SpeedController>
+inline TrackingOutput<T> TrackingPipeline<T, PathSource, Projector, Lookahead, Steering, SpeedController>::step(const TrackingInput<T>& input, const T speed_target)
+{
+  TrackingOutput<T> output;
+  const int num_wp = this->path_.size();
+
+  // Progress along the track
+  output.id_next = this->projector_(input.robot, this->path_.data(), num_wp, this->current_id_);
+  this->current_id_ = std::max(this->current_id_, std::min(output.id_next, num_wp - 1) - 1);
+
+  // Same goal as the local path seen by the tracker node
+  const int id_start = std::max(output.id_next - this->local_prev_wp_num_, 0);
+  output.id_goal = std::min(id_start + this->local_prev_wp_num_ + 1, num_wp - 1);
+  output.id_metric = std::min(metricGoalIndex(output.id_next, this->local_prev_wp_num_, false), num_wp - 1);
+
+  // Compute control outputs
+  output.linear_cmd = this->speed_controller_(speed_target, input.speed);
+  output.angular_cmd = this->steering_(input.robot, this->path_[output.id_goal], this->lookahead_(input.forward_speed));
+
+  return output;
+};
+
+template <typename T, typename PathSource, typename Projector, typename Lookahead, typename Steering, typename SpeedController>
+void TrackingPipeline<T, PathSource, Projector, Lookahead, Steering, SpeedController>::run(const TrackingInput<T>* inputs, const int num_inputs, const T speed_target, TrackingOutput<T>* outputs)
+{
+  for (int i = 0; i < num_inputs; i++)
+  {
+    outputs[i] = step(inputs[i], speed_target);
+  }
+};
+
+// Instantiations compiled once in the me5413_world library
+typedef TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, SpeedScaledLookahead<double>,
+                         PurePursuitSteering<double>, PIDSpeedController<double>> PurePursuitPipeline;
+typedef TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, FixedLookahead<double>,
+                         HeadingSteering<double>, PIDSpeedController<double>> HeadingPipeline;
+typedef TrackingPipeline<float, LemniscatePath<float>, ForwardSearchProjector<float>, SpeedScaledLookahead<float>,
+                         PurePursuitSteering<float>, PIDSpeedController<float>> PurePursuitPipelineF;
+typedef TrackingPipeline<Q16_16, LemniscatePath<Q16_16>, ForwardSearchProjector<Q16_16>, SpeedScaledLookahead<Q16_16>,
+                         PurePursuitSteering<Q16_16>, PIDSpeedController<Q16_16>> PurePursuitPipelineQ16;
+
+extern template class TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, SpeedScaledLookahead<double>,
+                                       PurePursuitSteering<double>, PIDSpeedController<double>>;
+extern template class TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, FixedLookahead<double>,
+                                       HeadingSteering<double>, PIDSpeedController<double>>;
+extern template class TrackingPipeline<float, LemniscatePath<float>, ForwardSearchProjector<float>, SpeedScaledLookahead<float>,
+                                       PurePursuitSteering<float>, PIDSpeedController<float>>;
+extern template class TrackingPipeline<Q16_16, LemniscatePath<Q16_16>, ForwardSearchProjector<Q16_16>, SpeedScaledLookahead<Q16_16>,
+                                       PurePursuitSteering<Q16_16>, PIDSpeedController<Q16_16>>;
+
+} // namespace me5413_world
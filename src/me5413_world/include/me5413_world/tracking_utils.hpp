@@ -0,0 +1,261 @@
+/** tracking_utils.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * ROS-free path generation, waypoint search and control laws, templated on the scalar type,
+ * shared by the ROS nodes and the Gazebo path tracking plugin
+ */
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "me5413_world/math_utils.hpp"
+
+namespace me5413_world
+{
+
+// Planar pose in the world frame
+template <typename T>
+struct BasicPose2D
+{
+  T x;
+  T y;
+  T yaw;
+};
+typedef BasicPose2D<double> Pose2D;
+
+// Pose of the local path the tracker node steers towards
+constexpr int kTrackerGoalIndex = 11;
+
+// Waypoint the path publisher measures the errors against: the pose n_wp_prev into the local path. That is the next
+// waypoint, except on an open track while the local path still starts at the first waypoint
+inline int metricGoalIndex(const int id_next, const int n_wp_prev, const bool wrap)
+{
+  return wrap? id_next : std::max(id_next, n_wp_prev);
+}
+
+// Poses a local path needs to reach both the goal of the tracker and the goal of the metrics
+inline int minLocalPathPoses(const int n_wp_prev)
+{
+  return std::max(kTrackerGoalIndex, n_wp_prev) + 1;
+}
+
+// Convert a pose to another scalar type
+template <typename T, typename U>
+inline BasicPose2D<T> castPose(const BasicPose2D<U>& pose)
+{
+  BasicPose2D<T> result;
+  result.x = T(pose.x);
+  result.y = T(pose.y);
+  result.yaw = T(pose.yaw);
+  return result;
+}
+
+// Convert a path to another scalar type
+template <typename T, typename U>
+inline std::vector<BasicPose2D<T>> castPath(const std::vector<BasicPose2D<U>>& path)
+{
+  std::vector<BasicPose2D<T>> result;
+  result.reserve(path.size());
+  for (const BasicPose2D<U>& pose : path)
+  {
+    result.push_back(castPose<T>(pose));
+  }
+  return result;
+}
+
+// Sample the figure 8 (lemniscate) track, t_res is the fraction of a lap between two waypoints
+inline std::vector<Pose2D> createLemniscatePath(const double A, const double B, const double t_res)
+{
+  std::vector<Pose2D> path;
+  const double t_increament = t_res * 2 * M_PI;
+
+  // Calculate the positions
+  for (double t = 0.0; t <= 2 * M_PI; t += t_increament)
+  {
+    Pose2D wp;
+    wp.x = A * std::sin(t);
+    wp.y = B * std::sin(t) * std::cos(t);
+    wp.yaw = 0.0;
+    path.push_back(wp);
+  }
+
+  // Calcuate the orientations, the last waypoint keeps the heading of the last segment
+  for (int i = 0; i + 1 < int(path.size()); i++)
+  {
+    path[i].yaw = std::atan2(path[i + 1].y - path[i].y, path[i + 1].x - path[i].x);
+  }
+  if (path.size() > 1)
+  {
+    path.back().yaw = path[path.size() - 2].yaw;
+  }
+
+  return path;
+}
+
+// The kernels below are templated on the scalar type, the math functions of FixedPoint are found through ADL
+
+// Cumulative arc length [m] at every waypoint, starting from 0 at the first one
+template <typename T>
+inline void computeArcLength(const BasicPose2D<T>* path, const int num_wp, T* s)
+{
+  using std::hypot;
+  if (num_wp > 0)
+  {
+    s[0] = T(0.0);
+  }
+  for (int i = 1; i < num_wp; i++)
+  {
+    s[i] = s[i - 1] + hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+  }
+}
+
+template <typename T>
+inline std::vector<T> computeArcLength(const std::vector<BasicPose2D<T>>& path)
+{
+  std::vector<T> s(path.size(), T(0.0));
+  computeArcLength(path.data(), path.size(), s.data());
+
+  return s;
+}
+
+// Number of waypoints after id_start needed to cover distance [m], wrapping around a closed path if wrap
+template <typename T>
+inline int countWaypointsAhead(const std::vector<T>& s, const int id_start, const T distance, const bool wrap)
+{
+  const int num_wp = s.size();
+  if (num_wp == 0 || id_start >= num_wp)
+  {
+    return 0;
+  }
+
+  const T s_target = s[id_start] + distance;
+  if (s_target <= s.back() || !wrap)
+  {
+    return std::lower_bound(s.begin() + id_start, s.end(), s_target) - (s.begin() + id_start);
+  }
+
+  // Continue from the start of the next lap, at most one full lap
+  const T s_remaining = std::min(s_target - s.back(), s.back());
+  const int count = (num_wp - id_start) + (std::lower_bound(s.begin(), s.end(), s_remaining) - s.begin());
+  return std::min(count, num_wp);
+}
+
+// Search forward from id_start for the waypoint closest to (x, y), stops at the first local minimum
+template <typename T>
+inline int closestWaypoint(const T x, const T y, const BasicPose2D<T>* path, const int num_wp, const int id_start = 0)
+{
+  using std::hypot;
+  T min_dist = std::numeric_limits<T>::max();
+  int id_closest = id_start;
+  for (int i = id_start; i < num_wp; i++)
+  {
+    const T dist = hypot(x - path[i].x, y - path[i].y);
+
+    if (dist <= min_dist)
+    {
+      min_dist = dist;
+      id_closest = i;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  return id_closest;
+}
+
+template <typename T>
+inline int closestWaypoint(const T x, const T y, const std::vector<BasicPose2D<T>>& path, const int id_start = 0)
+{
+  return closestWaypoint(x, y, path.data(), path.size(), id_start);
+}
+
+// Closest waypoint that is still ahead of the robot
+template <typename T>
+inline int nextWaypoint(const BasicPose2D<T>& robot, const BasicPose2D<T>* path, const int num_wp, const int id_start = 0)
+{
+  using std::atan2;
+  using std::fabs;
+  int id_closest = closestWaypoint(robot.x, robot.y, path, num_wp, id_start);
+  if (id_closest >= num_wp)
+  {
+    return id_closest;
+  }
+
+  const T yaw_T_robot_wp = atan2(path[id_closest].y - robot.y, path[id_closest].x - robot.x);
+  const T angle = fabs(robot.yaw - yaw_T_robot_wp);
+  const T angle_norm = std::min(T(2.0) * pi<T>() - angle, angle);
+
+  if (angle_norm > pi<T>() / T(2.0))
+  {
+    id_closest++;
+  }
+
+  return id_closest;
+}
+
+template <typename T>
+inline int nextWaypoint(const BasicPose2D<T>& robot, const std::vector<BasicPose2D<T>>& path, const int id_start = 0)
+{
+  return nextWaypoint(robot, path.data(), path.size(), id_start);
+}
+
+// Returns the position error [m] and heading error [deg] of the robot wrt the goal
+template <typename T>
+inline std::pair<T, T> calculatePoseError(const BasicPose2D<T>& robot, const BasicPose2D<T>& goal)
+{
+  using std::hypot;
+  using std::isnan;
+  const T position_error = hypot(robot.x - goal.x, robot.y - goal.y);
+  const T heading_error = rad2deg(robot.yaw - goal.yaw);
+
+  return std::pair<T, T>(position_error, isnan(heading_error)? T(0.0) : heading_error);
+}
+
+// Speed-scaled lookahead distance, never shorter than 1.0 [m]
+template <typename T>
+inline T computeLookaheadDistance(const T velocity, const T lookahead_gain)
+{
+  return std::max(T(1.0), velocity * lookahead_gain);
+}
+
+// Pure pursuit steering towards the goal, plus the heading error wrt the goal
+template <typename T>
+inline T computeSteering(const BasicPose2D<T>& robot, const BasicPose2D<T>& goal, const T robot_length, const T lookahead_distance)
+{
+  using std::atan2;
+  using std::sin;
+
+  // Compute heading error
+  const T heading_error = unifyAngleRange(goal.yaw - robot.yaw);
+
+  // Compute the angle towards the goal
+  const T alpha = atan2(goal.y - robot.y, goal.x - robot.x) - robot.yaw;
+
+  // Compute desired steering angle using the pure pursuit formula
+  T steering = atan2(T(2.0) * robot_length * sin(alpha), lookahead_distance);
+
+  // Incorporate heading error
+  steering += heading_error;
+
+  // Ensure steering angle is within [-pi, pi]
+  return unifyAngleRange(steering);
+}
+
+// Cheaper fallback steering, only corrects the heading error wrt the goal
+template <typename T>
+inline T computeHeadingSteering(const BasicPose2D<T>& robot, const BasicPose2D<T>& goal)
+{
+  return unifyAngleRange(goal.yaw - robot.yaw);
+}
+
+} // namespace me5413_world
@@ -0,0 +1,94 @@
+/** trail_buffer.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Fixed-capacity history of the driven poses, decimated by distance and heading change
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "me5413_world/math_utils.hpp"
+
+namespace me5413_world
+{
+
+struct TrailPoint
+{
+  double x, y, yaw;
+  double position_error;  // largest position error since the previous point
+};
+
+// Ring buffer of the last capacity kept poses. Points are indexed by their sequence number,
+// which keeps counting across the wrap-around so that a viewer can tell what changed since its last update
+class TrailBuffer
+{
+ public:
+  TrailBuffer(const int capacity = 2000, const double min_distance = 0.05, const double min_heading_change = deg2rad(5.0));
+  ~TrailBuffer() {};
+
+  // Keeps the pose if it is at least min_distance away from, or turned at least min_heading_change wrt
+  // the last kept pose, O(1). Returns whether it was kept
+  bool addPose(const double x, const double y, const double yaw, const double position_error);
+  void clear();
+
+  int capacity() const { return points_.size(); };
+  int size() const { return std::min<uint64_t>(num_added_, points_.size()); };
+  // Sequence numbers of the oldest point still kept, and one past the newest
+  uint64_t begin() const { return num_added_ - size(); };
+  uint64_t end() const { return num_added_; };
+  const TrailPoint& at(const uint64_t seq) const { return points_[seq % points_.size()]; };
+
+ private:
+  std::vector<TrailPoint> points_;
+  double min_distance_;
+  double min_heading_change_;
+  uint64_t num_added_;
+  double pending_max_error_;
+};
+
+inline TrailBuffer::TrailBuffer(const int capacity, const double min_distance, const double min_heading_change) :
+  points_(std::max(capacity, 2)),
+  min_distance_(min_distance),
+  min_heading_change_(min_heading_change),
+  num_added_(0),
+  pending_max_error_(0.0)
+{};
+
+inline bool TrailBuffer::addPose(const double x, const double y, const double yaw, const double position_error)
+{
+  this->pending_max_error_ = std::max(this->pending_max_error_, std::fabs(position_error));
+  if (this->num_added_ > 0)
+  {
+    const TrailPoint& last = at(this->num_added_ - 1);
+    if (std::hypot(x - last.x, y - last.y) < this->min_distance_ &&
+        std::fabs(unifyAngleRange(yaw - last.yaw)) < this->min_heading_change_)
+    {
+      return false;
+    }
+  }
+
+  TrailPoint& point = this->points_[this->num_added_ % this->points_.size()];
+  point.x = x;
+  point.y = y;
+  point.yaw = yaw;
+  point.position_error = this->pending_max_error_;
+  this->pending_max_error_ = 0.0;
+  this->num_added_++;
+
+  return true;
+};
+
+inline void TrailBuffer::clear()
+{
+  this->num_added_ = 0;
+  this->pending_max_error_ = 0.0;
+};
+
+} // namespace me5413_world
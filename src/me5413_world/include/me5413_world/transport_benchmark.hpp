@@ -0,0 +1,117 @@
+/** transport_benchmark.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Latency and CPU cost of the Path and Odometry traffic of this package, for a given deployment layout
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <ros/ros.h>
+#include <std_msgs/Empty.h>
+#include <std_msgs/Header.h>
+#include <nav_msgs/Path.h>
+#include <nav_msgs/Odometry.h>
+
+namespace me5413_world
+{
+
+// One point of the sweep
+struct TransportCase
+{
+  std::string type;  // "path" or "odometry"
+  int num_poses;
+  double rate;       // [Hz]
+  int bytes;         // serialized size
+};
+
+// Process CPU time [s], covers every thread including the ROS transport ones
+double processCpuTime();
+
+// Counts the messages of each case and their publish-to-receive latency
+class TransportReceiver
+{
+ public:
+  // Subscribes to the benchmark topics unless subscribe is false (direct calls)
+  TransportReceiver(ros::NodeHandle& nh, const std::string& name, const int warmup_messages, const bool subscribe);
+
+  void pathCallback(const nav_msgs::Path::ConstPtr& path);
+  void odomCallback(const nav_msgs::Odometry::ConstPtr& odom);
+  // Results of every case seen so far as a JSON object
+  std::string toJson() const;
+
+ private:
+  struct CaseStats
+  {
+    int case_id;
+    int num_poses;
+    uint64_t count;
+    std::vector<double> latencies;  // [s]
+    double cpu_first, cpu_last;
+    double time_first, time_last;
+  };
+
+  void handle(const std_msgs::Header& header, const int num_poses);
+
+  std::string name_;
+  int warmup_messages_;
+  std::vector<CaseStats> cases_;
+  ros::Subscriber sub_path_;
+  ros::Subscriber sub_odom_;
+};
+
+// Runs the sweep of message sizes and rates, then writes the results and shuts down.
+// Parameters (private): layout (label in the results), role (sender, receiver or direct), num_subscribers,
+// path_sizes, rates, case_duration [s], warmup_messages, output_dir
+class TransportBenchmark
+{
+ public:
+  TransportBenchmark(ros::NodeHandle& nh, ros::NodeHandle& nh_private);
+  virtual ~TransportBenchmark() {};
+
+ private:
+  void timerCallback(const ros::WallTimerEvent&);
+  void doneCallback(const std_msgs::Empty::ConstPtr&);
+  bool subscribersReady() const;
+  void startCase(const int case_id);
+  void send();
+  void finish();
+  void writeResults(const std::string& role, const std::string& json) const;
+  std::string senderJson() const;
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_path_;
+  ros::Publisher pub_odom_;
+  ros::Publisher pub_done_;
+  ros::Subscriber sub_done_;
+  ros::WallTimer timer_;
+
+  std::string name_;
+  std::string layout_;
+  std::string role_;
+  std::string output_dir_;
+  int num_subscribers_;
+  double case_duration_;
+
+  std::vector<TransportCase> cases_;
+  std::vector<uint64_t> num_sent_;
+  std::vector<double> send_cpu_;   // [s] process CPU during each case
+  std::vector<double> send_time_;  // [s] spent inside publish() or the direct calls
+  int case_id_;
+  double case_start_;
+  double case_cpu_start_;
+  nav_msgs::Path path_template_;
+  nav_msgs::Odometry odom_template_;
+  uint64_t index_;
+
+  std::vector<std::unique_ptr<TransportReceiver>> receivers_;
+  bool finished_;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,74 @@
+/** waypoint_error_map.hpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Tracking error statistics accumulated per waypoint of the global path
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace me5413_world
+{
+
+class WaypointErrorMap
+{
+ public:
+  WaypointErrorMap() {};
+  ~WaypointErrorMap() {};
+
+  // Clears the statistics and sizes the map for num_wp waypoints
+  void resize(const int num_wp);
+  // Adds the errors measured wrt waypoint id, O(1)
+  void addSample(const int id, const double position_error, const double heading_error);
+
+  int size() const { return num_samples_.size(); };
+  int numSamples(const int id) const { return num_samples_[id]; };
+  double rmsPositionError(const int id) const;
+  double rmsHeadingError(const int id) const;
+  double maxPositionError(const int id) const { return max_position_error_[id]; };
+
+ private:
+  std::vector<int> num_samples_;
+  std::vector<double> sum_sqr_position_error_;
+  std::vector<double> sum_sqr_heading_error_;
+  std::vector<double> max_position_error_;
+};
+
+inline void WaypointErrorMap::resize(const int num_wp)
+{
+  this->num_samples_.assign(num_wp, 0);
+  this->sum_sqr_position_error_.assign(num_wp, 0.0);
+  this->sum_sqr_heading_error_.assign(num_wp, 0.0);
+  this->max_position_error_.assign(num_wp, 0.0);
+};
+
+inline void WaypointErrorMap::addSample(const int id, const double position_error, const double heading_error)
+{
+  if (id < 0 || id >= size())
+  {
+    return;
+  }
+
+  this->num_samples_[id]++;
+  this->sum_sqr_position_error_[id] += position_error * position_error;
+  this->sum_sqr_heading_error_[id] += heading_error * heading_error;
+  this->max_position_error_[id] = std::max(this->max_position_error_[id], std::fabs(position_error));
+};
+
+inline double WaypointErrorMap::rmsPositionError(const int id) const
+{
+  return this->num_samples_[id] > 0? std::sqrt(this->sum_sqr_position_error_[id]/this->num_samples_[id]) : 0.0;
+};
+
+inline double WaypointErrorMap::rmsHeadingError(const int id) const
+{
+  return this->num_samples_[id] > 0? std::sqrt(this->sum_sqr_heading_error_[id]/this->num_samples_[id]) : 0.0;
+};
+
+} // namespace me5413_world
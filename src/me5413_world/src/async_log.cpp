@@ -0,0 +1,354 @@
+/** async_log.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Implementation of the lock-free log queue and its background writer
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "me5413_world/async_log.hpp"
+
+namespace me5413_world
+{
+
+int64_t logClockNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+LogSite::LogSite(const LogLevel level, const double min_period, const char* file, const int line) :
+  level_(level),
+  min_period_ns_(static_cast<int64_t>(min_period * 1e9)),
+  file_(file),
+  line_(line),
+  last_ns_(INT64_MIN),
+  num_suppressed_(0)
+{};
+
+bool LogSite::admit(const int64_t now_ns)
+{
+  if (this->min_period_ns_ <= 0)
+  {
+    return true;
+  }
+
+  // Only one of several concurrent callers wins the slot
+  int64_t last = this->last_ns_.load(std::memory_order_relaxed);
+  if (last != INT64_MIN && now_ns - last < this->min_period_ns_)
+  {
+    this->num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  if (!this->last_ns_.compare_exchange_strong(last, now_ns, std::memory_order_relaxed))
+  {
+    this->num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  return true;
+};
+
+std::string formatLogRecord(const LogRecord& record)
+{
+  std::string text;
+  char buffer[256];
+  int arg = 0;
+  const char* c = record.format;
+  while (*c != '\0')
+  {
+    if (*c != '%')
+    {
+      text.push_back(*c++);
+      continue;
+    }
+    if (c[1] == '%')
+    {
+      text.push_back('%');
+      c += 2;
+      continue;
+    }
+
+    // Copy flags, width and precision, drop the length modifiers and use the type of the stored argument
+    std::string spec = "%";
+    c++;
+    while (*c != '\0' && std::strchr("-+ #0123456789.", *c) != nullptr)
+    {
+      spec.push_back(*c++);
+    }
+    while (*c != '\0' && std::strchr("hlLqjzt", *c) != nullptr)
+    {
+      c++;
+    }
+    if (*c == '\0')
+    {
+      break;
+    }
+    const char conversion = *c++;
+    if (arg >= record.num_args)
+    {
+      text += "<?>";
+      continue;
+    }
+
+    const LogArg& value = record.args[arg++];
+    const double number = (value.type == LogArg::INT)? static_cast<double>(value.i) : value.d;
+    if (std::strchr("diouxXc", conversion) != nullptr && value.type != LogArg::STRING)
+    {
+      spec += "ll";
+      spec.push_back(conversion == 'c'? 'd' : conversion);
+      const long long integer = (value.type == LogArg::INT)? value.i : static_cast<long long>(value.d);
+      std::snprintf(buffer, sizeof(buffer), spec.c_str(), integer);
+    }
+    else if (std::strchr("fFeEgGaA", conversion) != nullptr && value.type != LogArg::STRING)
+    {
+      spec.push_back(conversion);
+      std::snprintf(buffer, sizeof(buffer), spec.c_str(), number);
+    }
+    else if (value.type == LogArg::STRING)
+    {
+      spec.push_back('s');
+      std::snprintf(buffer, sizeof(buffer), spec.c_str(), value.s != nullptr? value.s : "(null)");
+    }
+    else
+    {
+      std::snprintf(buffer, sizeof(buffer), "<?>");
+    }
+    text += buffer;
+  }
+
+  if (record.num_suppressed > 0)
+  {
+    std::snprintf(buffer, sizeof(buffer), " (%llu similar messages suppressed)", static_cast<unsigned long long>(record.num_suppressed));
+    text += buffer;
+  }
+
+  return text;
+};
+
+// Whether two records come from the same site with the same arguments
+static bool isRepeat(const LogRecord& a, const LogRecord& b)
+{
+  if (a.site != b.site || a.format != b.format || a.num_args != b.num_args)
+  {
+    return false;
+  }
+  for (int i = 0; i < a.num_args; i++)
+  {
+    if (a.args[i].type != b.args[i].type)
+    {
+      return false;
+    }
+    const bool equal = (a.args[i].type == LogArg::INT)? a.args[i].i == b.args[i].i :
+                       (a.args[i].type == LogArg::DOUBLE)? a.args[i].d == b.args[i].d : a.args[i].s == b.args[i].s;
+    if (!equal)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void stderrSink(const LogLevel level, const std::string& line)
+{
+  static const char* kLevelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+  std::cerr << "[" << kLevelNames[static_cast<int>(level)] << "] " << line << std::endl;
+}
+
+AsyncLogger::AsyncLogger(const int capacity, const double dedup_window) :
+  enqueue_pos_(0),
+  dequeue_pos_(0),
+  dedup_window_ns_(static_cast<int64_t>(dedup_window * 1e9)),
+  has_last_(false),
+  num_repeats_(0),
+  last_written_ns_(0),
+  sink_(&stderrSink),
+  num_enqueued_(0),
+  num_dropped_(0),
+  num_suppressed_(0),
+  num_deduplicated_(0),
+  num_written_(0),
+  num_handled_(0),
+  running_(true)
+{
+  size_t size = 2;
+  while (size < size_t(capacity))
+  {
+    size *= 2;
+  }
+  this->mask_ = size - 1;
+  this->cells_.reset(new Cell[size]);
+  for (size_t i = 0; i < size; i++)
+  {
+    this->cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  this->thread_ = std::thread(&AsyncLogger::drainLoop, this);
+};
+
+AsyncLogger::~AsyncLogger()
+{
+  this->running_ = false;
+  this->thread_.join();
+};
+
+AsyncLogger& AsyncLogger::global()
+{
+  static AsyncLogger logger;
+  return logger;
+};
+
+void AsyncLogger::setSink(const LogSink& sink)
+{
+  std::lock_guard<std::mutex> lock(this->sink_mutex_);
+  this->sink_ = sink? sink : LogSink(&stderrSink);
+};
+
+void AsyncLogger::flush()
+{
+  const uint64_t target = this->num_enqueued_.load();
+  while (this->num_handled_.load() < target)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+};
+
+LoggerStats AsyncLogger::stats() const
+{
+  LoggerStats stats;
+  stats.enqueued = this->num_enqueued_.load(std::memory_order_relaxed);
+  stats.dropped = this->num_dropped_.load(std::memory_order_relaxed);
+  stats.suppressed = this->num_suppressed_.load(std::memory_order_relaxed);
+  stats.deduplicated = this->num_deduplicated_.load(std::memory_order_relaxed);
+  stats.written = this->num_written_.load(std::memory_order_relaxed);
+
+  return stats;
+};
+
+bool AsyncLogger::push(const LogRecord& record)
+{
+  // Bounded MPMC queue of D. Vyukov: a cell is free for position pos when its sequence equals pos
+  size_t pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell;
+  while (true)
+  {
+    cell = &this->cells_[pos & this->mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+    if (diff == 0)
+    {
+      if (this->enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      this->num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    else
+    {
+      pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->record = record;
+  this->num_enqueued_.fetch_add(1, std::memory_order_relaxed);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  return true;
+};
+
+bool AsyncLogger::pop(LogRecord& record)
+{
+  Cell* cell = &this->cells_[this->dequeue_pos_ & this->mask_];
+  const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+  if (intptr_t(sequence) - intptr_t(this->dequeue_pos_ + 1) < 0)
+  {
+    return false;
+  }
+
+  record = cell->record;
+  cell->sequence.store(this->dequeue_pos_ + this->mask_ + 1, std::memory_order_release);
+  this->dequeue_pos_++;
+
+  return true;
+};
+
+void AsyncLogger::drainLoop()
+{
+  LogRecord record;
+  while (true)
+  {
+    const bool stopping = !this->running_;
+    bool any = false;
+    while (pop(record))
+    {
+      handle(record);
+      this->num_handled_.fetch_add(1);
+      any = true;
+    }
+
+    // Report pending repeats once the window is over, or at shutdown
+    if (this->num_repeats_ > 0 && (stopping || logClockNow() - this->last_written_ns_ >= this->dedup_window_ns_))
+    {
+      flushRepeats();
+    }
+    if (stopping)
+    {
+      break;
+    }
+    if (!any)
+    {
+      // Polling keeps the producers free of any syscall
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+};
+
+void AsyncLogger::handle(const LogRecord& record)
+{
+  if (this->has_last_ && isRepeat(record, this->last_) && record.stamp_ns - this->last_written_ns_ < this->dedup_window_ns_)
+  {
+    this->num_repeats_++;
+    this->num_deduplicated_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  flushRepeats();
+  write(record.site->level(), formatLogRecord(record));
+  this->last_ = record;
+  this->last_.num_suppressed = 0;
+  this->has_last_ = true;
+  this->last_written_ns_ = record.stamp_ns;
+};
+
+void AsyncLogger::flushRepeats()
+{
+  if (this->num_repeats_ == 0)
+  {
+    return;
+  }
+
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), " (repeated %llu times)", static_cast<unsigned long long>(this->num_repeats_));
+  write(this->last_.site->level(), formatLogRecord(this->last_) + buffer);
+  this->num_repeats_ = 0;
+  this->last_written_ns_ = logClockNow();
+};
+
+void AsyncLogger::write(const LogLevel level, const std::string& line)
+{
+  std::lock_guard<std::mutex> lock(this->sink_mutex_);
+  this->sink_(level, line);
+  this->num_written_.fetch_add(1, std::memory_order_relaxed);
+};
+
+} // namespace me5413_world
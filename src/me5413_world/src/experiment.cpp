@@ -0,0 +1,476 @@
+/** experiment.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Closed-loop tracking episodes and campaign files
+ */
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <fstream>
+
+#include "me5413_world/experiment.hpp"
+#include "me5413_world/math_utils.hpp"
+#include "me5413_world/tracking_utils.hpp"
+#include "me5413_world/tracking_pipeline.hpp"
+
+namespace me5413_world
+{
+
+// Longest episode, in time steps, so that duration / dt always fits in the step counter
+constexpr double kMaxEpisodeSteps = 1e8;
+
+struct SpecField
+{
+  const char* name;
+  double EpisodeSpec::* member;
+};
+
+struct ResultField
+{
+  const char* name;
+  double EpisodeResult::* member;
+};
+
+// Columns are written in this order, after controller and before track_wp_num and seed
+const SpecField kSpecFields[] = {
+  {"speed_target", &EpisodeSpec::speed_target},
+  {"Kp", &EpisodeSpec::Kp},
+  {"Ki", &EpisodeSpec::Ki},
+  {"Kd", &EpisodeSpec::Kd},
+  {"lookahead_gain", &EpisodeSpec::lookahead_gain},
+  {"lookahead_distance", &EpisodeSpec::lookahead_distance},
+  {"robot_length", &EpisodeSpec::robot_length},
+  {"track_A", &EpisodeSpec::track_A},
+  {"track_B", &EpisodeSpec::track_B},
+  {"duration", &EpisodeSpec::duration},
+  {"dt", &EpisodeSpec::dt},
+  {"initial_offset", &EpisodeSpec::initial_offset},
+  {"initial_heading", &EpisodeSpec::initial_heading},
+  {"actuator_lag", &EpisodeSpec::actuator_lag},
+  {"position_noise", &EpisodeSpec::position_noise},
+  {"heading_noise", &EpisodeSpec::heading_noise}
+};
+
+// Written in this order, before num_steps
+const ResultField kResultFields[] = {
+  {"rms_position_error", &EpisodeResult::rms_position_error},
+  {"rms_heading_error", &EpisodeResult::rms_heading_error},
+  {"rms_speed_error", &EpisodeResult::rms_speed_error},
+  {"max_position_error", &EpisodeResult::max_position_error},
+  {"progress", &EpisodeResult::progress},
+  {"lap_time", &EpisodeResult::lap_time},
+  {"wall_time", &EpisodeResult::wall_time}
+};
+
+// Shortest text that reads back to the same double
+std::string formatDouble(const double value)
+{
+  char text[32];
+  for (int precision = 6; precision <= 17; precision++)
+  {
+    std::snprintf(text, sizeof(text), "%.*g", precision, value);
+    if (std::strtod(text, nullptr) == value)
+    {
+      break;
+    }
+  }
+  return text;
+};
+
+bool parseDouble(const std::string& text, double& value)
+{
+  char* end = nullptr;
+  value = std::strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+};
+
+bool parseInteger(const std::string& text, uint64_t& value)
+{
+  char* end = nullptr;
+  value = std::strtoull(text.c_str(), &end, 10);
+  return !text.empty() && *end == '\0' && text[0] != '-';
+};
+
+const char* controllerName(const ControllerType controller)
+{
+  return (controller == ControllerType::Heading)? "heading" : "pure_pursuit";
+};
+
+// Splits key=value pairs separated by spaces, returns false on a token without '='
+bool splitPairs(const std::string& line, std::vector<std::pair<std::string, std::string>>& pairs, std::string& error)
+{
+  pairs.clear();
+  std::istringstream stream(line);
+  std::string token;
+  while (stream >> token)
+  {
+    const size_t equal = token.find('=');
+    if (equal == std::string::npos || equal == 0)
+    {
+      error = "expected key=value, got " + token;
+      return false;
+    }
+    pairs.emplace_back(token.substr(0, equal), token.substr(equal + 1));
+  }
+
+  return true;
+};
+
+std::string joinPairs(const std::vector<std::string>& keys, const std::vector<std::string>& values)
+{
+  std::string line;
+  for (size_t i = 0; i < keys.size(); i++)
+  {
+    line += (i == 0? "" : " ") + keys[i] + "=" + values[i];
+  }
+  return line;
+};
+
+std::vector<std::string> episodeSpecColumns()
+{
+  std::vector<std::string> columns = {"controller"};
+  for (const SpecField& field : kSpecFields)
+  {
+    columns.push_back(field.name);
+  }
+  columns.push_back("track_wp_num");
+  columns.push_back("seed");
+
+  return columns;
+};
+
+std::vector<std::string> episodeSpecValues(const EpisodeSpec& spec)
+{
+  std::vector<std::string> values = {controllerName(spec.controller)};
+  for (const SpecField& field : kSpecFields)
+  {
+    values.push_back(formatDouble(spec.*field.member));
+  }
+  values.push_back(std::to_string(spec.track_wp_num));
+  values.push_back(std::to_string(spec.seed));
+
+  return values;
+};
+
+std::vector<std::string> episodeResultColumns()
+{
+  std::vector<std::string> columns;
+  for (const ResultField& field : kResultFields)
+  {
+    columns.push_back(field.name);
+  }
+  columns.push_back("num_steps");
+
+  return columns;
+};
+
+std::vector<std::string> episodeResultValues(const EpisodeResult& result)
+{
+  std::vector<std::string> values;
+  for (const ResultField& field : kResultFields)
+  {
+    values.push_back(formatDouble(result.*field.member));
+  }
+  values.push_back(std::to_string(result.num_steps));
+
+  return values;
+};
+
+std::string formatEpisodeSpec(const EpisodeSpec& spec)
+{
+  return joinPairs(episodeSpecColumns(), episodeSpecValues(spec));
+};
+
+std::string formatEpisodeResult(const EpisodeResult& result)
+{
+  return joinPairs(episodeResultColumns(), episodeResultValues(result));
+};
+
+bool parseEpisodeSpec(const std::string& line, EpisodeSpec& spec, std::string& error)
+{
+  std::vector<std::pair<std::string, std::string>> pairs;
+  if (!splitPairs(line, pairs, error))
+  {
+    return false;
+  }
+
+  for (const std::pair<std::string, std::string>& pair : pairs)
+  {
+    const std::string& key = pair.first;
+    const std::string& value = pair.second;
+    bool found = false;
+    bool valid = true;
+    for (const SpecField& field : kSpecFields)
+    {
+      if (key == field.name)
+      {
+        found = true;
+        valid = parseDouble(value, spec.*field.member);
+        break;
+      }
+    }
+
+    uint64_t integer = 0;
+    if (found)
+    {
+      // One of kSpecFields
+    }
+    else if (key == "controller")
+    {
+      valid = (value == "pure_pursuit" || value == "heading");
+      spec.controller = (value == "heading")? ControllerType::Heading : ControllerType::PurePursuit;
+    }
+    else if (key == "track_wp_num")
+    {
+      valid = parseInteger(value, integer) && integer >= 2 && integer <= 1000000;
+      spec.track_wp_num = int(integer);
+    }
+    else if (key == "seed")
+    {
+      valid = parseInteger(value, spec.seed);
+    }
+    else
+    {
+      error = "unknown key " + key;
+      return false;
+    }
+    if (!valid)
+    {
+      error = "bad value " + value + " for " + key;
+      return false;
+    }
+  }
+  if (!(spec.dt > 0.0) || !(spec.duration >= 0.0))
+  {
+    error = "dt must be positive and duration not negative";
+    return false;
+  }
+  if (!(spec.duration / spec.dt <= kMaxEpisodeSteps))
+  {
+    error = "duration / dt is over the limit of 1e8 steps";
+    return false;
+  }
+
+  return true;
+};
+
+bool parseEpisodeResult(const std::string& line, EpisodeResult& result, std::string& error)
+{
+  std::vector<std::pair<std::string, std::string>> pairs;
+  if (!splitPairs(line, pairs, error))
+  {
+    return false;
+  }
+
+  for (const std::pair<std::string, std::string>& pair : pairs)
+  {
+    bool valid = false;
+    bool found = false;
+    for (const ResultField& field : kResultFields)
+    {
+      if (pair.first == field.name)
+      {
+        found = true;
+        valid = parseDouble(pair.second, result.*field.member);
+        break;
+      }
+    }
+    uint64_t integer = 0;
+    if (!found && pair.first == "num_steps")
+    {
+      found = true;
+      valid = parseInteger(pair.second, integer);
+      result.num_steps = int(integer);
+    }
+    if (!found || !valid)
+    {
+      error = "bad result field " + pair.first + "=" + pair.second;
+      return false;
+    }
+  }
+
+  return true;
+};
+
+bool loadCampaign(const std::string& file_path, std::vector<EpisodeSpec>& specs, std::string& error)
+{
+  std::ifstream file(file_path);
+  if (!file)
+  {
+    error = "cannot open " + file_path;
+    return false;
+  }
+
+  specs.clear();
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line))
+  {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    std::vector<std::pair<std::string, std::string>> pairs;
+    if (!splitPairs(line, pairs, error))
+    {
+      error = file_path + ":" + std::to_string(line_number) + ": " + error;
+      return false;
+    }
+    if (pairs.empty())
+    {
+      continue;
+    }
+
+    // Values of each key, then every combination, the last key varying fastest
+    std::vector<std::vector<std::string>> values(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+      std::stringstream list(pairs[i].second);
+      std::string value;
+      while (std::getline(list, value, ','))
+      {
+        values[i].push_back(value);
+      }
+      if (values[i].empty())
+      {
+        values[i].push_back("");
+      }
+    }
+    std::vector<size_t> choice(pairs.size(), 0);
+    while (true)
+    {
+      std::string episode;
+      for (size_t i = 0; i < pairs.size(); i++)
+      {
+        episode += pairs[i].first + "=" + values[i][choice[i]] + " ";
+      }
+      EpisodeSpec spec;
+      if (!parseEpisodeSpec(episode, spec, error))
+      {
+        error = file_path + ":" + std::to_string(line_number) + ": " + error;
+        return false;
+      }
+      specs.push_back(spec);
+
+      int i = int(pairs.size()) - 1;
+      while (i >= 0 && ++choice[i] == values[i].size())
+      {
+        choice[i] = 0;
+        i--;
+      }
+      if (i < 0)
+      {
+        break;
+      }
+    }
+  }
+
+  return true;
+};
+
+// Gaussian noise from a 64-bit Mersenne Twister with our own transform, whose sequence is fixed by the standard
+class NoiseSource
+{
+ public:
+  explicit NoiseSource(const uint64_t seed) : rng_(seed) {};
+  double normal()
+  {
+    const double u1 = 1.0 - uniform();
+    const double u2 = uniform();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+  };
+
+ private:
+  double uniform() { return (this->rng_() >> 11) * (1.0 / 9007199254740992.0); };
+
+  std::mt19937_64 rng_;
+};
+
+template <typename Pipeline>
+EpisodeResult simulate(Pipeline& pipeline, const EpisodeSpec& spec)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::vector<Pose2D>& path = pipeline.path();
+  const int num_wp = path.size();
+  NoiseSource noise(spec.seed);
+
+  // Start next to the first waypoint, facing the second one
+  Pose2D robot = path.front();
+  const double yaw_start = std::atan2(path[1].y - path[0].y, path[1].x - path[0].x);
+  robot.x -= spec.initial_offset * std::sin(yaw_start);
+  robot.y += spec.initial_offset * std::cos(yaw_start);
+  robot.yaw = unifyAngleRange(yaw_start + deg2rad(spec.initial_heading));
+  double linear = 0.0;
+  double angular = 0.0;
+  const double response = 1.0 - std::exp(-spec.dt / std::max(spec.actuator_lag, 1e-9));
+
+  EpisodeResult result;
+  double sum_sqr_position = 0.0, sum_sqr_heading = 0.0, sum_sqr_speed = 0.0;
+  const int num_steps = int(std::floor(spec.duration / spec.dt));
+  for (int k = 0; k < num_steps; k++)
+  {
+    TrackingInput<double> input;
+    input.robot.x = robot.x + spec.position_noise * noise.normal();
+    input.robot.y = robot.y + spec.position_noise * noise.normal();
+    input.robot.yaw = unifyAngleRange(robot.yaw + deg2rad(spec.heading_noise) * noise.normal());
+    input.forward_speed = linear;
+    input.speed = std::fabs(linear);
+    const TrackingOutput<double> output = pipeline.step(input, spec.speed_target);
+
+    // Errors of the true pose wrt the goal, as the path publisher measures them
+    const std::pair<double, double> errors = calculatePoseError(robot, path[output.id_metric]);
+    const double position_error = errors.first;
+    const double heading_error = errors.second;
+    const double speed_error = std::fabs(linear) - spec.speed_target;
+    sum_sqr_position += position_error * position_error;
+    sum_sqr_heading += heading_error * heading_error;
+    sum_sqr_speed += speed_error * speed_error;
+    result.max_position_error = std::max(result.max_position_error, position_error);
+    result.progress = std::max(result.progress, double(std::min(output.id_next, num_wp - 1)) / (num_wp - 1));
+    result.num_steps = k + 1;
+    if (output.id_next >= num_wp - 1)
+    {
+      result.lap_time = (k + 1) * spec.dt;
+      break;
+    }
+
+    // Unicycle with lagged velocities
+    linear += response * (output.linear_cmd - linear);
+    angular += response * (output.angular_cmd - angular);
+    robot.x += linear * std::cos(robot.yaw) * spec.dt;
+    robot.y += linear * std::sin(robot.yaw) * spec.dt;
+    robot.yaw = unifyAngleRange(robot.yaw + angular * spec.dt);
+  }
+
+  if (result.num_steps > 0)
+  {
+    result.rms_position_error = std::sqrt(sum_sqr_position / result.num_steps);
+    result.rms_heading_error = std::sqrt(sum_sqr_heading / result.num_steps);
+    result.rms_speed_error = std::sqrt(sum_sqr_speed / result.num_steps);
+  }
+  result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return result;
+};
+
+EpisodeResult runEpisode(const EpisodeSpec& spec)
+{
+  const LemniscatePath<double> track(spec.track_A, spec.track_B, spec.track_wp_num);
+  const PIDSpeedController<double> speed_controller(spec.dt, spec.Kp, spec.Ki, spec.Kd);
+  if (spec.controller == ControllerType::Heading)
+  {
+    HeadingPipeline pipeline(track, ForwardSearchProjector<double>(), FixedLookahead<double>(spec.lookahead_distance),
+                             HeadingSteering<double>(), speed_controller);
+    return simulate(pipeline, spec);
+  }
+  PurePursuitPipeline pipeline(track, ForwardSearchProjector<double>(), SpeedScaledLookahead<double>(spec.lookahead_gain),
+                               PurePursuitSteering<double>(spec.robot_length), speed_controller);
+  return simulate(pipeline, spec);
+};
+
+} // namespace me5413_world
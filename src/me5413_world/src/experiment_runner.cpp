@@ -0,0 +1,950 @@
+/** experiment_runner.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Runs a campaign of closed-loop tracking episodes on a pool of worker processes. The coordinator hands
+ * one episode at a time to each worker over a Unix socket (or TCP for workers on other machines), retries
+ * the episodes of workers that crash or time out, and appends every result to a CSV file as soon as it
+ * arrives, so an interrupted campaign resumes where it stopped
+ */
+
+#include <set>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "me5413_world/experiment.hpp"
+
+namespace me5413_world
+{
+
+constexpr int kDefaultRetries = 2;
+constexpr double kDefaultTimeout = 600.0;  // [s] per episode
+constexpr double kConnectTimeout = 10.0;   // [s] a worker keeps trying to reach the coordinator
+constexpr int kPollPeriod = 100;           // [ms] between checks of the children and the timeouts
+
+volatile std::sig_atomic_t interrupted = 0;
+
+void onInterrupt(int)
+{
+  interrupted = 1;
+};
+
+double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+// Newline-terminated text messages over a stream socket
+class LineChannel
+{
+ public:
+  explicit LineChannel(const int fd = -1) : fd_(fd) {};
+  ~LineChannel() { close(); };
+  LineChannel(const LineChannel&) = delete;
+  LineChannel& operator=(const LineChannel&) = delete;
+
+  int fd() const { return fd_; };
+  // Blocks until the whole line is written, returns false if the peer is gone
+  bool send(const std::string& line);
+  // Reads what is available, blocking if nothing is, returns false on end of stream or error
+  bool receive();
+  // Pops the next complete line, without its newline
+  bool nextLine(std::string& line);
+  void close();
+
+ private:
+  int fd_;
+  std::string buffer_;
+};
+
+bool LineChannel::send(const std::string& line)
+{
+  const std::string message = line + "\n";
+  size_t sent = 0;
+  while (sent < message.size())
+  {
+    const ssize_t n = ::send(this->fd_, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      return false;
+    }
+    sent += n;
+  }
+
+  return true;
+};
+
+bool LineChannel::receive()
+{
+  char data[4096];
+  ssize_t n;
+  do
+  {
+    n = ::recv(this->fd_, data, sizeof(data), 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0)
+  {
+    return false;
+  }
+  this->buffer_.append(data, n);
+
+  return true;
+};
+
+bool LineChannel::nextLine(std::string& line)
+{
+  const size_t end = this->buffer_.find('\n');
+  if (end == std::string::npos)
+  {
+    return false;
+  }
+  line = this->buffer_.substr(0, end);
+  this->buffer_.erase(0, end + 1);
+
+  return true;
+};
+
+void LineChannel::close()
+{
+  if (this->fd_ >= 0)
+  {
+    ::close(this->fd_);
+    this->fd_ = -1;
+  }
+};
+
+// "unix:/path/to/socket" or "host:port"
+bool isUnixAddress(const std::string& address)
+{
+  return address.compare(0, 5, "unix:") == 0;
+};
+
+int listenUnix(const std::string& path)
+{
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+  {
+    return -1;
+  }
+  std::strcpy(addr.sun_path, path.c_str());
+  ::unlink(path.c_str());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 64) != 0)
+  {
+    if (fd >= 0) ::close(fd);
+    return -1;
+  }
+
+  return fd;
+};
+
+int listenTcp(const int port)
+{
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  const int reuse = 1;
+  if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+      ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 64) != 0)
+  {
+    if (fd >= 0) ::close(fd);
+    return -1;
+  }
+
+  return fd;
+};
+
+int connectAddress(const std::string& address)
+{
+  if (isUnixAddress(address))
+  {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const std::string path = address.substr(5);
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+      return -1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos)
+  {
+    return -1;
+  }
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* results = nullptr;
+  if (::getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &results) != 0)
+  {
+    return -1;
+  }
+  int fd = -1;
+  for (addrinfo* result = results; result != nullptr && fd < 0; result = result->ai_next)
+  {
+    fd = ::socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol);
+    if (fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) != 0)
+    {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  ::freeaddrinfo(results);
+  if (fd >= 0)
+  {
+    const int no_delay = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  }
+
+  return fd;
+};
+
+std::string hostName()
+{
+  char name[256] = "localhost";
+  ::gethostname(name, sizeof(name) - 1);
+  return name;
+};
+
+// Worker: HELLO, then RESULT or ERROR for each EPISODE received, until QUIT or the coordinator goes away
+
+int runWorker(const std::string& address)
+{
+  int fd = -1;
+  const double deadline = now() + kConnectTimeout;
+  while ((fd = connectAddress(address)) < 0 && now() < deadline && !interrupted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  if (fd < 0)
+  {
+    std::fprintf(stderr, "Worker %d failed to connect to %s\n", int(::getpid()), address.c_str());
+    return 1;
+  }
+
+  LineChannel channel(fd);
+  if (!channel.send("HELLO " + hostName() + ":" + std::to_string(::getpid())))
+  {
+    return 0;
+  }
+  std::string line;
+  while (!interrupted)
+  {
+    if (!channel.nextLine(line))
+    {
+      if (!channel.receive())
+      {
+        return 0;
+      }
+      continue;
+    }
+    if (line == "QUIT")
+    {
+      return 0;
+    }
+
+    // EPISODE <index> <spec>
+    std::istringstream message(line);
+    std::string command, index;
+    message >> command >> index;
+    std::string spec_line;
+    std::getline(message, spec_line);
+    EpisodeSpec spec;
+    std::string error;
+    if (command != "EPISODE" || !parseEpisodeSpec(spec_line, spec, error))
+    {
+      if (!channel.send("ERROR " + index + " " + (error.empty()? "unexpected message" : error)))
+      {
+        return 0;
+      }
+      continue;
+    }
+    const EpisodeResult result = runEpisode(spec);
+    if (!channel.send("RESULT " + index + " " + formatEpisodeResult(result)))
+    {
+      return 0;
+    }
+  }
+
+  return 0;
+};
+
+// Runs num_workers workers and restarts the ones that crash, for the machines joining a remote coordinator
+int superviseWorkers(const std::string& address, const int num_workers)
+{
+  std::set<pid_t> children;
+  int num_restarts = 0;
+  auto spawn = [&]()
+  {
+    const pid_t pid = ::fork();
+    if (pid == 0)
+    {
+      std::signal(SIGINT, SIG_DFL);
+      std::signal(SIGTERM, SIG_DFL);
+      std::_Exit(runWorker(address));
+    }
+    if (pid > 0)
+    {
+      children.insert(pid);
+    }
+  };
+  for (int i = 0; i < num_workers; i++)
+  {
+    spawn();
+  }
+
+  while (!children.empty())
+  {
+    int status = 0;
+    const pid_t pid = ::waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      if (errno == EINTR && interrupted)
+      {
+        for (const pid_t child : children) ::kill(child, SIGTERM);
+      }
+      if (errno != EINTR) break;
+      continue;
+    }
+    children.erase(pid);
+    const bool crashed = WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+    if (crashed && !interrupted && num_restarts < 100 * num_workers)
+    {
+      std::fprintf(stderr, "Worker %d crashed, restarting it\n", int(pid));
+      num_restarts++;
+      spawn();
+    }
+  }
+
+  return 0;
+};
+
+// Coordinator
+
+struct CoordinatorOptions
+{
+  std::string campaign_file;
+  std::string results_file;
+  int num_workers = 0;      // local workers, 0 for none
+  std::string socket_path;  // of the local workers
+  int listen_port = 0;      // for remote workers, 0 for none
+  int retries = kDefaultRetries;
+  double timeout = kDefaultTimeout;
+};
+
+class Coordinator
+{
+ public:
+  explicit Coordinator(const CoordinatorOptions& options) :
+    options_(options), listen_unix_fd_(-1), listen_tcp_fd_(-1), results_(nullptr),
+    num_in_flight_(0), num_done_(0), num_failed_(0), num_respawns_(0), max_respawns_(0), last_report_(0.0) {};
+  ~Coordinator();
+
+  int run();
+
+ private:
+  struct Episode
+  {
+    EpisodeSpec spec;
+    std::string line;
+    int attempts;
+  };
+
+  struct Connection
+  {
+    std::unique_ptr<LineChannel> channel;
+    std::string name;     // host:pid
+    pid_t local_pid;      // child of this process, -1 otherwise
+    int episode;          // in flight, -1 if idle
+    double assigned_time;
+  };
+
+  bool openResults(std::set<std::string>& done);
+  void spawnWorker();
+  void accept(const int listen_fd);
+  // Returns false once the connection must be dropped
+  bool handleLine(Connection& connection, const std::string& line);
+  void assign(Connection& connection);
+  void drop(const size_t id, const std::string& reason);
+  void finish(const int episode, const std::string& status, const std::string& worker, const EpisodeResult* result);
+  void reapChildren();
+  void checkTimeouts();
+  void report(const bool force);
+
+  CoordinatorOptions options_;
+  std::vector<Episode> episodes_;
+  std::deque<int> pending_;
+  std::vector<Connection> connections_;
+  std::set<pid_t> children_;
+  int listen_unix_fd_;
+  int listen_tcp_fd_;
+  FILE* results_;
+  int num_in_flight_;
+  int num_done_;
+  int num_failed_;
+  int num_respawns_;
+  int max_respawns_;
+  double start_time_;
+  double last_report_;
+};
+
+Coordinator::~Coordinator()
+{
+  for (Connection& connection : this->connections_)
+  {
+    connection.channel->close();
+  }
+  if (this->listen_unix_fd_ >= 0)
+  {
+    ::close(this->listen_unix_fd_);
+    ::unlink(this->options_.socket_path.c_str());
+  }
+  if (this->listen_tcp_fd_ >= 0)
+  {
+    ::close(this->listen_tcp_fd_);
+  }
+  if (this->results_ != nullptr)
+  {
+    std::fclose(this->results_);
+  }
+};
+
+std::vector<std::string> splitCsv(const std::string& line)
+{
+  std::vector<std::string> values;
+  std::stringstream stream(line);
+  std::string value;
+  while (std::getline(stream, value, ','))
+  {
+    values.push_back(value);
+  }
+  return values;
+};
+
+std::string joinCsv(const std::vector<std::string>& values)
+{
+  std::string line;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    line += (i == 0? "" : ",") + values[i];
+  }
+  return line;
+};
+
+bool Coordinator::openResults(std::set<std::string>& done)
+{
+  const std::vector<std::string> spec_columns = episodeSpecColumns();
+  std::vector<std::string> header = {"status", "attempts", "worker"};
+  header.insert(header.end(), spec_columns.begin(), spec_columns.end());
+  const std::vector<std::string> result_columns = episodeResultColumns();
+  header.insert(header.end(), result_columns.begin(), result_columns.end());
+
+  // Episodes completed by a previous run, whatever the order of its columns
+  std::ifstream previous(this->options_.results_file);
+  std::string line;
+  const bool has_header = static_cast<bool>(std::getline(previous, line));
+  if (has_header)
+  {
+    const std::vector<std::string> columns = splitCsv(line);
+    std::vector<int> spec_ids;
+    for (const std::string& name : spec_columns)
+    {
+      const int id = std::find(columns.begin(), columns.end(), name) - columns.begin();
+      if (id == int(columns.size()))
+      {
+        std::fprintf(stderr, "%s has no column %s, use another results file\n", this->options_.results_file.c_str(), name.c_str());
+        return false;
+      }
+      spec_ids.push_back(id);
+    }
+    while (std::getline(previous, line))
+    {
+      const std::vector<std::string> values = splitCsv(line);
+      if (values.size() != columns.size() || values[0] != "ok")
+      {
+        continue;  // failed, or cut short by a crash
+      }
+      std::vector<std::string> spec_values;
+      for (const int id : spec_ids)
+      {
+        spec_values.push_back(values[id]);
+      }
+      done.insert(joinCsv(spec_values));
+    }
+  }
+  previous.close();
+
+  this->results_ = std::fopen(this->options_.results_file.c_str(), "ae");
+  if (this->results_ == nullptr)
+  {
+    std::fprintf(stderr, "Failed to open %s: %s\n", this->options_.results_file.c_str(), std::strerror(errno));
+    return false;
+  }
+  // A line cut short by a crash is skipped above, start on a fresh line after it
+  if (has_header && std::ftell(this->results_) > 0)
+  {
+    std::ifstream tail(this->options_.results_file, std::ios::binary | std::ios::ate);
+    tail.seekg(-1, std::ios::end);
+    if (tail.get() != '\n')
+    {
+      std::fputc('\n', this->results_);
+    }
+  }
+  if (!has_header)
+  {
+    std::fprintf(this->results_, "%s\n", joinCsv(header).c_str());
+    std::fflush(this->results_);
+  }
+
+  return true;
+};
+
+void Coordinator::spawnWorker()
+{
+  // A fresh image, so that the worker holds none of the sockets and files of the coordinator
+  const std::string address = "unix:" + this->options_.socket_path;
+  const pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    ::execl("/proc/self/exe", "experiment_runner", "--worker", address.c_str(), static_cast<char*>(nullptr));
+    std::_Exit(127);
+  }
+  if (pid < 0)
+  {
+    std::fprintf(stderr, "Failed to start a worker: %s\n", std::strerror(errno));
+    return;
+  }
+  this->children_.insert(pid);
+};
+
+void Coordinator::accept(const int listen_fd)
+{
+  const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0)
+  {
+    return;
+  }
+  Connection connection;
+  connection.channel.reset(new LineChannel(fd));
+  connection.local_pid = -1;
+  connection.episode = -1;
+  connection.assigned_time = 0.0;
+  this->connections_.push_back(std::move(connection));
+};
+
+bool Coordinator::handleLine(Connection& connection, const std::string& line)
+{
+  std::istringstream message(line);
+  std::string command;
+  message >> command;
+  if (command == "HELLO")
+  {
+    message >> connection.name;
+    const size_t colon = connection.name.rfind(':');
+    const pid_t pid = (colon == std::string::npos)? -1 : std::atoi(connection.name.c_str() + colon + 1);
+    connection.local_pid = (this->children_.count(pid) > 0 && connection.name.substr(0, colon) == hostName())? pid : -1;
+    assign(connection);
+    return true;
+  }
+
+  int episode = -1;
+  message >> episode;
+  if (episode != connection.episode || episode < 0)
+  {
+    std::fprintf(stderr, "Unexpected message from %s: %s\n", connection.name.c_str(), line.c_str());
+    return false;
+  }
+  std::string text;
+  std::getline(message, text);
+  connection.episode = -1;
+  this->num_in_flight_--;
+
+  EpisodeResult result;
+  std::string error;
+  if (command == "RESULT" && parseEpisodeResult(text, result, error))
+  {
+    finish(episode, "ok", connection.name, &result);
+  }
+  else
+  {
+    // The spec itself is wrong for this worker, retrying would fail the same way
+    std::fprintf(stderr, "Episode %d failed on %s: %s\n", episode, connection.name.c_str(), (error.empty()? text : error).c_str());
+    finish(episode, "failed", connection.name, nullptr);
+  }
+  assign(connection);
+
+  return true;
+};
+
+void Coordinator::assign(Connection& connection)
+{
+  if (this->pending_.empty() || interrupted)
+  {
+    return;
+  }
+  const int episode = this->pending_.front();
+  this->pending_.pop_front();
+  this->episodes_[episode].attempts++;
+  connection.episode = episode;
+  connection.assigned_time = now();
+  this->num_in_flight_++;
+  // A failed send shows up as the end of the stream at the next poll
+  connection.channel->send("EPISODE " + std::to_string(episode) + " " + this->episodes_[episode].line);
+};
+
+void Coordinator::drop(const size_t id, const std::string& reason)
+{
+  Connection& connection = this->connections_[id];
+  const int episode = connection.episode;
+  if (episode >= 0)
+  {
+    this->num_in_flight_--;
+    if (this->episodes_[episode].attempts > this->options_.retries)
+    {
+      std::fprintf(stderr, "Episode %d failed on %s (%s), giving up after %d attempts\n",
+                   episode, connection.name.c_str(), reason.c_str(), this->episodes_[episode].attempts);
+      finish(episode, "failed", connection.name, nullptr);
+    }
+    else
+    {
+      std::fprintf(stderr, "Episode %d failed on %s (%s), retrying\n", episode, connection.name.c_str(), reason.c_str());
+      this->pending_.push_front(episode);
+    }
+  }
+  if (connection.local_pid > 0 && reason == "timeout")
+  {
+    ::kill(connection.local_pid, SIGKILL);
+  }
+  connection.channel->close();
+  this->connections_.erase(this->connections_.begin() + id);
+};
+
+void Coordinator::finish(const int episode, const std::string& status, const std::string& worker, const EpisodeResult* result)
+{
+  std::vector<std::string> values = {status, std::to_string(this->episodes_[episode].attempts), worker};
+  const std::vector<std::string> spec_values = episodeSpecValues(this->episodes_[episode].spec);
+  values.insert(values.end(), spec_values.begin(), spec_values.end());
+  const std::vector<std::string> result_values = (result != nullptr)? episodeResultValues(*result) :
+                                                 std::vector<std::string>(episodeResultColumns().size(), "");
+  values.insert(values.end(), result_values.begin(), result_values.end());
+
+  // Flushed at once, so a crash of the coordinator loses at most the episodes in flight
+  std::fprintf(this->results_, "%s\n", joinCsv(values).c_str());
+  std::fflush(this->results_);
+  this->num_done_++;
+  if (status != "ok")
+  {
+    this->num_failed_++;
+  }
+  report(false);
+};
+
+void Coordinator::reapChildren()
+{
+  int status = 0;
+  pid_t pid;
+  while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0)
+  {
+    this->children_.erase(pid);
+    const bool crashed = WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+    const bool work_left = !this->pending_.empty() || this->num_in_flight_ > 0;
+    if (crashed && work_left && !interrupted && this->num_respawns_ < this->max_respawns_)
+    {
+      this->num_respawns_++;
+      spawnWorker();
+    }
+  }
+};
+
+void Coordinator::checkTimeouts()
+{
+  const double time = now();
+  for (size_t i = this->connections_.size(); i-- > 0;)
+  {
+    if (this->connections_[i].episode >= 0 && time - this->connections_[i].assigned_time > this->options_.timeout)
+    {
+      drop(i, "timeout");
+    }
+  }
+};
+
+void Coordinator::report(const bool force)
+{
+  const double time = now();
+  if (!force && time - this->last_report_ < 1.0)
+  {
+    return;
+  }
+  this->last_report_ = time;
+  const double elapsed = std::max(time - this->start_time_, 1e-9);
+  std::printf("[%d/%zu] %d failed, %zu workers, %.1f episodes/s\n", this->num_done_, this->episodes_.size(),
+              this->num_failed_, this->connections_.size(), this->num_done_ / elapsed);
+  std::fflush(stdout);
+};
+
+int Coordinator::run()
+{
+  std::vector<EpisodeSpec> specs;
+  std::string error;
+  if (!loadCampaign(this->options_.campaign_file, specs, error))
+  {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  std::set<std::string> done;
+  if (!openResults(done))
+  {
+    return 1;
+  }
+
+  // Every episode keeps its index in the campaign, the ones already in the results are skipped
+  for (const EpisodeSpec& spec : specs)
+  {
+    Episode episode;
+    episode.spec = spec;
+    episode.line = formatEpisodeSpec(spec);
+    episode.attempts = 0;
+    if (done.count(joinCsv(episodeSpecValues(spec))) == 0)
+    {
+      this->pending_.push_back(this->episodes_.size());
+    }
+    this->episodes_.push_back(episode);
+  }
+  const size_t num_skipped = this->episodes_.size() - this->pending_.size();
+  this->num_done_ = num_skipped;
+  std::printf("%zu episodes, %zu already in %s\n", this->episodes_.size(), num_skipped, this->options_.results_file.c_str());
+  if (this->pending_.empty())
+  {
+    return 0;
+  }
+
+  if (this->options_.num_workers > 0 && (this->listen_unix_fd_ = listenUnix(this->options_.socket_path)) < 0)
+  {
+    std::fprintf(stderr, "Failed to listen on %s: %s\n", this->options_.socket_path.c_str(), std::strerror(errno));
+    return 1;
+  }
+  if (this->options_.listen_port > 0 && (this->listen_tcp_fd_ = listenTcp(this->options_.listen_port)) < 0)
+  {
+    std::fprintf(stderr, "Failed to listen on port %d: %s\n", this->options_.listen_port, std::strerror(errno));
+    return 1;
+  }
+  this->max_respawns_ = this->options_.num_workers + this->pending_.size() * (this->options_.retries + 1);
+  for (int i = 0; i < this->options_.num_workers; i++)
+  {
+    spawnWorker();
+  }
+
+  this->start_time_ = now();
+  while (!interrupted && (!this->pending_.empty() || this->num_in_flight_ > 0))
+  {
+    // Without local workers left nor a way for remote ones to join, the rest cannot run
+    if (this->children_.empty() && this->connections_.empty() && this->listen_tcp_fd_ < 0)
+    {
+      std::fprintf(stderr, "No workers left, %zu episodes not run\n", this->pending_.size());
+      break;
+    }
+
+    std::vector<pollfd> fds;
+    for (const int fd : {this->listen_unix_fd_, this->listen_tcp_fd_})
+    {
+      fds.push_back(pollfd{fd, POLLIN, 0});  // negative fds are ignored
+    }
+    for (const Connection& connection : this->connections_)
+    {
+      fds.push_back(pollfd{connection.channel->fd(), POLLIN, 0});
+    }
+    if (::poll(fds.data(), fds.size(), kPollPeriod) < 0 && errno != EINTR)
+    {
+      std::fprintf(stderr, "poll failed: %s\n", std::strerror(errno));
+      break;
+    }
+
+    // Connections first, from the last one so that dropping one does not shift the others
+    for (size_t i = this->connections_.size(); i-- > 0;)
+    {
+      if (fds[2 + i].revents == 0)
+      {
+        continue;
+      }
+      Connection& connection = this->connections_[i];
+      bool alive = connection.channel->receive();
+      std::string line;
+      while (alive && connection.channel->nextLine(line))
+      {
+        alive = handleLine(connection, line);
+      }
+      if (!alive)
+      {
+        drop(i, "connection lost");
+      }
+    }
+    for (int i = 0; i < 2; i++)
+    {
+      if (fds[i].revents & POLLIN)
+      {
+        accept(fds[i].fd);
+      }
+    }
+    reapChildren();
+    checkTimeouts();
+  }
+
+  report(true);
+
+  // Let the workers go, the episodes still pending run on the next invocation
+  for (Connection& connection : this->connections_)
+  {
+    connection.channel->send("QUIT");
+    connection.channel->close();
+  }
+  this->connections_.clear();
+  for (const pid_t pid : this->children_)
+  {
+    if (interrupted)
+    {
+      ::kill(pid, SIGTERM);
+    }
+    ::waitpid(pid, nullptr, 0);
+  }
+  this->children_.clear();
+
+  return (this->pending_.empty() && this->num_in_flight_ == 0 && this->num_failed_ == 0)? 0 : 2;
+};
+
+void printUsage(const char* program)
+{
+  std::printf("Usage: %s [options] campaign.txt results.csv\n"
+              "       %s --worker ADDRESS [--workers N]\n"
+              "  --workers N  local worker processes (default: one per hardware thread)\n"
+              "  --socket P   Unix socket of the local workers (default /tmp/me5413_experiment_<pid>.sock)\n"
+              "  --listen P   also accept workers from other machines on TCP port P\n"
+              "  --retries R  retries of an episode whose worker crashed or timed out (default %d)\n"
+              "  --timeout S  seconds before a worker is considered stuck on an episode (default %g)\n"
+              "  --worker A   run as a worker of the coordinator at A: unix:/path or host:port\n",
+              program, program, kDefaultRetries, kDefaultTimeout);
+};
+
+} // namespace me5413_world
+
+int main(int argc, char** argv)
+{
+  using namespace me5413_world;
+
+  CoordinatorOptions options;
+  options.num_workers = std::max(1u, std::thread::hardware_concurrency());
+  options.socket_path = "/tmp/me5413_experiment_" + std::to_string(::getpid()) + ".sock";
+  std::string worker_address;
+  bool workers_set = false;
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = (i + 1 < argc);
+    if (arg == "--workers" && has_value)
+    {
+      options.num_workers = std::atoi(argv[++i]);
+      workers_set = true;
+    }
+    else if (arg == "--socket" && has_value)
+    {
+      options.socket_path = argv[++i];
+    }
+    else if (arg == "--listen" && has_value)
+    {
+      options.listen_port = std::atoi(argv[++i]);
+    }
+    else if (arg == "--retries" && has_value)
+    {
+      options.retries = std::atoi(argv[++i]);
+    }
+    else if (arg == "--timeout" && has_value)
+    {
+      options.timeout = std::atof(argv[++i]);
+    }
+    else if (arg == "--worker" && has_value)
+    {
+      worker_address = argv[++i];
+    }
+    else if (options.campaign_file.empty() && arg[0] != '-')
+    {
+      options.campaign_file = arg;
+    }
+    else if (options.results_file.empty() && arg[0] != '-')
+    {
+      options.results_file = arg;
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // A worker dies on Ctrl-C, its episode is lost anyway
+  std::signal(SIGPIPE, SIG_IGN);
+  if (!worker_address.empty() && !workers_set)
+  {
+    return runWorker(worker_address);
+  }
+
+  // The coordinator stops handing out episodes, the results so far stay in the file
+  std::signal(SIGINT, onInterrupt);
+  std::signal(SIGTERM, onInterrupt);
+  if (!worker_address.empty())
+  {
+    return superviseWorkers(worker_address, options.num_workers);
+  }
+  if (options.campaign_file.empty() || options.results_file.empty() || (options.num_workers <= 0 && options.listen_port <= 0))
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  Coordinator coordinator(options);
+  return coordinator.run();
+}
@@ -0,0 +1,200 @@
+/** impairment_relay_nodelet.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Nodelet relaying topics of any type through a degraded link, to test the nodes against late,
+ * jittery, reordered or lost messages
+ */
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <topic_tools/shape_shifter.h>
+
+#include "me5413_world/timer_wheel.hpp"
+#include "me5413_world/network_impairment.hpp"
+
+namespace me5413_world
+{
+
+class ImpairmentRelayNodelet : public nodelet::Nodelet
+{
+ private:
+  struct Relay
+  {
+    std::string input;
+    std::string output;
+    ros::Subscriber sub;
+    ros::Publisher pub;
+    bool advertised;
+    ImpairmentModel model;
+  };
+
+  struct DelayedMessage
+  {
+    Relay* relay;
+    topic_tools::ShapeShifter::ConstPtr msg;
+  };
+
+  void onInit() override;
+  void messageCallback(const topic_tools::ShapeShifter::ConstPtr& msg, Relay* relay);
+  void timerCallback(const ros::TimerEvent&);
+  // Collects the messages due by now, the caller holds the mutex
+  void advanceWheel(const double now, std::vector<DelayedMessage>& due);
+  void statsTimerCallback(const ros::WallTimerEvent&);
+  // The caller holds the mutex, so that batches from concurrent callbacks cannot overtake each other
+  void publish(const std::vector<DelayedMessage>& due);
+
+  std::vector<std::unique_ptr<Relay>> relays_;
+  int queue_size_;
+  TimerWheel<DelayedMessage> wheel_;
+  double last_time_;
+  bool delayed_;  // some messages are held back, otherwise they all leave on arrival and no timer runs
+  std::mutex mutex_;
+  ros::Timer timer_;
+  ros::WallTimer stats_timer_;
+};
+
+void ImpairmentRelayNodelet::onInit()
+{
+  ros::NodeHandle& nh = getNodeHandle();
+  ros::NodeHandle& nh_private = getPrivateNodeHandle();
+
+  std::vector<std::string> topics;
+  nh_private.getParam("topics", topics);
+  const std::string output_prefix = nh_private.param<std::string>("output_prefix", "/impaired");
+  const int seed = nh_private.param<int>("seed", 0);
+  nh_private.param<int>("queue_size", this->queue_size_, 100);
+
+  ImpairmentConfig config;
+  const std::string distribution = nh_private.param<std::string>("delay_distribution", "constant");
+  if (!parseDelayDistribution(distribution, config.distribution))
+  {
+    NODELET_WARN("Unknown delay distribution %s, the delay is constant", distribution.c_str());
+  }
+  nh_private.param<double>("delay", config.delay, 0.0);
+  nh_private.param<double>("jitter", config.jitter, 0.0);
+  nh_private.param<double>("drop_probability", config.drop_probability, 0.0);
+  nh_private.param<double>("drop_burst_length", config.drop_burst_length, 1.0);
+  nh_private.param<double>("reorder_probability", config.reorder_probability, 0.0);
+  nh_private.param<double>("bandwidth", config.bandwidth, 0.0);
+  nh_private.param<double>("queue_limit", config.queue_limit, 1e6);
+
+  // Messages leave at the end of the tick they are due in
+  const double tick = nh_private.param<double>("tick", 0.001);
+  const int num_slots = nh_private.param<int>("num_slots", 4096);
+  this->wheel_ = TimerWheel<DelayedMessage>(tick, num_slots);
+  this->last_time_ = 0.0;
+
+  // Each topic draws from its own stream, so adding a topic does not change the fate of the others
+  for (size_t i = 0; i < topics.size(); i++)
+  {
+    if (topics[i].empty())
+    {
+      NODELET_WARN("Skipping the empty topic at index %zu of topics", i);
+      continue;
+    }
+    std::unique_ptr<Relay> relay(new Relay());
+    relay->input = topics[i];
+    relay->output = output_prefix + ((topics[i].front() == '/')? "" : "/") + topics[i];
+    relay->advertised = false;
+    relay->model = ImpairmentModel(config, seed + i);
+    relay->sub = nh.subscribe<topic_tools::ShapeShifter>(relay->input, this->queue_size_,
+        boost::bind(&ImpairmentRelayNodelet::messageCallback, this, _1, relay.get()));
+    NODELET_INFO("Relaying %s to %s", relay->input.c_str(), relay->output.c_str());
+    this->relays_.push_back(std::move(relay));
+  }
+  if (this->relays_.empty())
+  {
+    NODELET_WARN("No topics to relay, set the private parameter topics");
+  }
+
+  this->delayed_ = (config.delay > 0.0 || config.jitter > 0.0 || config.bandwidth > 0.0);
+  if (this->delayed_)
+  {
+    this->timer_ = nh.createTimer(ros::Duration(tick), &ImpairmentRelayNodelet::timerCallback, this);
+  }
+  this->stats_timer_ = nh.createWallTimer(ros::WallDuration(nh_private.param<double>("stats_period", 10.0)),
+                                          &ImpairmentRelayNodelet::statsTimerCallback, this);
+};
+
+void ImpairmentRelayNodelet::messageCallback(const topic_tools::ShapeShifter::ConstPtr& msg, Relay* relay)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+
+  // The type is only known once the first message arrives
+  if (!relay->advertised)
+  {
+    relay->pub = msg->advertise(getNodeHandle(), relay->output, this->queue_size_);
+    relay->advertised = true;
+  }
+
+  // Bring the wheel to now first, so that a message due right away is not held behind older ticks
+  std::vector<DelayedMessage> due;
+  const double now = ros::Time::now().toSec();
+  advanceWheel(now, due);
+  const double departure = relay->model.process(now, msg->size());
+  if (departure >= 0.0 && this->delayed_)
+  {
+    this->wheel_.schedule(departure, DelayedMessage{relay, msg});
+  }
+  else if (departure >= 0.0)
+  {
+    due.push_back(DelayedMessage{relay, msg});
+  }
+
+  publish(due);
+};
+
+void ImpairmentRelayNodelet::timerCallback(const ros::TimerEvent&)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  std::vector<DelayedMessage> due;
+  advanceWheel(ros::Time::now().toSec(), due);
+  publish(due);
+};
+
+void ImpairmentRelayNodelet::advanceWheel(const double now, std::vector<DelayedMessage>& due)
+{
+  auto collect = [&due](const DelayedMessage& delayed) { due.push_back(delayed); };
+  if (now < this->last_time_)
+  {
+    // The clock went back, after a simulation reset or a bag loop
+    this->wheel_.flush(collect);
+    this->wheel_.reset(now);
+  }
+  this->wheel_.advance(now, collect);
+  this->last_time_ = now;
+};
+
+void ImpairmentRelayNodelet::publish(const std::vector<DelayedMessage>& due)
+{
+  for (const DelayedMessage& delayed : due)
+  {
+    delayed.relay->pub.publish(delayed.msg);
+  }
+};
+
+void ImpairmentRelayNodelet::statsTimerCallback(const ros::WallTimerEvent&)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  for (const std::unique_ptr<Relay>& relay : this->relays_)
+  {
+    const ImpairmentStats& stats = relay->model.stats();
+    NODELET_INFO("%s: %lu received, %lu dropped, %lu dropped over the bandwidth, %lu reordered",
+                 relay->input.c_str(), (unsigned long)stats.num_received, (unsigned long)stats.num_dropped,
+                 (unsigned long)stats.num_queue_dropped, (unsigned long)stats.num_reordered);
+  }
+  NODELET_INFO("%zu messages in flight", this->wheel_.size());
+};
+
+} // namespace me5413_world
+
+PLUGINLIB_EXPORT_CLASS(me5413_world::ImpairmentRelayNodelet, nodelet::Nodelet)
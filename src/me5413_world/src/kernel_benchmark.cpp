@@ -0,0 +1,255 @@
+/** kernel_benchmark.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Benchmark and accuracy report of the tracking kernels instantiated for double, float and Q16.16,
+ * the accuracy is measured against the double instantiation on the same random robot poses
+ */
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "me5413_world/pid.hpp"
+#include "me5413_world/fixed_point.hpp"
+#include "me5413_world/tracking_utils.hpp"
+#include "me5413_world/tracking_pipeline.hpp"
+
+namespace me5413_world
+{
+
+// Same defaults as the dynamic reconfigure configs
+constexpr double kTrackAxis = 8.0;
+constexpr int kTrackWpNum = 500;
+constexpr double kRobotLength = 0.5;
+constexpr double kLookaheadGain = 0.5;
+constexpr double kSpeedTarget = 0.5;
+constexpr double kControlPeriod = 0.1;
+constexpr int kSearchWindow = 20;
+constexpr int kGoalOffset = 10;
+constexpr int kRepeats = 5;
+
+// Robot poses scattered around the track, and the waypoint each search starts from
+struct Scenario
+{
+  std::vector<Pose2D> path;
+  std::vector<Pose2D> robots;
+  std::vector<int> id_starts;
+  std::vector<double> speeds;
+};
+
+// Outputs of every kernel for every robot pose, converted to double
+struct KernelOutputs
+{
+  std::vector<int> id_next;
+  std::vector<double> position_error;
+  std::vector<double> heading_error;
+  std::vector<double> steering;
+  std::vector<double> pid_output;
+};
+
+struct KernelTimes
+{
+  double search;    // [ns] per call
+  double error;
+  double steering;
+  double pid;
+  double cycle;     // whole pipeline cycle
+};
+
+Scenario createScenario(const int num_samples)
+{
+  Scenario scenario;
+  scenario.path = createLemniscatePath(kTrackAxis, kTrackAxis, 1.0 / kTrackWpNum);
+
+  std::mt19937 rng(5413);
+  std::uniform_int_distribution<int> wp_dist(0, scenario.path.size() - 1);
+  std::normal_distribution<double> offset_dist(0.0, 0.3);
+  std::normal_distribution<double> yaw_dist(0.0, 0.2);
+  std::uniform_real_distribution<double> speed_dist(0.0, 1.0);
+  for (int i = 0; i < num_samples; i++)
+  {
+    const int id = wp_dist(rng);
+    Pose2D robot = scenario.path[id];
+    robot.x += offset_dist(rng);
+    robot.y += offset_dist(rng);
+    robot.yaw = unifyAngleRange(robot.yaw + yaw_dist(rng));
+    scenario.robots.push_back(robot);
+    scenario.id_starts.push_back(std::max(id - kSearchWindow, 0));
+    scenario.speeds.push_back(speed_dist(rng));
+  }
+
+  return scenario;
+}
+
+// Best of kRepeats, in ns per call
+template <typename Func>
+double timeKernel(const int num_calls, Func func)
+{
+  double best = 1e30;
+  for (int r = 0; r < kRepeats; r++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / num_calls);
+  }
+  return best;
+}
+
+template <typename T>
+KernelOutputs runKernels(const Scenario& scenario, KernelTimes& times)
+{
+  const std::vector<BasicPose2D<T>> path = castPath<T>(scenario.path);
+  const std::vector<BasicPose2D<T>> robots = castPath<T>(scenario.robots);
+  std::vector<T> speeds;
+  for (const double speed : scenario.speeds)
+  {
+    speeds.push_back(T(speed));
+  }
+  const int num_samples = robots.size();
+  const int num_wp = path.size();
+
+  // Waypoint search
+  KernelOutputs outputs;
+  outputs.id_next.resize(num_samples);
+  times.search = timeKernel(num_samples, [&]()
+  {
+    for (int i = 0; i < num_samples; i++)
+    {
+      outputs.id_next[i] = nextWaypoint(robots[i], path, scenario.id_starts[i]);
+    }
+  });
+
+  // Goals about 1 [m] ahead of the robot, at a fixed offset so every scalar type gets the same inputs
+  std::vector<BasicPose2D<T>> goals;
+  for (int i = 0; i < num_samples; i++)
+  {
+    const int id_goal = std::min(scenario.id_starts[i] + kSearchWindow + kGoalOffset, num_wp - 1);
+    goals.push_back(path[id_goal]);
+  }
+
+  // Pose errors
+  std::vector<std::pair<T, T>> errors(num_samples);
+  times.error = timeKernel(num_samples, [&]()
+  {
+    for (int i = 0; i < num_samples; i++)
+    {
+      errors[i] = calculatePoseError(robots[i], goals[i]);
+    }
+  });
+
+  // Steering
+  std::vector<T> steering(num_samples);
+  const T robot_length(kRobotLength);
+  const T lookahead_gain(kLookaheadGain);
+  times.steering = timeKernel(num_samples, [&]()
+  {
+    for (int i = 0; i < num_samples; i++)
+    {
+      steering[i] = computeSteering(robots[i], goals[i], robot_length, computeLookaheadDistance(speeds[i], lookahead_gain));
+    }
+  });
+
+  // Speed PID, run as one long rollout
+  std::vector<T> pid_output(num_samples);
+  control::BasicPID<T> pid(T(kControlPeriod), T(1.0), T(-1.0), T(0.5), T(0.2), T(0.2));
+  const T speed_target(kSpeedTarget);
+  times.pid = timeKernel(num_samples, [&]()
+  {
+    pid.reset();
+    for (int i = 0; i < num_samples; i++)
+    {
+      pid_output[i] = pid.calculate(speed_target, speeds[i]);
+    }
+  });
+
+  // Whole cycle through the pipeline, with the instantiation compiled in the library
+  typedef TrackingPipeline<T, LemniscatePath<T>, ForwardSearchProjector<T>, SpeedScaledLookahead<T>,
+                           PurePursuitSteering<T>, PIDSpeedController<T>> Pipeline;
+  Pipeline pipeline(LemniscatePath<T>(kTrackAxis, kTrackAxis, kTrackWpNum), ForwardSearchProjector<T>(),
+                    SpeedScaledLookahead<T>(lookahead_gain), PurePursuitSteering<T>(robot_length),
+                    PIDSpeedController<T>(T(kControlPeriod), T(0.5), T(0.2), T(0.2)));
+  std::vector<TrackingInput<T>> inputs(num_samples);
+  for (int i = 0; i < num_samples; i++)
+  {
+    inputs[i].robot = robots[i];
+    inputs[i].forward_speed = speeds[i];
+    inputs[i].speed = speeds[i];
+  }
+  std::vector<TrackingOutput<T>> cycle_outputs(num_samples);
+  times.cycle = timeKernel(num_samples, [&]()
+  {
+    pipeline.reset();
+    pipeline.run(inputs.data(), num_samples, speed_target, cycle_outputs.data());
+  });
+
+  for (int i = 0; i < num_samples; i++)
+  {
+    outputs.position_error.push_back(double(errors[i].first));
+    outputs.heading_error.push_back(double(errors[i].second));
+    outputs.steering.push_back(double(steering[i]));
+    outputs.pid_output.push_back(double(pid_output[i]));
+  }
+
+  return outputs;
+}
+
+double maxAbsDiff(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double max_diff = 0.0;
+  for (int i = 0; i < int(a.size()); i++)
+  {
+    max_diff = std::max(max_diff, std::fabs(a[i] - b[i]));
+  }
+  return max_diff;
+}
+
+template <typename T>
+void report(const char* name, const Scenario& scenario, const KernelOutputs& reference)
+{
+  KernelTimes times;
+  const KernelOutputs outputs = runKernels<T>(scenario, times);
+
+  int num_mismatches = 0;
+  for (int i = 0; i < int(outputs.id_next.size()); i++)
+  {
+    num_mismatches += (outputs.id_next[i] != reference.id_next[i]);
+  }
+
+  std::printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f %12.2e %12.2e %12.2e %12.2e %10d\n",
+              name, times.search, times.error, times.steering, times.pid, times.cycle,
+              maxAbsDiff(outputs.position_error, reference.position_error),
+              maxAbsDiff(outputs.heading_error, reference.heading_error),
+              maxAbsDiff(outputs.steering, reference.steering),
+              maxAbsDiff(outputs.pid_output, reference.pid_output),
+              num_mismatches);
+}
+
+} // namespace me5413_world
+
+int main(int argc, char** argv)
+{
+  using namespace me5413_world;
+
+  const int num_samples = (argc > 1)? std::max(std::atoi(argv[1]), 1) : 100000;
+  const Scenario scenario = createScenario(num_samples);
+
+  KernelTimes times;
+  const KernelOutputs reference = runKernels<double>(scenario, times);
+
+  std::printf("%d robot poses, times in [ns] per call, errors wrt double\n", num_samples);
+  std::printf("%-8s %10s %10s %10s %10s %10s %12s %12s %12s %12s %10s\n",
+              "scalar", "search", "error", "steering", "pid", "cycle",
+              "pos_err[m]", "head_err[deg]", "steer[rad]", "pid_out", "wp_diff");
+  report<double>("double", scenario, reference);
+  report<float>("float", scenario, reference);
+  report<Q16_16>("q16.16", scenario, reference);
+
+  return 0;
+}
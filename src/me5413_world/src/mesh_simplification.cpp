@@ -0,0 +1,774 @@
+/** mesh_simplification.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * STL input/output, convex hulls and quadric edge-collapse decimation
+ */
+
+#include <map>
+#include <cmath>
+#include <queue>
+#include <limits>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+#include "me5413_world/mesh_simplification.hpp"
+
+namespace me5413_world
+{
+
+namespace
+{
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3{a.x + b.x, a.y + b.y, a.z + b.z}; };
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3{a.x - b.x, a.y - b.y, a.z - b.z}; };
+inline Vec3 operator*(const double s, const Vec3& a) { return Vec3{s * a.x, s * a.y, s * a.z}; };
+inline double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+inline Vec3 cross(const Vec3& a, const Vec3& b)
+{
+  return Vec3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+};
+inline double norm(const Vec3& a) { return std::sqrt(dot(a, a)); };
+inline Vec3 normalized(const Vec3& a)
+{
+  const double n = norm(a);
+  return (n > 0.0)? (1.0 / n) * a : Vec3{0.0, 0.0, 0.0};
+};
+
+// Non-normalized normal, its length is twice the triangle area
+inline Vec3 triangleNormal(const Vec3& a, const Vec3& b, const Vec3& c)
+{
+  return cross(b - a, c - a);
+};
+
+double boundingBoxDiagonal(const std::vector<Vec3>& points)
+{
+  if (points.empty())
+  {
+    return 0.0;
+  }
+  Vec3 lo = points.front();
+  Vec3 hi = points.front();
+  for (const Vec3& p : points)
+  {
+    lo = Vec3{std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+    hi = Vec3{std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+  }
+  return norm(hi - lo);
+};
+
+// Keeps only the vertices used by the triangles, in order of first use
+TriangleMesh compactMesh(const std::vector<Vec3>& vertices, const std::vector<std::array<int, 3>>& triangles)
+{
+  TriangleMesh mesh;
+  std::vector<int> new_ids(vertices.size(), -1);
+  mesh.triangles.reserve(triangles.size());
+  for (const std::array<int, 3>& triangle : triangles)
+  {
+    std::array<int, 3> t;
+    for (int k = 0; k < 3; k++)
+    {
+      int& id = new_ids[triangle[k]];
+      if (id < 0)
+      {
+        id = mesh.vertices.size();
+        mesh.vertices.push_back(vertices[triangle[k]]);
+      }
+      t[k] = id;
+    }
+    mesh.triangles.push_back(t);
+  }
+
+  return mesh;
+};
+
+class VertexWelder
+{
+ public:
+  explicit VertexWelder(TriangleMesh& mesh) : mesh_(mesh) {};
+
+  int add(const double x, const double y, const double z)
+  {
+    const std::array<double, 3> key = {x, y, z};
+    const auto it = this->ids_.find(key);
+    if (it != this->ids_.end())
+    {
+      return it->second;
+    }
+    const int id = this->mesh_.vertices.size();
+    this->mesh_.vertices.push_back(Vec3{x, y, z});
+    this->ids_.emplace(key, id);
+    return id;
+  };
+
+  void addTriangle(const std::array<int, 3>& t)
+  {
+    if (t[0] != t[1] && t[1] != t[2] && t[2] != t[0])
+    {
+      this->mesh_.triangles.push_back(t);
+    }
+  };
+
+ private:
+  TriangleMesh& mesh_;
+  std::map<std::array<double, 3>, int> ids_;
+};
+
+// Symmetric 4x4 matrix of the plane quadric, upper triangle row by row
+struct Quadric
+{
+  std::array<double, 10> a;
+
+  Quadric() { a.fill(0.0); };
+  Quadric(const Vec3& n, const double d, const double w)
+  {
+    a = {w * n.x * n.x, w * n.x * n.y, w * n.x * n.z, w * n.x * d,
+                        w * n.y * n.y, w * n.y * n.z, w * n.y * d,
+                                       w * n.z * n.z, w * n.z * d,
+                                                      w * d * d};
+  };
+
+  Quadric& operator+=(const Quadric& q)
+  {
+    for (int i = 0; i < 10; i++)
+    {
+      a[i] += q.a[i];
+    }
+    return *this;
+  };
+
+  double error(const Vec3& v) const
+  {
+    return a[0] * v.x * v.x + 2.0 * a[1] * v.x * v.y + 2.0 * a[2] * v.x * v.z + 2.0 * a[3] * v.x
+                            + a[4] * v.y * v.y + 2.0 * a[5] * v.y * v.z + 2.0 * a[6] * v.y
+                                               + a[7] * v.z * v.z + 2.0 * a[8] * v.z
+                                                                  + a[9];
+  };
+
+  // Minimizer of the error, by Cramer's rule. Returns false if the system is singular
+  bool optimum(Vec3& v) const
+  {
+    const double det = a[0] * (a[4] * a[7] - a[5] * a[5])
+                     - a[1] * (a[1] * a[7] - a[5] * a[2])
+                     + a[2] * (a[1] * a[5] - a[4] * a[2]);
+    const double trace = a[0] + a[4] + a[7];
+    if (std::fabs(det) <= 1e-9 * trace * trace * trace)
+    {
+      return false;
+    }
+    const double bx = -a[3], by = -a[6], bz = -a[8];
+    v.x = (bx * (a[4] * a[7] - a[5] * a[5]) - a[1] * (by * a[7] - a[5] * bz) + a[2] * (by * a[5] - a[4] * bz)) / det;
+    v.y = (a[0] * (by * a[7] - a[5] * bz) - bx * (a[1] * a[7] - a[5] * a[2]) + a[2] * (a[1] * bz - by * a[2])) / det;
+    v.z = (a[0] * (a[4] * bz - by * a[5]) - a[1] * (a[1] * bz - by * a[2]) + bx * (a[1] * a[5] - a[4] * a[2])) / det;
+    return true;
+  };
+};
+
+inline Quadric operator+(Quadric q, const Quadric& r) { return q += r; };
+
+struct Collapse
+{
+  double cost;
+  int v0, v1;
+  int version0, version1;
+  Vec3 target;
+
+  bool operator>(const Collapse& c) const { return cost > c.cost; };
+};
+
+// Closest point on triangle abc to p, from Ericson, Real-Time Collision Detection, 5.1.5
+Vec3 closestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+{
+  const Vec3 ab = b - a;
+  const Vec3 ac = c - a;
+  const Vec3 ap = p - a;
+  const double d1 = dot(ab, ap);
+  const double d2 = dot(ac, ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+  {
+    return a;
+  }
+
+  const Vec3 bp = p - b;
+  const double d3 = dot(ab, bp);
+  const double d4 = dot(ac, bp);
+  if (d3 >= 0.0 && d4 <= d3)
+  {
+    return b;
+  }
+
+  const double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+  {
+    return a + (d1 / (d1 - d3)) * ab;
+  }
+
+  const Vec3 cp = p - c;
+  const double d5 = dot(ab, cp);
+  const double d6 = dot(ac, cp);
+  if (d6 >= 0.0 && d5 <= d6)
+  {
+    return c;
+  }
+
+  const double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+  {
+    return a + (d2 / (d2 - d6)) * ac;
+  }
+
+  const double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+  {
+    return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+  }
+
+  const double denom = 1.0 / (va + vb + vc);
+  return a + (vb * denom) * ab + (vc * denom) * ac;
+};
+
+constexpr double kBoundaryWeight = 1000.0;   // keeps open borders in place
+constexpr double kMinNormalAgreement = 0.2;  // cos of the largest normal rotation a collapse may cause
+
+} // namespace
+
+bool readStl(const std::string& filename, TriangleMesh& mesh)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+  const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  mesh.vertices.clear();
+  mesh.triangles.clear();
+  VertexWelder welder(mesh);
+
+  // Binary STLs may also start with "solid", so the size is the reliable test
+  if (data.size() >= 84)
+  {
+    uint32_t num_triangles;
+    std::memcpy(&num_triangles, &data[80], sizeof(num_triangles));
+    if (data.size() == 84 + 50 * static_cast<uint64_t>(num_triangles))
+    {
+      for (uint32_t i = 0; i < num_triangles; i++)
+      {
+        const char* record = &data[84 + 50 * i];
+        std::array<int, 3> t;
+        for (int k = 0; k < 3; k++)
+        {
+          float xyz[3];
+          std::memcpy(xyz, record + 12 * (k + 1), sizeof(xyz));
+          t[k] = welder.add(xyz[0], xyz[1], xyz[2]);
+        }
+        welder.addTriangle(t);
+      }
+      return true;
+    }
+  }
+
+  if (data.compare(0, 5, "solid") != 0)
+  {
+    return false;
+  }
+  std::istringstream stream(data);
+  std::string token;
+  std::array<int, 3> t;
+  int num_vertices = 0;
+  while (stream >> token)
+  {
+    if (token == "vertex")
+    {
+      double x, y, z;
+      if (!(stream >> x >> y >> z))
+      {
+        return false;
+      }
+      if (num_vertices < 3)
+      {
+        t[num_vertices] = welder.add(x, y, z);
+      }
+      num_vertices++;
+    }
+    else if (token == "endfacet")
+    {
+      if (num_vertices != 3)
+      {
+        return false;
+      }
+      welder.addTriangle(t);
+      num_vertices = 0;
+    }
+  }
+
+  return !mesh.triangles.empty();
+};
+
+bool writeStl(const std::string& filename, const TriangleMesh& mesh, const std::string& header)
+{
+  std::ofstream file(filename, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  char header_bytes[80] = {};
+  std::memcpy(header_bytes, header.data(), std::min<size_t>(header.size(), sizeof(header_bytes)));
+  file.write(header_bytes, sizeof(header_bytes));
+  const uint32_t num_triangles = mesh.triangles.size();
+  file.write(reinterpret_cast<const char*>(&num_triangles), sizeof(num_triangles));
+
+  for (const std::array<int, 3>& t : mesh.triangles)
+  {
+    const Vec3& a = mesh.vertices[t[0]];
+    const Vec3& b = mesh.vertices[t[1]];
+    const Vec3& c = mesh.vertices[t[2]];
+    const Vec3 n = normalized(triangleNormal(a, b, c));
+    const float record[12] = {float(n.x), float(n.y), float(n.z),
+                              float(a.x), float(a.y), float(a.z),
+                              float(b.x), float(b.y), float(b.z),
+                              float(c.x), float(c.y), float(c.z)};
+    const uint16_t attributes = 0;
+    file.write(reinterpret_cast<const char*>(record), sizeof(record));
+    file.write(reinterpret_cast<const char*>(&attributes), sizeof(attributes));
+  }
+
+  return static_cast<bool>(file);
+};
+
+bool convexHull(const std::vector<Vec3>& points, TriangleMesh& hull)
+{
+  hull.vertices.clear();
+  hull.triangles.clear();
+  if (points.size() < 4)
+  {
+    return false;
+  }
+  // STL coordinates are floats, so anything closer to a plane than their rounding counts as on it
+  const double eps = 1e-6 * boundingBoxDiagonal(points);
+
+  // Initial tetrahedron from extreme points
+  int i0 = 0;
+  for (int i = 1; i < int(points.size()); i++)
+  {
+    if (points[i].x < points[i0].x)
+    {
+      i0 = i;
+    }
+  }
+  int i1 = i0;
+  for (int i = 0; i < int(points.size()); i++)
+  {
+    if (norm(points[i] - points[i0]) > norm(points[i1] - points[i0]))
+    {
+      i1 = i;
+    }
+  }
+  const Vec3 axis = normalized(points[i1] - points[i0]);
+  int i2 = i0;
+  double i2_distance = 0.0;
+  for (int i = 0; i < int(points.size()); i++)
+  {
+    const double distance = norm(cross(points[i] - points[i0], axis));
+    if (distance > i2_distance)
+    {
+      i2 = i;
+      i2_distance = distance;
+    }
+  }
+  const Vec3 base_normal = normalized(triangleNormal(points[i0], points[i1], points[i2]));
+  int i3 = i0;
+  double i3_distance = 0.0;
+  for (int i = 0; i < int(points.size()); i++)
+  {
+    const double distance = std::fabs(dot(points[i] - points[i0], base_normal));
+    if (distance > i3_distance)
+    {
+      i3 = i;
+      i3_distance = distance;
+    }
+  }
+  if (i2_distance <= eps || i3_distance <= eps)
+  {
+    return false;
+  }
+
+  struct Face
+  {
+    std::array<int, 3> v;
+    Vec3 normal;
+    double offset;
+    bool alive;
+  };
+  std::vector<Face> faces;
+  const Vec3 centroid = 0.25 * (points[i0] + points[i1] + points[i2] + points[i3]);
+  auto addFace = [&](const int a, const int b, const int c)
+  {
+    Face face;
+    face.v = {a, b, c};
+    face.normal = normalized(triangleNormal(points[a], points[b], points[c]));
+    face.offset = dot(face.normal, points[a]);
+    face.alive = true;
+    faces.push_back(face);
+  };
+  for (const std::array<int, 3>& t : {std::array<int, 3>{i0, i1, i2}, std::array<int, 3>{i0, i1, i3},
+                                      std::array<int, 3>{i0, i2, i3}, std::array<int, 3>{i1, i2, i3}})
+  {
+    addFace(t[0], t[1], t[2]);
+    Face& face = faces.back();
+    if (dot(face.normal, centroid) - face.offset > 0.0)
+    {
+      std::swap(face.v[1], face.v[2]);
+      face.normal = -1.0 * face.normal;
+      face.offset = -face.offset;
+    }
+  }
+
+  // Add the remaining points in random order, which keeps the expected hull size small while growing
+  std::vector<int> order(points.size());
+  for (int i = 0; i < int(order.size()); i++)
+  {
+    order[i] = i;
+  }
+  std::mt19937 rng(5413);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  // Directed edge to the face that owns it, to walk from a face to its neighbours
+  std::map<std::pair<int, int>, int> edge_faces;
+  auto indexFaces = [&]()
+  {
+    edge_faces.clear();
+    for (int f = 0; f < int(faces.size()); f++)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        edge_faces[std::make_pair(faces[f].v[k], faces[f].v[(k + 1) % 3])] = f;
+      }
+    }
+  };
+  indexFaces();
+
+  std::vector<int> visible;
+  std::vector<int> visit_marks;
+  std::vector<std::pair<int, int>> horizon;
+  int num_alive = faces.size();
+  for (const int i : order)
+  {
+    const Vec3& p = points[i];
+    int seed = -1;
+    double seed_distance = eps;
+    for (int f = 0; f < int(faces.size()); f++)
+    {
+      const double distance = dot(faces[f].normal, p) - faces[f].offset;
+      if (faces[f].alive && distance > seed_distance)
+      {
+        seed = f;
+        seed_distance = distance;
+      }
+    }
+    if (seed < 0)
+    {
+      continue;
+    }
+
+    // Grow the visible region from the face the point is farthest above, so that it stays connected
+    // even where rounding makes a nearly coplanar face disagree with its neighbours
+    visit_marks.resize(faces.size(), -1);
+    visible.assign(1, seed);
+    visit_marks[seed] = i;
+    for (int n = 0; n < int(visible.size()); n++)
+    {
+      const Face& face = faces[visible[n]];
+      for (int k = 0; k < 3; k++)
+      {
+        const int neighbor = edge_faces[std::make_pair(face.v[(k + 1) % 3], face.v[k])];
+        if (visit_marks[neighbor] != i && dot(faces[neighbor].normal, p) - faces[neighbor].offset > eps)
+        {
+          visit_marks[neighbor] = i;
+          visible.push_back(neighbor);
+        }
+      }
+    }
+
+    // The horizon is made of the edges of the visible region whose twin is on a hidden face
+    horizon.clear();
+    for (const int f : visible)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        const std::pair<int, int> edge(faces[f].v[k], faces[f].v[(k + 1) % 3]);
+        if (visit_marks[edge_faces[std::make_pair(edge.second, edge.first)]] != i)
+        {
+          horizon.push_back(edge);
+        }
+      }
+      faces[f].alive = false;
+    }
+    num_alive -= visible.size();
+    for (const std::pair<int, int>& edge : horizon)
+    {
+      addFace(edge.first, edge.second, i);
+      const int f = faces.size() - 1;
+      edge_faces[edge] = f;
+      edge_faces[std::make_pair(edge.second, i)] = f;
+      edge_faces[std::make_pair(i, edge.first)] = f;
+      num_alive++;
+    }
+
+    if (num_alive * 2 < int(faces.size()))
+    {
+      faces.erase(std::remove_if(faces.begin(), faces.end(), [](const Face& face) { return !face.alive; }), faces.end());
+      visit_marks.assign(faces.size(), -1);
+      indexFaces();
+    }
+  }
+
+  std::vector<std::array<int, 3>> triangles;
+  for (const Face& face : faces)
+  {
+    if (face.alive)
+    {
+      triangles.push_back(face.v);
+    }
+  }
+  hull = compactMesh(points, triangles);
+
+  return true;
+};
+
+int decimate(TriangleMesh& mesh, const int target_triangles)
+{
+  const int num_vertices = mesh.vertices.size();
+  const int num_faces = mesh.triangles.size();
+  std::vector<Vec3>& vertices = mesh.vertices;
+  std::vector<std::array<int, 3>>& faces = mesh.triangles;
+
+  // Plane quadrics weighted by the triangle areas, plus perpendicular planes along the open borders
+  std::vector<Quadric> quadrics(num_vertices);
+  std::vector<std::vector<int>> vertex_faces(num_vertices);
+  std::map<std::pair<int, int>, int> edge_faces;
+  for (int f = 0; f < num_faces; f++)
+  {
+    const std::array<int, 3>& t = faces[f];
+    const Vec3 n = triangleNormal(vertices[t[0]], vertices[t[1]], vertices[t[2]]);
+    const double area = 0.5 * norm(n);
+    const Vec3 unit = normalized(n);
+    const Quadric q(unit, -dot(unit, vertices[t[0]]), area);
+    for (int k = 0; k < 3; k++)
+    {
+      quadrics[t[k]] += q;
+      vertex_faces[t[k]].push_back(f);
+      const int a = t[k];
+      const int b = t[(k + 1) % 3];
+      edge_faces[std::make_pair(std::min(a, b), std::max(a, b))]++;
+    }
+  }
+  for (int f = 0; f < num_faces; f++)
+  {
+    const std::array<int, 3>& t = faces[f];
+    const Vec3 n = normalized(triangleNormal(vertices[t[0]], vertices[t[1]], vertices[t[2]]));
+    for (int k = 0; k < 3; k++)
+    {
+      const int a = t[k];
+      const int b = t[(k + 1) % 3];
+      if (edge_faces[std::make_pair(std::min(a, b), std::max(a, b))] != 1)
+      {
+        continue;
+      }
+      const Vec3 edge = vertices[b] - vertices[a];
+      const Vec3 border = normalized(cross(edge, n));
+      const Quadric q(border, -dot(border, vertices[a]), kBoundaryWeight * dot(edge, edge));
+      quadrics[a] += q;
+      quadrics[b] += q;
+    }
+  }
+
+  std::vector<bool> vertex_alive(num_vertices, true);
+  std::vector<bool> face_alive(num_faces, true);
+  std::vector<int> versions(num_vertices, 0);
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+  auto neighbors = [&](const int v)
+  {
+    std::vector<int> result;
+    for (const int f : vertex_faces[v])
+    {
+      for (const int u : faces[f])
+      {
+        if (u != v)
+        {
+          result.push_back(u);
+        }
+      }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  };
+
+  auto pushCollapse = [&](const int v0, const int v1)
+  {
+    Collapse c;
+    c.v0 = v0;
+    c.v1 = v1;
+    c.version0 = versions[v0];
+    c.version1 = versions[v1];
+    const Quadric q = quadrics[v0] + quadrics[v1];
+    if (!q.optimum(c.target))
+    {
+      // Flat or straight neighbourhood, take the best of the end points and the midpoint
+      const Vec3 candidates[3] = {vertices[v0], vertices[v1], 0.5 * (vertices[v0] + vertices[v1])};
+      c.target = candidates[0];
+      for (const Vec3& candidate : candidates)
+      {
+        if (q.error(candidate) < q.error(c.target))
+        {
+          c.target = candidate;
+        }
+      }
+    }
+    c.cost = q.error(c.target);
+    heap.push(c);
+  };
+
+  for (const auto& edge : edge_faces)
+  {
+    pushCollapse(edge.first.first, edge.first.second);
+  }
+
+  // Whether moving v to target keeps the orientation of its faces that do not also contain other
+  auto keepsFaces = [&](const int v, const int other, const Vec3& target)
+  {
+    for (const int f : vertex_faces[v])
+    {
+      const std::array<int, 3>& t = faces[f];
+      if (t[0] == other || t[1] == other || t[2] == other)
+      {
+        continue;
+      }
+      Vec3 moved[3] = {vertices[t[0]], vertices[t[1]], vertices[t[2]]};
+      for (int k = 0; k < 3; k++)
+      {
+        if (t[k] == v)
+        {
+          moved[k] = target;
+        }
+      }
+      const Vec3 before = normalized(triangleNormal(vertices[t[0]], vertices[t[1]], vertices[t[2]]));
+      const Vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+      if (norm(after) <= 0.0 || dot(before, normalized(after)) < kMinNormalAgreement)
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  int num_alive = num_faces;
+  const int target = std::max(target_triangles, 4);
+  while (num_alive > target && !heap.empty())
+  {
+    const Collapse c = heap.top();
+    heap.pop();
+    if (!vertex_alive[c.v0] || !vertex_alive[c.v1] ||
+        versions[c.v0] != c.version0 || versions[c.v1] != c.version1)
+    {
+      continue;
+    }
+
+    // Link condition: the only vertices adjacent to both ends are the apexes of the faces on the edge
+    int num_shared_faces = 0;
+    for (const int f : vertex_faces[c.v0])
+    {
+      const std::array<int, 3>& t = faces[f];
+      num_shared_faces += (t[0] == c.v1 || t[1] == c.v1 || t[2] == c.v1)? 1 : 0;
+    }
+    const std::vector<int> n0 = neighbors(c.v0);
+    const std::vector<int> n1 = neighbors(c.v1);
+    std::vector<int> common;
+    std::set_intersection(n0.begin(), n0.end(), n1.begin(), n1.end(), std::back_inserter(common));
+    if (int(common.size()) != num_shared_faces ||
+        !keepsFaces(c.v0, c.v1, c.target) || !keepsFaces(c.v1, c.v0, c.target))
+    {
+      continue;
+    }
+
+    // Merge v1 into v0
+    vertices[c.v0] = c.target;
+    quadrics[c.v0] += quadrics[c.v1];
+    vertex_alive[c.v1] = false;
+    for (const int f : vertex_faces[c.v1])
+    {
+      std::array<int, 3>& t = faces[f];
+      if (t[0] == c.v0 || t[1] == c.v0 || t[2] == c.v0)
+      {
+        face_alive[f] = false;
+        num_alive--;
+        continue;
+      }
+      for (int k = 0; k < 3; k++)
+      {
+        if (t[k] == c.v1)
+        {
+          t[k] = c.v0;
+        }
+      }
+      vertex_faces[c.v0].push_back(f);
+    }
+    vertex_faces[c.v1].clear();
+    std::vector<int>& faces0 = vertex_faces[c.v0];
+    faces0.erase(std::remove_if(faces0.begin(), faces0.end(), [&](const int f) { return !face_alive[f]; }), faces0.end());
+    for (const int u : common)
+    {
+      std::vector<int>& faces_u = vertex_faces[u];
+      faces_u.erase(std::remove_if(faces_u.begin(), faces_u.end(), [&](const int f) { return !face_alive[f]; }), faces_u.end());
+    }
+
+    versions[c.v0]++;
+    versions[c.v1]++;
+    for (const int u : neighbors(c.v0))
+    {
+      pushCollapse(c.v0, u);
+    }
+  }
+
+  std::vector<std::array<int, 3>> kept;
+  kept.reserve(num_alive);
+  for (int f = 0; f < num_faces; f++)
+  {
+    if (face_alive[f])
+    {
+      kept.push_back(faces[f]);
+    }
+  }
+  mesh = compactMesh(vertices, kept);
+
+  return mesh.triangles.size();
+};
+
+double maxDeviation(const TriangleMesh& original, const TriangleMesh& simplified)
+{
+  double max_deviation = 0.0;
+  for (const Vec3& p : original.vertices)
+  {
+    double deviation = std::numeric_limits<double>::infinity();
+    for (const std::array<int, 3>& t : simplified.triangles)
+    {
+      const Vec3 closest = closestPointOnTriangle(p, simplified.vertices[t[0]], simplified.vertices[t[1]], simplified.vertices[t[2]]);
+      deviation = std::min(deviation, norm(p - closest));
+    }
+    max_deviation = std::max(max_deviation, deviation);
+  }
+
+  return max_deviation;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,103 @@
+/** mesh_simplifier.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Builds a low-polygon collision mesh from an STL, either by quadric decimation of the mesh
+ * or from its convex hull, within a triangle budget
+ */
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "me5413_world/mesh_simplification.hpp"
+
+namespace me5413_world
+{
+
+constexpr int kDefaultTriangles = 200;
+
+void printUsage(const char* program)
+{
+  std::printf("Usage: %s [--hull] [--triangles N] input.stl output.stl\n"
+              "  --hull         simplify the convex hull of the mesh instead of the mesh itself\n"
+              "  --triangles N  triangle budget of the output (default %d)\n",
+              program, kDefaultTriangles);
+};
+
+} // namespace me5413_world
+
+int main(int argc, char** argv)
+{
+  using namespace me5413_world;
+
+  bool hull = false;
+  int triangles = kDefaultTriangles;
+  std::string input, output;
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--hull") == 0)
+    {
+      hull = true;
+    }
+    else if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc)
+    {
+      triangles = std::atoi(argv[++i]);
+    }
+    else if (input.empty())
+    {
+      input = argv[i];
+    }
+    else if (output.empty())
+    {
+      output = argv[i];
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (input.empty() || output.empty() || triangles < 4)
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  TriangleMesh original;
+  if (!readStl(input, original))
+  {
+    std::fprintf(stderr, "Failed to read %s\n", input.c_str());
+    return 1;
+  }
+  std::printf("%s: %zu triangles, %zu vertices\n", input.c_str(), original.triangles.size(), original.vertices.size());
+
+  TriangleMesh simplified = original;
+  if (hull)
+  {
+    if (!convexHull(original.vertices, simplified))
+    {
+      std::fprintf(stderr, "The mesh is flat, it has no convex hull\n");
+      return 1;
+    }
+    std::printf("convex hull: %zu triangles\n", simplified.triangles.size());
+  }
+  const int kept = decimate(simplified, triangles);
+  if (kept > triangles)
+  {
+    std::printf("Warning: stopped at %d triangles, no more edges can be collapsed safely\n", kept);
+  }
+
+  if (!writeStl(output, simplified, "me5413_world mesh_simplifier"))
+  {
+    std::fprintf(stderr, "Failed to write %s\n", output.c_str());
+    return 1;
+  }
+  std::printf("%s: %zu triangles, %zu vertices, max deviation %.1f mm\n", output.c_str(),
+              simplified.triangles.size(), simplified.vertices.size(), 1000.0 * maxDeviation(original, simplified));
+
+  return 0;
+}
@@ -0,0 +1,302 @@
+/** metrics.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Implementation of the metrics registry and the Prometheus HTTP exporter
+ */
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+#include "me5413_world/metrics.hpp"
+
+namespace me5413_world
+{
+
+Histogram::Histogram(const std::vector<double>& bounds) :
+  bounds_(bounds),
+  counts_(new std::atomic<uint64_t>[bounds.size() + 1]),
+  sum_(0.0),
+  count_(0)
+{
+  std::sort(this->bounds_.begin(), this->bounds_.end());
+  for (int i = 0; i <= int(this->bounds_.size()); i++)
+  {
+    this->counts_[i] = 0;
+  }
+};
+
+void Histogram::observe(const double value)
+{
+  // A NaN or infinite sample would stick in the sum forever
+  if (!std::isfinite(value))
+  {
+    return;
+  }
+
+  // Bucket of the first bound >= value, the last one is +Inf
+  const int bucket = std::lower_bound(this->bounds_.begin(), this->bounds_.end(), value) - this->bounds_.begin();
+  this->counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  this->count_.fetch_add(1, std::memory_order_relaxed);
+
+  double sum = this->sum_.load(std::memory_order_relaxed);
+  while (!this->sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+  {
+  }
+};
+
+std::vector<uint64_t> Histogram::cumulativeCounts() const
+{
+  std::vector<uint64_t> counts;
+  uint64_t total = 0;
+  for (int i = 0; i <= int(this->bounds_.size()); i++)
+  {
+    total += this->counts_[i].load(std::memory_order_relaxed);
+    counts.push_back(total);
+  }
+
+  return counts;
+};
+
+std::vector<double> exponentialBuckets(const double start, const double factor, const int count)
+{
+  std::vector<double> bounds;
+  double bound = start;
+  for (int i = 0; i < count; i++)
+  {
+    bounds.push_back(bound);
+    bound *= factor;
+  }
+
+  return bounds;
+};
+
+std::vector<double> linearBuckets(const double start, const double width, const int count)
+{
+  std::vector<double> bounds;
+  for (int i = 0; i < count; i++)
+  {
+    bounds.push_back(start + i * width);
+  }
+
+  return bounds;
+};
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->entries_.push_back(Entry());
+  this->entries_.back().name = name;
+  this->entries_.back().help = help;
+  this->entries_.back().counter.reset(new Counter());
+
+  return *this->entries_.back().counter;
+};
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->entries_.push_back(Entry());
+  this->entries_.back().name = name;
+  this->entries_.back().help = help;
+  this->entries_.back().gauge.reset(new Gauge());
+
+  return *this->entries_.back().gauge;
+};
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->entries_.push_back(Entry());
+  this->entries_.back().name = name;
+  this->entries_.back().help = help;
+  this->entries_.back().histogram.reset(new Histogram(bounds));
+
+  return *this->entries_.back().histogram;
+};
+
+std::string MetricsRegistry::render() const
+{
+  std::ostringstream text;
+  text.precision(10);
+
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  for (const Entry& entry : this->entries_)
+  {
+    text << "# HELP " << entry.name << " " << entry.help << "\n";
+    if (entry.counter)
+    {
+      text << "# TYPE " << entry.name << " counter\n";
+      text << entry.name << " " << entry.counter->value() << "\n";
+    }
+    else if (entry.gauge)
+    {
+      text << "# TYPE " << entry.name << " gauge\n";
+      text << entry.name << " " << entry.gauge->value() << "\n";
+    }
+    else if (entry.histogram)
+    {
+      // The count is taken from the buckets, so that it matches them under concurrent observations
+      const std::vector<uint64_t> counts = entry.histogram->cumulativeCounts();
+      const std::vector<double>& bounds = entry.histogram->bounds();
+      text << "# TYPE " << entry.name << " histogram\n";
+      for (int i = 0; i < int(bounds.size()); i++)
+      {
+        text << entry.name << "_bucket{le=\"" << bounds[i] << "\"} " << counts[i] << "\n";
+      }
+      text << entry.name << "_bucket{le=\"+Inf\"} " << counts.back() << "\n";
+      text << entry.name << "_sum " << entry.histogram->sum() << "\n";
+      text << entry.name << "_count " << counts.back() << "\n";
+    }
+  }
+
+  return text.str();
+};
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry) :
+  registry_(registry),
+  listen_fd_(-1),
+  running_(false)
+{};
+
+MetricsServer::~MetricsServer()
+{
+  stop();
+};
+
+bool MetricsServer::start(const std::string& address, const int port)
+{
+  stop();
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+  {
+    return false;
+  }
+
+  this->listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (this->listen_fd_ < 0)
+  {
+    return false;
+  }
+  const int reuse = 1;
+  ::setsockopt(this->listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if (::bind(this->listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(this->listen_fd_, 8) != 0)
+  {
+    ::close(this->listen_fd_);
+    this->listen_fd_ = -1;
+    return false;
+  }
+
+  this->running_ = true;
+  this->thread_ = std::thread(&MetricsServer::serve, this);
+
+  return true;
+};
+
+void MetricsServer::stop()
+{
+  this->running_ = false;
+  if (this->thread_.joinable())
+  {
+    this->thread_.join();
+  }
+  if (this->listen_fd_ >= 0)
+  {
+    ::close(this->listen_fd_);
+    this->listen_fd_ = -1;
+  }
+};
+
+void MetricsServer::serve()
+{
+  while (this->running_)
+  {
+    // Wake up regularly to notice stop()
+    pollfd listen_poll;
+    listen_poll.fd = this->listen_fd_;
+    listen_poll.events = POLLIN;
+    if (::poll(&listen_poll, 1, 200) <= 0)
+    {
+      continue;
+    }
+
+    const int fd = ::accept(this->listen_fd_, nullptr, nullptr);
+    if (fd >= 0)
+    {
+      handleConnection(fd);
+      ::close(fd);
+    }
+  }
+};
+
+void MetricsServer::handleConnection(const int fd)
+{
+  // A slow or silent client only holds the exporter, never the node, and not for long
+  timeval timeout;
+  timeout.tv_sec = 1;
+  timeout.tv_usec = 0;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  // Read the request head, the body (if any) is ignored
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+  {
+    const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0)
+    {
+      break;
+    }
+    request.append(buffer, n);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0)
+  {
+    body = this->registry_.render();
+  }
+  else
+  {
+    status = "404 Not Found";
+    body = "Metrics are served at /metrics\n";
+  }
+
+  std::ostringstream response;
+  response << "HTTP/1.1 " << status << "\r\n"
+           << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << body;
+  const std::string data = response.str();
+
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+    const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0)
+    {
+      break;
+    }
+    sent += n;
+  }
+};
+
+} // namespace me5413_world
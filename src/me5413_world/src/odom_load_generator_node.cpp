@@ -0,0 +1,335 @@
+/** odom_load_generator_node.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * ROS Node publishing synthetic ground truth odometry at high rates, to find where the other nodes saturate
+ */
+
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+#include <tf2/utils.h>
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+
+#include "me5413_world/odom_load_generator_node.hpp"
+
+namespace me5413_world
+{
+
+// Value at quantile q of sorted values
+static double quantile(const std::vector<double>& sorted, const double q)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  return sorted[std::min(sorted.size() - 1, size_t(q * sorted.size()))];
+}
+
+OdomLoadGeneratorNode::OdomLoadGeneratorNode() :
+  step_(-1),
+  step_start_(0.0),
+  num_sent_(0),
+  num_tf_(0),
+  num_local_paths_(0),
+  last_local_path_(0.0),
+  num_cmd_vels_(0),
+  running_(true)
+{
+  this->pub_odom_ = nh_.advertise<nav_msgs::Odometry>("/gazebo/ground_truth/state", 100);
+  this->sub_tf_ = nh_.subscribe("/tf", 1000, &OdomLoadGeneratorNode::tfCallback, this);
+  this->sub_local_path_ = nh_.subscribe("/me5413_world/planning/local_path", 10, &OdomLoadGeneratorNode::localPathCallback, this);
+  this->sub_cmd_vel_ = nh_.subscribe("/jackal_velocity_controller/cmd_vel", 10, &OdomLoadGeneratorNode::cmdVelCallback, this);
+
+  // Track and motion, the same lemniscate as the path publisher by default
+  ros::NodeHandle nh_private("~");
+  const double track_A_axis = nh_private.param<double>("track_A_axis", 8.0);
+  const double track_B_axis = nh_private.param<double>("track_B_axis", 8.0);
+  const int track_wp_num = nh_private.param<int>("track_wp_num", 500);
+  this->path_ = createLemniscatePath(track_A_axis, track_B_axis, 1.0/track_wp_num);
+  this->path_s_ = computeArcLength(this->path_);
+  nh_private.param<double>("speed", this->speed_, 0.5);
+  nh_private.param<std::string>("world_frame", this->world_frame_, "world");
+  nh_private.param<std::string>("robot_frame", this->robot_frame_, "base_link");
+
+  // Disturbances, all off by default
+  this->rng_.seed(nh_private.param<int>("seed", 0));
+  nh_private.param<double>("position_noise", this->position_noise_, 0.0);
+  nh_private.param<double>("heading_noise", this->heading_noise_, 0.0);
+  nh_private.param<double>("speed_noise", this->speed_noise_, 0.0);
+  nh_private.param<double>("jitter", this->jitter_, 0.0);
+  nh_private.param<int>("burst_size", this->burst_size_, 1);
+  nh_private.param<double>("burst_period", this->burst_period_, 1.0);
+  nh_private.param<double>("out_of_order_probability", this->out_of_order_probability_, 0.0);
+
+  // Rate steps [Hz], each held for step_duration [s]
+  nh_private.param<std::vector<double>>("rates", this->rates_, {50.0, 100.0, 500.0, 1000.0, 2000.0, 5000.0});
+  nh_private.param<double>("step_duration", this->step_duration_, 10.0);
+  nh_private.param<std::string>("output_file", this->output_file_, "/tmp/odom_load.json");
+
+  this->thread_ = std::thread(&OdomLoadGeneratorNode::publishLoop, this);
+};
+
+OdomLoadGeneratorNode::~OdomLoadGeneratorNode()
+{
+  this->running_ = false;
+  if (this->thread_.joinable())
+  {
+    this->thread_.join();
+  }
+};
+
+void OdomLoadGeneratorNode::publishLoop()
+{
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point time_start = Clock::now();
+  Clock::time_point time_next = time_start;
+  Clock::time_point time_next_burst = time_start;
+  std::normal_distribution<double> jitter(0.0, this->jitter_);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  nav_msgs::OdometryPtr held;
+
+  startStep(0);
+  while (this->running_ && ros::ok())
+  {
+    // Move on to the next rate once the step is over
+    if (ros::WallTime::now().toSec() - this->step_start_ >= this->step_duration_)
+    {
+      const LoadStepResult result = finishStep();
+      this->results_.push_back(result);
+      ROS_INFO("Odometry at %.0fHz: processed at %.0fHz (age %.2fms mean, %.2fms p99), local path at %.1fHz (jitter %.2fms), cmd_vel at %.1fHz",
+               result.offered_rate, result.odom_processed_rate, 1e3 * result.odom_age_mean, 1e3 * result.odom_age_p99,
+               result.local_path_rate, 1e3 * result.local_path_jitter, result.cmd_vel_rate);
+      if (this->step_ + 1 >= int(this->rates_.size()))
+      {
+        writeResults();
+        ros::requestShutdown();
+        break;
+      }
+      startStep(this->step_ + 1);
+    }
+
+    // Several messages back to back at the start of every burst period
+    int num_messages = 1;
+    const Clock::time_point now = Clock::now();
+    if (this->burst_size_ > 1 && now >= time_next_burst)
+    {
+      num_messages = this->burst_size_;
+      time_next_burst = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(this->burst_period_));
+    }
+
+    for (int i = 0; i < num_messages; i++)
+    {
+      nav_msgs::OdometryPtr odom = createOdometry(std::chrono::duration<double>(Clock::now() - time_start).count());
+
+      // Hold a message back so that it is sent after a newer one
+      if (!held && uniform(this->rng_) < this->out_of_order_probability_)
+      {
+        held = odom;
+        continue;
+      }
+      std::vector<nav_msgs::OdometryPtr> messages(1, odom);
+      if (held)
+      {
+        messages.push_back(held);
+        held.reset();
+      }
+
+      for (const nav_msgs::OdometryPtr& message : messages)
+      {
+        const double x = message->pose.pose.position.x;
+        const double y = message->pose.pose.position.y;
+        this->pub_odom_.publish(message);
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        const double send_time = ros::Time::now().toSec();
+        this->num_sent_++;
+        this->sent_.push_back(SentOdometry{x, y, send_time});
+        while (!this->sent_.empty() && this->sent_.front().time < send_time - 2.0)
+        {
+          this->sent_.pop_front();
+        }
+      }
+    }
+
+    // Next period, with jitter, without catching up after a stall
+    const double period = std::max(0.0, 1.0 / this->rates_[this->step_] + (this->jitter_ > 0.0? jitter(this->rng_) : 0.0));
+    time_next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+    if (time_next < Clock::now() - std::chrono::milliseconds(100))
+    {
+      time_next = Clock::now();
+    }
+    std::this_thread::sleep_until(time_next);
+  }
+};
+
+nav_msgs::OdometryPtr OdomLoadGeneratorNode::createOdometry(const double t)
+{
+  // Interpolate along the closed track at the constant speed
+  const double s = std::fmod(this->speed_ * t, this->path_s_.back());
+  const int id_upper = std::upper_bound(this->path_s_.begin(), this->path_s_.end(), s) - this->path_s_.begin();
+  const int id = std::min(std::max(1, id_upper), int(this->path_.size()) - 1);
+  const Pose2D& wp_prev = this->path_[id - 1];
+  const Pose2D& wp_next = this->path_[id];
+  const double ds = this->path_s_[id] - this->path_s_[id - 1];
+  const double ratio = (ds > 0.0)? (s - this->path_s_[id - 1]) / ds : 0.0;
+
+  std::normal_distribution<double> normal(0.0, 1.0);
+  const double yaw = wp_prev.yaw + this->heading_noise_ * normal(this->rng_);
+  const double speed = this->speed_ + this->speed_noise_ * normal(this->rng_);
+
+  nav_msgs::OdometryPtr odom(new nav_msgs::Odometry());
+  odom->header.stamp = ros::Time::now();
+  odom->header.frame_id = this->world_frame_;
+  odom->child_frame_id = this->robot_frame_;
+  odom->pose.pose.position.x = wp_prev.x + ratio * (wp_next.x - wp_prev.x) + this->position_noise_ * normal(this->rng_);
+  odom->pose.pose.position.y = wp_prev.y + ratio * (wp_next.y - wp_prev.y) + this->position_noise_ * normal(this->rng_);
+  tf2::Quaternion q;
+  q.setRPY(0.0, 0.0, yaw);
+  odom->pose.pose.orientation = tf2::toMsg(q);
+  // Linear velocity in the world frame, as reported by the Gazebo ground truth plugin
+  odom->twist.twist.linear.x = speed * std::cos(yaw);
+  odom->twist.twist.linear.y = speed * std::sin(yaw);
+
+  return odom;
+};
+
+void OdomLoadGeneratorNode::tfCallback(const tf2_msgs::TFMessage::ConstPtr& tf)
+{
+  for (const geometry_msgs::TransformStamped& transform : tf->transforms)
+  {
+    // The path publisher broadcasts the inverse of every odometry it processes
+    if (transform.header.frame_id != this->robot_frame_ || transform.child_frame_id != this->world_frame_)
+    {
+      continue;
+    }
+    const double yaw = tf2::getYaw(transform.transform.rotation);
+    const double tx = transform.transform.translation.x;
+    const double ty = transform.transform.translation.y;
+    const double x = -(std::cos(yaw) * tx - std::sin(yaw) * ty);
+    const double y = -(std::sin(yaw) * tx + std::cos(yaw) * ty);
+
+    // Match it with the odometry it came from, most likely one of the latest
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->num_tf_++;
+    for (auto sent = this->sent_.rbegin(); sent != this->sent_.rend(); ++sent)
+    {
+      if (std::hypot(sent->x - x, sent->y - y) < 1e-6)
+      {
+        this->odom_ages_.push_back(transform.header.stamp.toSec() - sent->time);
+        break;
+      }
+    }
+  }
+};
+
+void OdomLoadGeneratorNode::localPathCallback(const nav_msgs::Path::ConstPtr& path)
+{
+  const double now = ros::WallTime::now().toSec();
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  if (this->num_local_paths_ > 0)
+  {
+    this->local_path_periods_.push_back(now - this->last_local_path_);
+  }
+  this->num_local_paths_++;
+  this->last_local_path_ = now;
+};
+
+void OdomLoadGeneratorNode::cmdVelCallback(const geometry_msgs::Twist::ConstPtr& cmd_vel)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->num_cmd_vels_++;
+};
+
+void OdomLoadGeneratorNode::startStep(const int step)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->step_ = step;
+  this->step_start_ = ros::WallTime::now().toSec();
+  this->num_sent_ = 0;
+  this->num_tf_ = 0;
+  this->odom_ages_.clear();
+  this->num_local_paths_ = 0;
+  this->local_path_periods_.clear();
+  this->num_cmd_vels_ = 0;
+};
+
+LoadStepResult OdomLoadGeneratorNode::finishStep()
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  const double duration = std::max(1e-9, ros::WallTime::now().toSec() - this->step_start_);
+
+  LoadStepResult result;
+  result.target_rate = this->rates_[this->step_];
+  result.offered_rate = this->num_sent_ / duration;
+  result.odom_processed_rate = this->num_tf_ / duration;
+  result.local_path_rate = this->num_local_paths_ / duration;
+  result.cmd_vel_rate = this->num_cmd_vels_ / duration;
+
+  double mean = 0.0, sqr_sum = 0.0;
+  for (const double period : this->local_path_periods_)
+  {
+    mean += period / this->local_path_periods_.size();
+  }
+  for (const double period : this->local_path_periods_)
+  {
+    sqr_sum += std::pow(period - mean, 2);
+  }
+  result.local_path_jitter = this->local_path_periods_.empty()? 0.0 : std::sqrt(sqr_sum / this->local_path_periods_.size());
+
+  std::sort(this->odom_ages_.begin(), this->odom_ages_.end());
+  result.odom_age_mean = 0.0;
+  for (const double age : this->odom_ages_)
+  {
+    result.odom_age_mean += age / this->odom_ages_.size();
+  }
+  result.odom_age_p99 = quantile(this->odom_ages_, 0.99);
+
+  return result;
+};
+
+void OdomLoadGeneratorNode::writeResults() const
+{
+  std::ofstream output(this->output_file_);
+  output << "{\"position_noise\": " << this->position_noise_ << ", \"heading_noise\": " << this->heading_noise_
+         << ", \"speed_noise\": " << this->speed_noise_ << ", \"jitter\": " << this->jitter_
+         << ", \"burst_size\": " << this->burst_size_ << ", \"burst_period\": " << this->burst_period_
+         << ", \"out_of_order_probability\": " << this->out_of_order_probability_ << ", \"steps\": [";
+  for (int i = 0; i < int(this->results_.size()); i++)
+  {
+    const LoadStepResult& result = this->results_[i];
+    output << (i > 0? ", " : "") << "{\"target_rate\": " << result.target_rate
+           << ", \"offered_rate\": " << result.offered_rate
+           << ", \"odom_processed_rate\": " << result.odom_processed_rate
+           << ", \"odom_age_mean_ms\": " << 1e3 * result.odom_age_mean
+           << ", \"odom_age_p99_ms\": " << 1e3 * result.odom_age_p99
+           << ", \"local_path_rate\": " << result.local_path_rate
+           << ", \"local_path_jitter_ms\": " << 1e3 * result.local_path_jitter
+           << ", \"cmd_vel_rate\": " << result.cmd_vel_rate << "}";
+  }
+  output << "]}\n";
+
+  if (output)
+  {
+    ROS_INFO("Load test results written to %s", this->output_file_.c_str());
+  }
+  else
+  {
+    ROS_WARN("Failed to write the load test results to %s", this->output_file_.c_str());
+  }
+};
+
+} // namespace me5413_world
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "odom_load_generator_node");
+  me5413_world::OdomLoadGeneratorNode odom_load_generator_node;
+  ros::spin();  // spin the ros node.
+  return 0;
+}
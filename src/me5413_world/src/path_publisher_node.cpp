@@ -8,6 +8,8 @@
  */
 
 #include "me5413_world/path_publisher_node.hpp"
+#include "me5413_world/probes.hpp"
+#include "me5413_world/thread_pool.hpp"
 
 namespace me5413_world
 {
@@ -19,10 +21,45 @@ double TRACK_B_AXIS;
 double TRACK_WP_NUM;
 double LOCAL_PREV_WP_NUM;
 double LOCAL_NEXT_WP_NUM;
-bool PARAMS_UPDATED = false;
+bool LOCAL_WINDOW_ADAPTIVE;
+double LOCAL_TIME_HORIZON;
+double LOCAL_LOOKAHEAD;
+double LOCAL_MIN_LENGTH;
+double LOCAL_MAX_LENGTH;
+bool CONTINUOUS_LAPS;
+bool LOAD_SHEDDING;
+double CYCLE_BUDGET;
+bool RACING_LINE;
+double CORRIDOR_WIDTH;
+double RACING_MAX_SPEED;
+double RACING_LATERAL_ACCEL;
+double RACING_LONGITUDINAL_ACCEL;
+bool PARAMS_UPDATED = false;        // new track geometry, the global path is regenerated from its start
+bool RACING_PARAMS_UPDATED = false; // the racing line is swapped in or out, the progress is kept
+
+// Load shedding levels, each level also sheds everything of the levels below
+enum SheddingLevel
+{
+  SHED_NONE = 0,
+  SHED_VISUALIZATION = 1,  // global path and heatmap at a tenth of their rate
+  SHED_LOCAL_WINDOW = 2,   // half of local_next_wp_num, never fewer than the tracker needs
+  SHED_METRICS = 3         // error topics at a fifth of their rate
+};
+
+// Largest path answered by the query service
+constexpr double kMaxQueryPoses = 100000;
+// Racing lines kept in the cache
+constexpr size_t kMaxCachedRacingLines = 16;
 
 void dynamicParamCallback(me5413_world::path_publisherConfig& config, uint32_t level)
 {
+  // Only these change the global path, everything else is read live
+  const bool track_changed = config.track_A_axis != TRACK_A_AXIS || config.track_B_axis != TRACK_B_AXIS
+                             || config.track_wp_num != int(TRACK_WP_NUM);
+  const bool racing_changed = config.racing_line != RACING_LINE || config.corridor_width != CORRIDOR_WIDTH
+                              || config.racing_max_speed != RACING_MAX_SPEED || config.racing_lateral_accel != RACING_LATERAL_ACCEL
+                              || config.racing_longitudinal_accel != RACING_LONGITUDINAL_ACCEL;
+
   // Common Params
   SPEED_TARGET = config.speed_target;
   // Global Path Settings
@@ -31,15 +68,64 @@ void dynamicParamCallback(me5413_world::path_publisherConfig& config, uint32_t l
   TRACK_WP_NUM = config.track_wp_num;
   LOCAL_PREV_WP_NUM = config.local_prev_wp_num;
   LOCAL_NEXT_WP_NUM = config.local_next_wp_num;
-  PARAMS_UPDATED = true;
+  LOCAL_WINDOW_ADAPTIVE = config.local_window_adaptive;
+  LOCAL_TIME_HORIZON = config.local_time_horizon;
+  LOCAL_LOOKAHEAD = config.local_lookahead;
+  LOCAL_MIN_LENGTH = config.local_min_length;
+  LOCAL_MAX_LENGTH = config.local_max_length;
+  CONTINUOUS_LAPS = config.continuous_laps;
+  LOAD_SHEDDING = config.load_shedding;
+  CYCLE_BUDGET = config.cycle_budget;
+  RACING_LINE = config.racing_line;
+  CORRIDOR_WIDTH = config.corridor_width;
+  RACING_MAX_SPEED = config.racing_max_speed;
+  RACING_LATERAL_ACCEL = config.racing_lateral_accel;
+  RACING_LONGITUDINAL_ACCEL = config.racing_longitudinal_accel;
+  PARAMS_UPDATED = PARAMS_UPDATED || track_changed;
+  RACING_PARAMS_UPDATED = RACING_PARAMS_UPDATED || racing_changed;
+};
+
+// Identity of a mission path in the checkpoints (FNV-1a of its waypoints), 0 for the lemniscate
+uint64_t hashRoutePath(const std::vector<Pose2D>& path)
+{
+  if (path.empty())
+  {
+    return 0;
+  }
+
+  uint64_t hash = 14695981039346656037ULL;
+  for (const Pose2D& wp : path)
+  {
+    const double values[3] = {wp.x, wp.y, wp.yaw};
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+    for (size_t i = 0; i < sizeof(values); i++)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+  }
+  return hash;
+};
+
+// Everything the racing line of the lemniscate depends on
+std::vector<double> racingLineKey(const double A, const double B, const double t_res)
+{
+  return {A, B, t_res, CORRIDOR_WIDTH, RACING_MAX_SPEED, RACING_LATERAL_ACCEL, RACING_LONGITUDINAL_ACCEL};
+};
+
+// Whether a reconfigure request carries any parameter at all
+bool isConfigEmpty(const dynamic_reconfigure::Config& config)
+{
+  return config.bools.empty() && config.ints.empty() && config.doubles.empty() && config.strs.empty();
 };
 
-PathPublisherNode::PathPublisherNode() : tf2_listener_(tf2_buffer_)
+PathPublisherNode::PathPublisherNode() : tf2_listener_(tf2_buffer_), metrics_server_(metrics_)
 {
   f = boost::bind(&dynamicParamCallback, _1, _2);
   server.setCallback(f);
+  AsyncLogger::global().setSink(&rosLogSink);
 
   this->timer_ = nh_.createTimer(ros::Duration(0.1), &PathPublisherNode::timerCallback, this);
+  this->heatmap_timer_ = nh_.createTimer(ros::Duration(1.0), &PathPublisherNode::heatmapTimerCallback, this);
   this->sub_robot_odom_ = nh_.subscribe("/gazebo/ground_truth/state", 1, &PathPublisherNode::robotOdomCallback, this);
   this->pub_global_path_ = nh_.advertise<nav_msgs::Path>("/me5413_world/planning/global_path", 1);
   this->pub_local_path_ = nh_.advertise<nav_msgs::Path>("/me5413_world/planning/local_path", 1);
@@ -49,45 +135,150 @@ PathPublisherNode::PathPublisherNode() : tf2_listener_(tf2_buffer_)
   this->pub_rms_position_error_ = nh_.advertise<std_msgs::Float32>("/me5413_world/planning/rms_position_error", 1);
   this->pub_rms_heading_error_ = nh_.advertise<std_msgs::Float32>("/me5413_world/planning/rms_heading_error", 1);
   this->pub_rms_speed_error_ = nh_.advertise<std_msgs::Float32>("/me5413_world/planning/rms_speed_error", 1);
+  this->pub_lap_summary_ = nh_.advertise<me5413_world::LapSummary>("/me5413_world/planning/lap_summary", 10, true);
+  this->pub_error_heatmap_ = nh_.advertise<visualization_msgs::MarkerArray>("/me5413_world/planning/error_heatmap", 1);
+  this->pub_waypoint_errors_ = nh_.advertise<std_msgs::Float32MultiArray>("/me5413_world/planning/waypoint_errors", 1);
+  this->pub_trail_ = nh_.advertise<visualization_msgs::MarkerArray>("/me5413_world/planning/trail", 10);
+  this->pub_load_shedding_ = nh_.advertise<me5413_world::LoadShedding>("/me5413_world/load_shedding", 10);
+  this->pub_cycle_timing_ = nh_.advertise<me5413_world::CycleTiming>("/me5413_world/cycle_timing", 100);
+  this->pub_speed_target_ = nh_.advertise<std_msgs::Float32>("/me5413_world/planning/speed_target", 1);
+  this->srv_reset_episode_ = nh_.advertiseService("/me5413_world/reset_episode", &PathPublisherNode::resetEpisodeCallback, this);
+  this->srv_query_path_ = nh_.advertiseService("/me5413_world/planning/query_path", &PathPublisherNode::queryPathCallback, this);
+  this->srv_plan_mission_ = nh_.advertiseService("/me5413_world/planning/plan_mission", &PathPublisherNode::planMissionCallback, this);
+  this->client_set_model_state_ = nh_.serviceClient<gazebo_msgs::SetModelState>("/gazebo/set_model_state");
+  this->client_tracker_reset_ = nh_.serviceClient<std_srvs::Empty>("/me5413_world/path_tracker_node/reset");
+  this->client_tracker_reconfigure_ = nh_.serviceClient<dynamic_reconfigure::Reconfigure>("/me5413_world/path_tracker_node/set_parameters");
 
   // Initialization
   this->robot_frame_ = "base_link";
   this->world_frame_ = "world";
 
+  // Where the robot is teleported to on reset (same as the spawn pose, slightly above the ground)
+  ros::NodeHandle nh_private("~");
+  nh_private.param<std::string>("robot_model", this->robot_model_, "jackal");
+  nh_private.param<double>("start_x", this->pose_world_start_.position.x, 0.0);
+  nh_private.param<double>("start_y", this->pose_world_start_.position.y, 0.0);
+  nh_private.param<double>("start_z", this->pose_world_start_.position.z, 0.1);
+  tf2::Quaternion q_start;
+  q_start.setRPY(0.0, 0.0, nh_private.param<double>("start_yaw", 0.0));
+  this->pose_world_start_.orientation = tf2::toMsg(q_start);
+
+  // Number of completed laps kept for the lap summary
+  this->lap_stats_ = LapStatistics(nh_private.param<int>("lap_history_size", 100));
+  // Position error [m] shown in full red in the error heatmap
+  nh_private.param<double>("heatmap_max_error", this->heatmap_max_error_, 0.5);
+  this->num_heatmap_updates_ = 0;
+
+  // Driven trail, of constant memory whatever the length of the run
+  const int trail_capacity = nh_private.param<int>("trail_capacity", 2000);
+  this->trail_chunk_size_ = 100;
+  const int num_trail_chunks = std::max(1, (trail_capacity + this->trail_chunk_size_ - 1) / this->trail_chunk_size_);
+  this->trail_ = TrailBuffer(num_trail_chunks * this->trail_chunk_size_, nh_private.param<double>("trail_min_distance", 0.05),
+                             deg2rad(nh_private.param<double>("trail_min_heading_change", 5.0)));
+  this->trail_published_end_ = 0;
+  this->trail_cleared_ = false;
+  this->num_trail_subscribers_ = 0;
+  this->num_trail_updates_ = 0;
+  this->trail_timer_ = nh_.createTimer(ros::Duration(nh_private.param<double>("trail_period", 1.0)), &PathPublisherNode::trailTimerCallback, this);
+  this->load_shedder_ = LoadShedder(SHED_METRICS, CYCLE_BUDGET);
+
+  // Checkpoint for warm restarts, only restored if it is recent enough
+  const std::string checkpoint_file = nh_private.param<std::string>("checkpoint_file", "");
+  nh_private.param<double>("checkpoint_max_age", this->checkpoint_max_age_, 5.0);
+  this->checkpoint_restored_ = checkpoint_file.empty();
+  if (!checkpoint_file.empty() && !this->checkpoint_.open(checkpoint_file))
+  {
+    ROS_WARN("Failed to open the checkpoint file %s", checkpoint_file.c_str());
+  }
+
+  setupMetrics();
+  this->route_id_ = 0;
+  loadRoutes();
+
   this->global_path_msg_.header.frame_id = this->world_frame_;
   this->local_path_msg_.header.frame_id = this->world_frame_;
-  this->global_path_msg_.poses = createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
+  createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
 
+  resetEpisode();
+};
+
+void PathPublisherNode::resetEpisode()
+{
   this->abs_position_error_.data = 0.0;
   this->abs_heading_error_.data = 0.0;
+  this->abs_speed_error_.data = 0.0;
   this->rms_position_error_.data = 0.0;
   this->rms_heading_error_.data = 0.0;
+  this->rms_speed_error_.data = 0.0;
 
   this->current_id_ = 0;
+  this->goal_id_ = -1;
   this->num_time_steps_ = 1;
   this->sum_sqr_position_error_ = 0.0;
   this->sum_sqr_heading_error_ = 0.0;
+  this->sum_sqr_speed_error_ = 0.0;
+  this->lap_stats_.reset();
+  this->error_map_.resize(this->global_path_.size());
+  this->trail_.clear();
+  this->trail_published_end_ = 0;
+  this->trail_cleared_ = true;
 };
 
 void PathPublisherNode::timerCallback(const ros::TimerEvent &)
 {
+  const ros::WallTime time_cycle_start = ros::WallTime::now();
+  const int shedding_level = this->load_shedder_.level();
+
   // Create and Publish Paths
   if (PARAMS_UPDATED)
   {
-    this->global_path_msg_.poses = createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
+    createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
     this->current_id_ = 0;
     PARAMS_UPDATED = false;
+    RACING_PARAMS_UPDATED = false;
+  }
+  else if (RACING_PARAMS_UPDATED)
+  {
+    // The racing line keeps the waypoint ids of the centreline, so the robot carries on from where it is
+    if (this->route_path_.empty())
+    {
+      createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
+    }
+    RACING_PARAMS_UPDATED = false;
+  }
+  if (!this->checkpoint_restored_)
+  {
+    restoreCheckpoint();
+  }
+  collectRacingLine();
+  if (shedding_level < SHED_VISUALIZATION || this->num_time_steps_ % 10 == 0)
+  {
+    publishGlobalPath();
+  }
+  // Near the start there is nothing behind, so the waypoints ahead alone must reach the goals of the tracker and the metrics
+  const int n_wp_post = (shedding_level < SHED_LOCAL_WINDOW)? int(LOCAL_NEXT_WP_NUM) : std::max(int(LOCAL_NEXT_WP_NUM) / 2, minLocalPathPoses(LOCAL_PREV_WP_NUM));
+  const bool local_path_published = publishLocalPath(this->odom_world_robot_.pose.pose, LOCAL_PREV_WP_NUM, n_wp_post);
+
+  // Speed of the profile at the goal on a racing line, the tracker follows it instead of its own target
+  this->speed_target_.data = SPEED_TARGET;
+  if (!this->racing_speeds_.empty() && this->goal_id_ >= 0 && this->goal_id_ < int(this->racing_speeds_.size()))
+  {
+    this->speed_target_.data = this->racing_speeds_[this->goal_id_];
+    this->pub_speed_target_.publish(this->speed_target_);
   }
-  publishGlobalPath();
-  publishLocalPath(this->odom_world_robot_.pose.pose, LOCAL_PREV_WP_NUM, LOCAL_NEXT_WP_NUM);
 
   // Calculate absolute errors (wrt to world frame)
-  const std::pair<double, double> abs_errors = calculatePoseError(this->odom_world_robot_.pose.pose, this->pose_world_goal_);
+  const std::pair<double, double> abs_errors = calculatePoseError(
+    convertPoseToPose2D(this->odom_world_robot_.pose.pose), convertPoseToPose2D(this->pose_world_goal_));
   this->abs_position_error_.data = abs_errors.first;
   this->abs_heading_error_.data = abs_errors.second;
   tf2::Vector3 velocity;
   tf2::fromMsg(this->odom_world_robot_.twist.twist.linear, velocity);
-  this->abs_speed_error_.data = velocity.length() - SPEED_TARGET;
+  this->abs_speed_error_.data = velocity.length() - this->speed_target_.data;
+  this->metric_position_error_->observe(abs_errors.first);
+  this->metric_heading_error_->observe(std::fabs(abs_errors.second));
+  this->metric_speed_error_->observe(std::fabs(this->abs_speed_error_.data));
+  ME5413_PROBE3(tracking_error, toProbeMicro(abs_errors.first), toProbeMicro(abs_errors.second), toProbeMicro(this->abs_speed_error_.data));
 
   // Calculate average errors
   this->sum_sqr_position_error_ += std::pow(abs_errors.first, 2);
@@ -96,18 +287,336 @@ void PathPublisherNode::timerCallback(const ros::TimerEvent &)
   this->rms_position_error_.data = std::sqrt(sum_sqr_position_error_/num_time_steps_);
   this->rms_heading_error_.data = std::sqrt(sum_sqr_heading_error_/num_time_steps_);
   this->rms_speed_error_.data = std::sqrt(sum_sqr_speed_error_/num_time_steps_);
+  if (local_path_published)
+  {
+    // The goal is stale once the end of the track is reached, it would collect every later sample
+    this->error_map_.addSample(this->goal_id_, abs_errors.first, abs_errors.second);
+  }
+  const Pose2D robot = convertPoseToPose2D(this->odom_world_robot_.pose.pose);
+  this->trail_.addPose(robot.x, robot.y, robot.yaw, abs_errors.first);
+  if (CONTINUOUS_LAPS)
+  {
+    this->lap_stats_.addSample(ros::Time::now().toSec(), abs_errors.first, abs_errors.second, this->abs_speed_error_.data, velocity.length());
+  }
 
   // Publish errors
-  this->pub_abs_position_error_.publish(this->abs_position_error_);
-  this->pub_abs_heading_error_.publish(this->abs_heading_error_);
-  this->pub_abs_speed_error_.publish(this->abs_speed_error_);
-  this->pub_rms_position_error_.publish(this->rms_position_error_);
-  this->pub_rms_heading_error_.publish(this->rms_heading_error_);
-  this->pub_rms_speed_error_.publish(this->rms_speed_error_);
+  if (shedding_level < SHED_METRICS || this->num_time_steps_ % 5 == 0)
+  {
+    this->pub_abs_position_error_.publish(this->abs_position_error_);
+    this->pub_abs_heading_error_.publish(this->abs_heading_error_);
+    this->pub_abs_speed_error_.publish(this->abs_speed_error_);
+    this->pub_rms_position_error_.publish(this->rms_position_error_);
+    this->pub_rms_heading_error_.publish(this->rms_heading_error_);
+    this->pub_rms_speed_error_.publish(this->rms_speed_error_);
+  }
 
   // Count
   this->num_time_steps_++;
 
+  saveCheckpoint();
+  const double cycle_time = (ros::WallTime::now() - time_cycle_start).toSec();
+  updateLoadShedding(cycle_time);
+  publishCycleTiming(cycle_time);
+
+  this->metric_cycles_->increment();
+  this->metric_cycle_duration_->observe(cycle_time);
+  if (cycle_time > CYCLE_BUDGET)
+  {
+    this->metric_cycle_overruns_->increment();
+  }
+  this->metric_shedding_level_->set(this->load_shedder_.level());
+
+  return;
+};
+
+void PathPublisherNode::updateLoadShedding(const double cycle_time)
+{
+  if (!LOAD_SHEDDING)
+  {
+    if (this->load_shedder_.level() != SHED_NONE)
+    {
+      ME5413_LOG_INFO("Load shedding disabled, restoring all levels");
+    }
+    this->load_shedder_.reset();
+    return;
+  }
+
+  this->load_shedder_.setBudget(CYCLE_BUDGET);
+  if (!this->load_shedder_.update(ros::Time::now().toSec(), cycle_time))
+  {
+    return;
+  }
+
+  // Record the transition
+  const LoadSheddingTransition& transition = this->load_shedder_.transitions().back();
+  me5413_world::LoadShedding load_shedding;
+  load_shedding.header.stamp = ros::Time::now();
+  load_shedding.node = ros::this_node::getName();
+  load_shedding.from_level = transition.from_level;
+  load_shedding.to_level = transition.to_level;
+  load_shedding.cycle_time = transition.cycle_time;
+  load_shedding.budget = this->load_shedder_.budget();
+  this->pub_load_shedding_.publish(load_shedding);
+
+  ME5413_LOG_WARN("Load shedding level %d -> %d (cycle time %.4fs, budget %.4fs)",
+                  transition.from_level, transition.to_level, transition.cycle_time, this->load_shedder_.budget());
+
+  return;
+};
+
+void PathPublisherNode::publishCycleTiming(const double cycle_time)
+{
+  // Nothing is built when no dashboard listens
+  if (this->pub_cycle_timing_.getNumSubscribers() == 0)
+  {
+    return;
+  }
+
+  me5413_world::CycleTiming timing;
+  timing.header.stamp = ros::Time::now();
+  timing.node = ros::this_node::getName();
+  timing.duration = cycle_time;
+  timing.budget = CYCLE_BUDGET;
+  timing.shedding_level = this->load_shedder_.level();
+  timing.local_path_age = -1.0;
+  timing.odom_age = -1.0;
+  this->pub_cycle_timing_.publish(timing);
+
+  return;
+};
+
+void PathPublisherNode::saveCheckpoint()
+{
+  if (!this->checkpoint_.isOpen())
+  {
+    return;
+  }
+
+  PublisherCheckpoint checkpoint;
+  checkpoint.stamp = ros::Time::now().toSec();
+  checkpoint.track_A_axis = TRACK_A_AXIS;
+  checkpoint.track_B_axis = TRACK_B_AXIS;
+  checkpoint.track_wp_num = TRACK_WP_NUM;
+  checkpoint.route_id = this->route_id_;
+  checkpoint.current_id = this->current_id_;
+  checkpoint.num_time_steps = this->num_time_steps_;
+  checkpoint.sum_sqr_position_error = this->sum_sqr_position_error_;
+  checkpoint.sum_sqr_heading_error = this->sum_sqr_heading_error_;
+  checkpoint.sum_sqr_speed_error = this->sum_sqr_speed_error_;
+  this->checkpoint_.save(checkpoint);
+
+  return;
+};
+
+void PathPublisherNode::restoreCheckpoint()
+{
+  this->checkpoint_restored_ = true;
+
+  PublisherCheckpoint checkpoint;
+  if (!this->checkpoint_.load(checkpoint))
+  {
+    return;
+  }
+
+  // A checkpoint from another run or another track is of no use
+  const double age = ros::Time::now().toSec() - checkpoint.stamp;
+  if (age < 0.0 || age > this->checkpoint_max_age_)
+  {
+    ROS_INFO("Ignoring a checkpoint from %.1fs ago", age);
+    return;
+  }
+  if (checkpoint.track_A_axis != TRACK_A_AXIS || checkpoint.track_B_axis != TRACK_B_AXIS || checkpoint.track_wp_num != int(TRACK_WP_NUM)
+      || checkpoint.route_id != this->route_id_ || checkpoint.current_id >= int(this->global_path_.size()))
+  {
+    ROS_INFO("Ignoring a checkpoint of another track");
+    return;
+  }
+
+  this->current_id_ = checkpoint.current_id;
+  this->num_time_steps_ = checkpoint.num_time_steps;
+  this->sum_sqr_position_error_ = checkpoint.sum_sqr_position_error;
+  this->sum_sqr_heading_error_ = checkpoint.sum_sqr_heading_error;
+  this->sum_sqr_speed_error_ = checkpoint.sum_sqr_speed_error;
+  ROS_INFO("Resumed from a checkpoint at waypoint %d after %lld time steps", this->current_id_, this->num_time_steps_);
+
+  return;
+};
+
+void PathPublisherNode::trailTimerCallback(const ros::TimerEvent &)
+{
+  // Visualization is the first thing to go under load
+  this->num_trail_updates_++;
+  if (this->load_shedder_.level() >= SHED_VISUALIZATION && this->num_trail_updates_ % 10 != 0)
+  {
+    return;
+  }
+
+  // A new viewer gets the whole trail once
+  const int num_subscribers = this->pub_trail_.getNumSubscribers();
+  if (num_subscribers > this->num_trail_subscribers_)
+  {
+    this->trail_published_end_ = 0;
+  }
+  this->num_trail_subscribers_ = num_subscribers;
+
+  visualization_msgs::MarkerArray trail;
+  if (this->trail_cleared_)
+  {
+    visualization_msgs::Marker delete_all;
+    delete_all.header.frame_id = this->world_frame_;
+    delete_all.ns = "trail";
+    delete_all.action = visualization_msgs::Marker::DELETEALL;
+    trail.markers.push_back(delete_all);
+    this->trail_cleared_ = false;
+  }
+
+  // Chunks with points added since the last update. Chunk c is drawn with the marker id c % num_chunks,
+  // so that the chunk overwritten by the ring buffer is replaced in the viewer as well
+  const uint64_t chunk_size = this->trail_chunk_size_;
+  const uint64_t num_chunks = this->trail_.capacity() / chunk_size;
+  const uint64_t begin = this->trail_.begin();
+  const uint64_t end = this->trail_.end();
+  if (end > std::max(this->trail_published_end_, begin))
+  {
+    const uint64_t last_chunk = (end - 1) / chunk_size;
+    const uint64_t first_chunk = std::max(std::max(this->trail_published_end_, begin) / chunk_size, last_chunk + 1 - std::min(num_chunks, last_chunk + 1));
+    for (uint64_t chunk = first_chunk; chunk <= last_chunk; chunk++)
+    {
+      visualization_msgs::Marker marker;
+      marker.header.stamp = ros::Time::now();
+      marker.header.frame_id = this->world_frame_;
+      marker.ns = "trail";
+      marker.id = chunk % num_chunks;
+      marker.type = visualization_msgs::Marker::LINE_STRIP;
+      marker.action = visualization_msgs::Marker::ADD;
+      marker.pose.orientation.w = 1.0;
+      marker.scale.x = 0.05;
+
+      // Starts at the last point of the previous chunk, so that the strips join up
+      const uint64_t seq_start = (chunk * chunk_size > begin)? chunk * chunk_size - 1 : begin;
+      const uint64_t seq_end = std::min((chunk + 1) * chunk_size, end);
+      for (uint64_t seq = seq_start; seq < seq_end; seq++)
+      {
+        const TrailPoint& trail_point = this->trail_.at(seq);
+        geometry_msgs::Point point;
+        point.x = trail_point.x;
+        point.y = trail_point.y;
+        marker.points.push_back(point);
+
+        // Coloured like the error heatmap, from green to red
+        const double ratio = limitWithinRange(trail_point.position_error / this->heatmap_max_error_, 0.0, 1.0);
+        std_msgs::ColorRGBA color;
+        color.r = ratio;
+        color.g = 1.0 - ratio;
+        color.b = 0.0;
+        color.a = 1.0;
+        marker.colors.push_back(color);
+      }
+      trail.markers.push_back(marker);
+    }
+    this->trail_published_end_ = end;
+  }
+
+  if (!trail.markers.empty())
+  {
+    this->pub_trail_.publish(trail);
+  }
+
+  return;
+};
+
+void PathPublisherNode::setupMetrics()
+{
+  this->metric_cycles_ = &this->metrics_.counter("me5413_publisher_cycles_total", "Publisher cycles");
+  this->metric_cycle_overruns_ = &this->metrics_.counter("me5413_publisher_cycle_overruns_total", "Publisher cycles longer than cycle_budget");
+  this->metric_cycle_duration_ = &this->metrics_.histogram("me5413_publisher_cycle_duration_seconds", "Duration of the publisher cycle",
+                                                          exponentialBuckets(1e-5, 2.0, 14));
+  this->metric_path_regeneration_ = &this->metrics_.histogram("me5413_path_regeneration_seconds", "Duration of the global path generation",
+                                                             exponentialBuckets(1e-5, 2.0, 16));
+  this->metric_position_error_ = &this->metrics_.histogram("me5413_position_error_meters", "Absolute position error wrt the goal",
+                                                          exponentialBuckets(0.01, 2.0, 10));
+  this->metric_heading_error_ = &this->metrics_.histogram("me5413_heading_error_degrees", "Absolute heading error wrt the goal",
+                                                         exponentialBuckets(0.25, 2.0, 10));
+  this->metric_speed_error_ = &this->metrics_.histogram("me5413_speed_error_meters_per_second", "Absolute speed error wrt the target",
+                                                       exponentialBuckets(0.01, 2.0, 8));
+  this->metric_local_path_bytes_ = &this->metrics_.histogram("me5413_local_path_bytes", "Serialized size of the published local path",
+                                                            exponentialBuckets(1024, 2.0, 8));
+  this->metric_shedding_level_ = &this->metrics_.gauge("me5413_publisher_shedding_level", "Current load shedding level");
+
+  // Exporter on a background thread, disabled if no port is given
+  ros::NodeHandle nh_private("~");
+  const int metrics_port = nh_private.param<int>("metrics_port", 0);
+  const std::string metrics_address = nh_private.param<std::string>("metrics_address", "127.0.0.1");
+  if (metrics_port > 0 && !this->metrics_server_.start(metrics_address, metrics_port))
+  {
+    ROS_WARN("Failed to serve metrics on %s:%d", metrics_address.c_str(), metrics_port);
+  }
+
+  return;
+};
+
+void PathPublisherNode::heatmapTimerCallback(const ros::TimerEvent &)
+{
+  // Visualization is the first thing to go under load
+  this->num_heatmap_updates_++;
+  if (this->load_shedder_.level() >= SHED_VISUALIZATION && this->num_heatmap_updates_ % 10 != 0)
+  {
+    return;
+  }
+
+  const int num_wp = this->error_map_.size();
+
+  // Colour every visited waypoint from green (no error) to red (heatmap_max_error)
+  visualization_msgs::Marker marker;
+  marker.header.stamp = ros::Time::now();
+  marker.header.frame_id = this->world_frame_;
+  marker.ns = "error_heatmap";
+  marker.id = 0;
+  marker.type = visualization_msgs::Marker::SPHERE_LIST;
+  marker.action = visualization_msgs::Marker::ADD;
+  marker.pose.orientation.w = 1.0;
+  marker.scale.x = marker.scale.y = marker.scale.z = 0.15;
+
+  // Rows: RMS position error [m], RMS heading error [deg], number of samples
+  std_msgs::Float32MultiArray waypoint_errors;
+  waypoint_errors.layout.dim.resize(2);
+  waypoint_errors.layout.dim[0].label = "rms_position_rms_heading_num_samples";
+  waypoint_errors.layout.dim[0].size = 3;
+  waypoint_errors.layout.dim[0].stride = 3 * num_wp;
+  waypoint_errors.layout.dim[1].label = "waypoint";
+  waypoint_errors.layout.dim[1].size = num_wp;
+  waypoint_errors.layout.dim[1].stride = num_wp;
+  waypoint_errors.data.resize(3 * num_wp);
+
+  for (int i = 0; i < num_wp; i++)
+  {
+    waypoint_errors.data[i] = this->error_map_.rmsPositionError(i);
+    waypoint_errors.data[num_wp + i] = this->error_map_.rmsHeadingError(i);
+    waypoint_errors.data[2 * num_wp + i] = this->error_map_.numSamples(i);
+    if (this->error_map_.numSamples(i) == 0)
+    {
+      continue;
+    }
+
+    geometry_msgs::Point point;
+    point.x = this->global_path_[i].x;
+    point.y = this->global_path_[i].y;
+    marker.points.push_back(point);
+
+    const double ratio = limitWithinRange(this->error_map_.rmsPositionError(i) / this->heatmap_max_error_, 0.0, 1.0);
+    std_msgs::ColorRGBA color;
+    color.r = ratio;
+    color.g = 1.0 - ratio;
+    color.b = 0.0;
+    color.a = 1.0;
+    marker.colors.push_back(color);
+  }
+
+  visualization_msgs::MarkerArray error_heatmap;
+  error_heatmap.markers.push_back(marker);
+  this->pub_error_heatmap_.publish(error_heatmap);
+  this->pub_waypoint_errors_.publish(waypoint_errors);
+
   return;
 };
 
@@ -116,6 +625,7 @@ void PathPublisherNode::robotOdomCallback(const nav_msgs::Odometry::ConstPtr &od
   this->world_frame_ = odom->header.frame_id;
   this->robot_frame_ = odom->child_frame_id;
   this->odom_world_robot_ = *odom.get();
+  ME5413_PROBE1(publisher_odom_received, odom->header.stamp.toNSec());
 
   const tf2::Transform T_world_robot = convertPoseToTransform(this->odom_world_robot_.pose.pose);
   const tf2::Transform T_robot_world = T_world_robot.inverse();
@@ -132,112 +642,528 @@ void PathPublisherNode::robotOdomCallback(const nav_msgs::Odometry::ConstPtr &od
   return;
 };
 
-std::vector<geometry_msgs::PoseStamped> PathPublisherNode::createGlobalPath(const double A, const double B, const double t_res)
+bool PathPublisherNode::queryPathCallback(me5413_world::QueryPath::Request &req, me5413_world::QueryPath::Response &res)
 {
-  std::vector<geometry_msgs::PoseStamped> poses;
-  const double t_increament = t_res * 2 * M_PI;
+  res.path.header.stamp = ros::Time::now();
+  res.path.header.frame_id = this->world_frame_;
+  res.success = false;
+  if (this->global_path_.empty())
+  {
+    res.message = "Global path not created yet";
+    return true;
+  }
+  if (req.resolution < 0.0)
+  {
+    res.message = "Negative resolution";
+    return true;
+  }
 
-  // Calculate the positions
-  for (double t = 0.0; t <= 2 * M_PI; t += t_increament)
+  // Straight from the path store, only the segment is copied
+  const PathView view(this->global_path_, this->global_path_s_, CONTINUOUS_LAPS);
+  res.path_length = view.length();
+  double s_start, s_end;
+  switch (req.mode)
   {
-    geometry_msgs::PoseStamped pose;
-    pose.pose.position.x = A * std::sin(t);
-    pose.pose.position.y = B * std::sin(t) * std::cos(t);
-    poses.push_back(pose);
+    case me5413_world::QueryPath::Request::ARC_LENGTH:
+      s_start = req.start;
+      s_end = req.end;
+      break;
+    case me5413_world::QueryPath::Request::INDEX:
+      s_start = view.arcLengthAt(std::lround(req.start));
+      s_end = view.arcLengthAt(std::lround(req.end));
+      break;
+    case me5413_world::QueryPath::Request::AROUND_POSE:
+    {
+      const Pose2D pose = convertPoseToPose2D(req.pose);
+      const double s_pose = view.project(pose.x, pose.y, pose.yaw);
+      s_start = s_pose - std::max(req.behind, 0.0);
+      s_end = s_pose + std::max(req.ahead, 0.0);
+      break;
+    }
+    default:
+      res.message = "Unknown mode " + std::to_string(req.mode);
+      return true;
+  }
+  if (!view.clampRange(s_start, s_end))
+  {
+    res.message = "The segment ends before it starts";
+    return true;
+  }
+  if (req.resolution > 0.0 && (s_end - s_start) / req.resolution > kMaxQueryPoses)
+  {
+    res.message = "Too many poses, the resolution is too fine for this segment";
+    return true;
   }
 
-  // Calcuate the orientations
+  view.segment(s_start, s_end, req.resolution, this->query_poses_);
   tf2::Quaternion q;
-  for (int i = 0; i < poses.size(); i++)
+  res.path.poses.resize(this->query_poses_.size());
+  for (size_t i = 0; i < this->query_poses_.size(); i++)
   {
-    const double x_d = poses[i + 1].pose.position.x - poses[i].pose.position.x;
-    const double y_d = poses[i + 1].pose.position.y - poses[i].pose.position.y;
-    const double yaw = std::atan2(y_d, x_d);
+    geometry_msgs::PoseStamped& pose = res.path.poses[i];
+    pose.header = res.path.header;
+    pose.pose.position.x = this->query_poses_[i].x;
+    pose.pose.position.y = this->query_poses_[i].y;
+    q.setRPY(0.0, 0.0, this->query_poses_[i].yaw);
+    pose.pose.orientation = tf2::toMsg(q);
+  }
+  res.start_s = s_start;
+  res.end_s = s_end;
+  res.success = true;
 
-    q.setRPY(0.0, 0.0, yaw);
-    q.normalize();
-    poses[i].pose.orientation = tf2::toMsg(q);
+  return true;
+};
+
+bool PathPublisherNode::resetEpisodeCallback(me5413_world::ResetEpisode::Request &req, me5413_world::ResetEpisode::Response &res)
+{
+  res.success = true;
+
+  // Apply the new tracker parameters (in another process, so it is safe to block here)
+  if (!isConfigEmpty(req.tracker_config))
+  {
+    dynamic_reconfigure::Reconfigure srv;
+    srv.request.config = req.tracker_config;
+    if (!this->client_tracker_reconfigure_.call(srv))
+    {
+      res.success = false;
+      res.message += "Failed to apply the tracker parameters. ";
+    }
   }
-  poses.back().pose.orientation = tf2::toMsg(q);
 
-  return poses;
+  // Apply the new publisher parameters on top of the current ones
+  if (!isConfigEmpty(req.publisher_config))
+  {
+    me5413_world::path_publisherConfig config;
+    config.speed_target = SPEED_TARGET;
+    config.track_A_axis = TRACK_A_AXIS;
+    config.track_B_axis = TRACK_B_AXIS;
+    config.track_wp_num = TRACK_WP_NUM;
+    config.local_prev_wp_num = LOCAL_PREV_WP_NUM;
+    config.local_next_wp_num = LOCAL_NEXT_WP_NUM;
+    config.local_window_adaptive = LOCAL_WINDOW_ADAPTIVE;
+    config.local_time_horizon = LOCAL_TIME_HORIZON;
+    config.local_lookahead = LOCAL_LOOKAHEAD;
+    config.local_min_length = LOCAL_MIN_LENGTH;
+    config.local_max_length = LOCAL_MAX_LENGTH;
+    config.continuous_laps = CONTINUOUS_LAPS;
+    config.load_shedding = LOAD_SHEDDING;
+    config.cycle_budget = CYCLE_BUDGET;
+    config.racing_line = RACING_LINE;
+    config.corridor_width = CORRIDOR_WIDTH;
+    config.racing_max_speed = RACING_MAX_SPEED;
+    config.racing_lateral_accel = RACING_LATERAL_ACCEL;
+    config.racing_longitudinal_accel = RACING_LONGITUDINAL_ACCEL;
+    if (config.__fromMessage__(req.publisher_config))
+    {
+      config.__clamp__();
+      this->server.updateConfig(config);
+      dynamicParamCallback(config, 0);
+    }
+    else
+    {
+      res.success = false;
+      res.message += "Failed to apply the publisher parameters. ";
+    }
+  }
+
+  // Teleport the robot back to the start
+  gazebo_msgs::SetModelState set_model_state;
+  set_model_state.request.model_state.model_name = this->robot_model_;
+  set_model_state.request.model_state.pose = this->pose_world_start_;
+  set_model_state.request.model_state.reference_frame = "world";
+  if (!this->client_set_model_state_.call(set_model_state) || !set_model_state.response.success)
+  {
+    res.success = false;
+    res.message += "Failed to teleport " + this->robot_model_ + ". ";
+  }
+
+  // Reset the tracker controllers
+  std_srvs::Empty tracker_reset;
+  if (!this->client_tracker_reset_.call(tracker_reset))
+  {
+    res.success = false;
+    res.message += "Failed to reset the tracker. ";
+  }
+
+  // Reset the progress and the metrics
+  createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
+  PARAMS_UPDATED = false;
+  RACING_PARAMS_UPDATED = false;
+  resetEpisode();
+
+  if (res.success)
+  {
+    res.message = "Episode reset";
+  }
+  ROS_INFO("Reset episode: %s", res.message.c_str());
+
+  return true;
 };
 
-void PathPublisherNode::publishGlobalPath()
+bool PathPublisherNode::planMissionCallback(me5413_world::PlanMission::Request &req, me5413_world::PlanMission::Response &res)
 {
-  // Update the message
-  this->global_path_msg_.header.stamp = ros::Time::now();
-  this->pub_global_path_.publish(this->global_path_msg_);
+  const ros::WallTime time_start = ros::WallTime::now();
+  res.length = 0.0;
+  if (req.goals.empty())
+  {
+    this->route_path_.clear();
+    this->route_id_ = 0;
+    res.success = true;
+    res.message = "Back to the lemniscate track";
+  }
+  else
+  {
+    res.success = planMission(req.goals, req.loop, res.message, res.length);
+  }
+  res.planning_time = (ros::WallTime::now() - time_start).toSec();
+
+  // The new track starts from its first waypoint, the robot stays where it is
+  if (res.success)
+  {
+    createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
+    resetEpisode();
+  }
+  ROS_INFO("Plan mission: %s", res.message.c_str());
+
+  return true;
 };
 
-void PathPublisherNode::publishLocalPath(const geometry_msgs::Pose &robot_pose, const int n_wp_prev, const int n_wp_post)
+void PathPublisherNode::loadRoutes()
 {
-  int id_next = nextWaypoint(robot_pose, this->global_path_msg_, this->current_id_);
-  if (this->global_path_msg_.poses.empty())
+  ros::NodeHandle nh_private("~");
+  nh_private.param<double>("route_waypoint_spacing", this->route_waypoint_spacing_, 0.1);
+  const std::string route_graph_file = nh_private.param<std::string>("route_graph_file", "");
+  if (route_graph_file.empty())
   {
-    ROS_WARN("Global Path not published yet, waiting");
+    return;
   }
-  else if (id_next >= this->global_path_msg_.poses.size() - 1)
+
+  std::string error;
+  if (!loadRouteGraph(route_graph_file, this->route_graph_, error))
   {
-    ROS_WARN("Robot has reached the end of the track, please restart");
+    ROS_ERROR("Failed to load the route graph: %s", error.c_str());
+    return;
   }
-  else
+  this->route_search_.reset(new RouteSearch(this->route_graph_));
+  ROS_INFO("Loaded the route graph %s: %d nodes, %d arcs", route_graph_file.c_str(), this->route_graph_.numNodes(), this->route_graph_.numArcs());
+
+  // Preprocessing once so that every later query only climbs the hierarchy
+  if (nh_private.param<bool>("route_contraction", true))
   {
-    this->current_id_ = std::max(this->current_id_, id_next - 1);
-    int id_start = std::max(id_next - n_wp_prev, 0);
-    int id_end = std::min(id_next + n_wp_post, int(this->global_path_msg_.poses.size() - 1));
+    const ros::WallTime time_start = ros::WallTime::now();
+    this->route_hierarchy_.build(this->route_graph_);
+    ROS_INFO("Contracted the route graph in %.3fs, %d shortcuts", (ros::WallTime::now() - time_start).toSec(), this->route_hierarchy_.numShortcuts());
+  }
 
-    std::vector<geometry_msgs::PoseStamped>::const_iterator start = this->global_path_msg_.poses.begin() + id_start;
-    std::vector<geometry_msgs::PoseStamped>::const_iterator end = this->global_path_msg_.poses.begin() + id_end;
+  // Mission followed from the start
+  std::vector<std::string> mission;
+  nh_private.param<std::vector<std::string>>("mission", mission, std::vector<std::string>());
+  if (!mission.empty())
+  {
+    std::string message;
+    double length;
+    if (planMission(mission, nh_private.param<bool>("mission_loop", false), message, length))
+    {
+      ROS_INFO("Mission of %.1fm: %s", length, message.c_str());
+    }
+    else
+    {
+      ROS_WARN("Failed to plan the mission: %s", message.c_str());
+    }
+  }
 
-    // Update the message
-    this->local_path_msg_.header.stamp = ros::Time::now();
-    this->local_path_msg_.poses = std::vector<geometry_msgs::PoseStamped>(start, end);
-    this->pub_local_path_.publish(this->local_path_msg_);
-    this->pose_world_goal_ = this->local_path_msg_.poses[n_wp_prev].pose;
+  return;
+};
+
+bool PathPublisherNode::planMission(const std::vector<std::string> &goals, const bool loop, std::string &message, double &length)
+{
+  length = 0.0;
+  if (!this->route_search_)
+  {
+    message = "No route graph loaded";
+    return false;
+  }
+  if (goals.size() < 2)
+  {
+    message = "A mission needs at least two goals";
+    return false;
+  }
+
+  std::vector<int> nodes;
+  for (const std::string& goal : goals)
+  {
+    nodes.push_back(this->route_graph_.findNode(goal));
+    if (nodes.back() < 0)
+    {
+      message = "Unknown node " + goal;
+      return false;
+    }
+  }
+  if (loop)
+  {
+    nodes.push_back(nodes.front());
+  }
+
+  // One shortest route per leg, through the hierarchy when it was built
+  std::vector<Route> legs(nodes.size() - 1);
+  for (size_t i = 0; i < legs.size(); i++)
+  {
+    const bool found = this->route_hierarchy_.empty()? this->route_search_->astar(nodes[i], nodes[i + 1], legs[i])
+                                                     : this->route_hierarchy_.query(nodes[i], nodes[i + 1], legs[i]);
+    if (!found)
+    {
+      message = "No route from " + this->route_graph_.node(nodes[i]).name + " to " + this->route_graph_.node(nodes[i + 1]).name;
+      return false;
+    }
+    length += legs[i].length;
+  }
+
+  // The local path of a shorter route would not reach the goals of the tracker and the metrics, it never holds the
+  // last waypoint
+  std::vector<Pose2D> path = stitchRoutes(this->route_graph_, legs, this->route_waypoint_spacing_);
+  const int num_wp_min = minLocalPathPoses(LOCAL_PREV_WP_NUM) + 1;
+  if (int(path.size()) < num_wp_min)
+  {
+    message = "The mission has " + std::to_string(path.size()) + " waypoints, the local path needs at least " + std::to_string(num_wp_min);
+    return false;
+  }
+  this->route_path_.swap(path);
+  this->route_id_ = hashRoutePath(this->route_path_);
+  message = "Planned " + std::to_string(legs.size()) + " legs, " + std::to_string(this->route_path_.size()) + " waypoints";
+
+  return true;
+};
+
+void PathPublisherNode::createGlobalPath(const double A, const double B, const double t_res)
+{
+  ME5413_PROBE1(path_regen_start, int(std::lround(1.0/t_res)));
+  const ros::WallTime time_start = ros::WallTime::now();
+  this->global_path_ = this->route_path_.empty()? createLemniscatePath(A, B, t_res) : this->route_path_;
+  this->racing_speeds_.clear();
+
+  // The centreline is followed until its racing line is optimized
+  if (RACING_LINE && this->route_path_.empty())
+  {
+    const RacingLine* line = findRacingLine(this->global_path_, racingLineKey(A, B, t_res));
+    if (line)
+    {
+      this->global_path_ = line->path;
+      this->racing_speeds_ = line->speeds;
+    }
   }
+  this->global_path_s_ = computeArcLength(this->global_path_);
+  this->error_map_.resize(this->global_path_.size());
+  this->goal_id_ = -1;
+
+  // Convert the waypoints into poses
+  tf2::Quaternion q;
+  this->global_path_msg_.poses.clear();
+  for (const Pose2D& wp : this->global_path_)
+  {
+    geometry_msgs::PoseStamped pose;
+    pose.pose.position.x = wp.x;
+    pose.pose.position.y = wp.y;
+
+    q.setRPY(0.0, 0.0, wp.yaw);
+    q.normalize();
+    pose.pose.orientation = tf2::toMsg(q);
+    this->global_path_msg_.poses.push_back(pose);
+  }
+  ME5413_PROBE1(path_regen_end, int(this->global_path_.size()));
+  this->metric_path_regeneration_->observe((ros::WallTime::now() - time_start).toSec());
+
+  return;
 };
 
-int PathPublisherNode::closestWaypoint(const geometry_msgs::Pose &robot_pose, const nav_msgs::Path &path, const int id_start = 0)
+const RacingLine* PathPublisherNode::findRacingLine(const std::vector<Pose2D> &centreline, const std::vector<double> &key)
 {
-  const double yaw_robot = getYawFromOrientation(robot_pose.orientation);
+  // A line that does not beat the centreline stays in the cache, so that it is not optimized again, but is not used
+  const std::map<std::vector<double>, RacingLine>::const_iterator cached = this->racing_lines_.find(key);
+  if (cached != this->racing_lines_.end())
+  {
+    return (cached->second.lap_time < cached->second.centreline_lap_time)? &cached->second : nullptr;
+  }
 
-  double min_dist = DBL_MAX;
-  int id_closest = id_start;
-  for (int i = id_start; i < path.poses.size(); i++)
+  // One optimization at a time, off the timer thread
+  if (!this->racing_job_)
   {
-    const double dist = std::hypot(robot_pose.position.x - path.poses[i].pose.position.x, robot_pose.position.y - path.poses[i].pose.position.y);
+    RacingLineOptions options;
+    options.corridor_width = CORRIDOR_WIDTH;
+    options.max_speed = RACING_MAX_SPEED;
+    options.max_lateral_accel = RACING_LATERAL_ACCEL;
+    options.max_accel = RACING_LONGITUDINAL_ACCEL;
+    options.max_decel = RACING_LONGITUDINAL_ACCEL;
 
-    if (dist <= min_dist)
+    const std::shared_ptr<RacingLineJob> job = std::make_shared<RacingLineJob>();
+    job->key = key;
+    this->racing_job_ = job;
+    ThreadPool::global().submit([job, centreline, options]()
     {
-      min_dist = dist;
-      id_closest = i;
+      job->success = optimizeRacingLine(centreline, options, job->line, job->error);
+      job->done.store(true, std::memory_order_release);
+    });
+  }
+
+  return nullptr;
+};
+
+void PathPublisherNode::collectRacingLine()
+{
+  if (!this->racing_job_ || !this->racing_job_->done.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  const std::shared_ptr<RacingLineJob> job = this->racing_job_;
+  this->racing_job_.reset();
+  const bool is_current = (job->key == racingLineKey(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM));
+  const bool is_faster = job->success && job->line.lap_time < job->line.centreline_lap_time;
+
+  if (job->success)
+  {
+    const RacingLine& line = job->line;
+    if (is_faster)
+    {
+      ME5413_LOG_INFO("Racing line optimized in %d iterations%s: max curvature %.3f -> %.3f 1/m, lap time %.2f -> %.2fs",
+                      line.num_iterations, line.converged? "" : " (not converged)", line.centreline_max_curvature,
+                      line.max_curvature, line.centreline_lap_time, line.lap_time);
     }
     else
     {
-      break;
+      ME5413_LOG_WARN("Racing line of %.2fs not faster than the centreline at %.2fs, keeping the centreline",
+                      line.lap_time, line.centreline_lap_time);
+    }
+    if (this->racing_lines_.size() >= kMaxCachedRacingLines)
+    {
+      this->racing_lines_.erase(this->racing_lines_.begin());
     }
+    this->racing_lines_[job->key] = std::move(job->line);
+  }
+  else
+  {
+    // Formatted right away, the job and its error are freed on return
+    ROS_WARN("Failed to optimize the racing line: %s", job->error.c_str());
+  }
+
+  // Swaps the line in, or starts on the current track if it changed in the meantime. The waypoints keep their
+  // ids, so the progress along the track is kept
+  if (RACING_LINE && this->route_path_.empty() && (is_faster || !is_current))
+  {
+    createGlobalPath(TRACK_A_AXIS, TRACK_B_AXIS, 1.0/TRACK_WP_NUM);
   }
 
-  return id_closest;
+  return;
 };
 
-int PathPublisherNode::nextWaypoint(const geometry_msgs::Pose &robot_pose, const nav_msgs::Path &path, const int id_start = 0)
+void PathPublisherNode::publishGlobalPath()
 {
-  int id_closest = closestWaypoint(robot_pose, path, id_start);
-  double yaw_T_robot_wp = atan2((path.poses[id_closest].pose.position.y - robot_pose.position.y),
-                                (path.poses[id_closest].pose.position.x - robot_pose.position.x));
+  // Update the message
+  this->global_path_msg_.header.stamp = ros::Time::now();
+  this->pub_global_path_.publish(this->global_path_msg_);
+};
 
-  const double yaw_robot = getYawFromOrientation(robot_pose.orientation);
-  const double angle = std::fabs(yaw_robot - yaw_T_robot_wp);
-  const double angle_norm = std::min(2 * M_PI - angle, angle); // TODO: check if this is correct
+bool PathPublisherNode::publishLocalPath(const geometry_msgs::Pose &robot_pose, const int n_wp_prev, const int n_wp_post)
+{
+  const Pose2D robot = convertPoseToPose2D(robot_pose);
+  int id_next = nextWaypoint(robot, this->global_path_, this->current_id_);
+  const int num_wp = this->global_path_msg_.poses.size();
+  if (this->global_path_msg_.poses.empty())
+  {
+    ME5413_LOG_WARN_THROTTLE(1.0, "Global Path not published yet, waiting");
+    return false;
+  }
+  else if (id_next >= num_wp - 1 && !CONTINUOUS_LAPS)
+  {
+    ME5413_LOG_WARN_THROTTLE(5.0, "Robot has reached the end of the track, please restart");
+    return false;
+  }
+  else
+  {
+    // Wrap around to the start of the closed track
+    if (id_next >= num_wp - 1)
+    {
+      publishLapSummary(this->lap_stats_.finishLap(ros::Time::now().toSec()));
+      this->current_id_ = 0;
+      id_next = nextWaypoint(robot, this->global_path_, this->current_id_);
+    }
+
+    this->current_id_ = std::max(this->current_id_, id_next - 1);
+    const int n_wp_ahead = computeLocalWindowSize(id_next, n_wp_post);
+
+    // Update the message, the goal of the metrics is n_wp_prev poses into the local path
+    this->local_path_msg_.header.stamp = ros::Time::now();
+    int goal_offset = n_wp_prev;
+    if (CONTINUOUS_LAPS)
+    {
+      this->local_path_msg_.poses.clear();
+      for (int i = id_next - n_wp_prev; i < id_next + n_wp_ahead; i++)
+      {
+        this->local_path_msg_.poses.push_back(this->global_path_msg_.poses[(i % num_wp + num_wp) % num_wp]);
+      }
+      this->goal_id_ = metricGoalIndex(id_next, n_wp_prev, true) % num_wp;
+    }
+    else
+    {
+      int id_start = std::max(id_next - n_wp_prev, 0);
+      int id_end = std::min(id_next + n_wp_ahead, num_wp - 1);
+
+      std::vector<geometry_msgs::PoseStamped>::const_iterator start = this->global_path_msg_.poses.begin() + id_start;
+      std::vector<geometry_msgs::PoseStamped>::const_iterator end = this->global_path_msg_.poses.begin() + id_end;
+      this->local_path_msg_.poses = std::vector<geometry_msgs::PoseStamped>(start, end);
+      // A mission planned before local_prev_wp_num was raised may be too short for the goal
+      this->goal_id_ = std::min(metricGoalIndex(id_next, n_wp_prev, false), id_end - 1);
+      goal_offset = this->goal_id_ - id_start;
+    }
+    ME5413_PROBE3(goal_selected, id_next, this->goal_id_, this->current_id_);
+    this->pub_local_path_.publish(this->local_path_msg_);
+    this->metric_local_path_bytes_->observe(ros::serialization::serializationLength(this->local_path_msg_));
+    ME5413_PROBE2(local_path_published, this->local_path_msg_.header.stamp.toNSec(), int(this->local_path_msg_.poses.size()));
+    this->pose_world_goal_ = this->local_path_msg_.poses[goal_offset].pose;
+  }
+
+  return true;
+};
 
-  if (angle_norm > M_PI / 2)
+int PathPublisherNode::computeLocalWindowSize(const int id_next, const int n_wp_max)
+{
+  // Nothing is behind the robot at the start of the track, the waypoints ahead must reach the goals of the tracker
+  // and the metrics
+  const int n_wp_min = minLocalPathPoses(LOCAL_PREV_WP_NUM);
+  const int n_wp_cap = std::max(n_wp_max, n_wp_min);
+  if (!LOCAL_WINDOW_ADAPTIVE)
   {
-    id_closest++;
+    return n_wp_cap;
   }
 
-  return id_closest;
+  // Distance the robot covers within the time horizon, on top of what the tracker looks ahead
+  tf2::Vector3 velocity;
+  tf2::fromMsg(this->odom_world_robot_.twist.twist.linear, velocity);
+  const double length = limitWithinRange(LOCAL_LOOKAHEAD + velocity.length() * LOCAL_TIME_HORIZON, LOCAL_MIN_LENGTH, LOCAL_MAX_LENGTH);
+
+  const int n_wp = countWaypointsAhead(this->global_path_s_, std::min(id_next, int(this->global_path_s_.size()) - 1), length, CONTINUOUS_LAPS);
+  return std::min(std::max(n_wp, n_wp_min), n_wp_cap);
+};
+
+void PathPublisherNode::publishLapSummary(const LapRecord &record)
+{
+  me5413_world::LapSummary lap_summary;
+  lap_summary.header.stamp = ros::Time::now();
+  lap_summary.header.frame_id = this->world_frame_;
+  lap_summary.lap = record.lap;
+  lap_summary.lap_time = record.lap_time;
+  lap_summary.rms_position_error = record.rms_position_error;
+  lap_summary.rms_heading_error = record.rms_heading_error;
+  lap_summary.rms_speed_error = record.rms_speed_error;
+  lap_summary.max_position_error = record.max_position_error;
+  lap_summary.max_heading_error = record.max_heading_error;
+  lap_summary.max_speed_error = record.max_speed_error;
+  lap_summary.average_speed = record.average_speed;
+  lap_summary.num_laps_in_history = this->lap_stats_.history().size();
+  lap_summary.best_lap_time = this->lap_stats_.bestLapTime();
+  lap_summary.mean_lap_time = this->lap_stats_.meanLapTime();
+  this->pub_lap_summary_.publish(lap_summary);
+
+  ME5413_LOG_INFO("Lap %d completed in %.2fs, RMS position error: %.3fm, RMS heading error: %.2fdeg, average speed: %.2fm/s",
+                  record.lap, record.lap_time, record.rms_position_error, record.rms_heading_error, record.average_speed);
 };
 
 double PathPublisherNode::getYawFromOrientation(const geometry_msgs::Quaternion &orientation)
@@ -251,6 +1177,16 @@ double PathPublisherNode::getYawFromOrientation(const geometry_msgs::Quaternion
   return yaw;
 };
 
+Pose2D PathPublisherNode::convertPoseToPose2D(const geometry_msgs::Pose &pose)
+{
+  Pose2D pose_2d;
+  pose_2d.x = pose.position.x;
+  pose_2d.y = pose.position.y;
+  pose_2d.yaw = getYawFromOrientation(pose.orientation);
+
+  return pose_2d;
+};
+
 tf2::Transform PathPublisherNode::convertPoseToTransform(const geometry_msgs::Pose &pose)
 {
   tf2::Transform T;
@@ -262,33 +1198,6 @@ tf2::Transform PathPublisherNode::convertPoseToTransform(const geometry_msgs::Po
   return T;
 };
 
-std::pair<double, double> PathPublisherNode::calculatePoseError(const geometry_msgs::Pose &pose_robot, const geometry_msgs::Pose &pose_goal)
-{
-  // Positional Error
-  const double position_error = std::hypot(
-    pose_robot.position.x - pose_goal.position.x, 
-    pose_robot.position.y - pose_goal.position.y
-  );
-
-  // Heading Error
-  tf2::Quaternion q_robot, q_wp;
-  tf2::fromMsg(pose_robot.orientation, q_robot);
-  tf2::fromMsg(pose_goal.orientation, q_wp);
-  const tf2::Matrix3x3 m_robot = tf2::Matrix3x3(q_robot);
-  const tf2::Matrix3x3 m_goal = tf2::Matrix3x3(q_wp);
-
-  double roll, pitch, yaw_robot, yaw_wp;
-  m_robot.getRPY(roll, pitch, yaw_robot);
-  m_goal.getRPY(roll, pitch, yaw_wp);
-
-  const double heading_error = (yaw_robot - yaw_wp) / M_PI * 180.0;
-
-  return std::pair<double, double>(
-    position_error, 
-    isnan(heading_error)? 0.0 : heading_error
-  );
-};
-
 } // namespace me5413_world
 
 int main(int argc, char **argv)
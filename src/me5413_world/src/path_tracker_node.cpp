@@ -9,6 +9,8 @@
 
 #include "me5413_world/path_tracker_node.hpp"
 #include "me5413_world/math_utils.hpp"
+#include "me5413_world/tracking_utils.hpp"
+#include "me5413_world/probes.hpp"
 
 namespace me5413_world 
 {
@@ -17,9 +19,21 @@ namespace me5413_world
 double SPEED_TARGET;
 double PID_Kp, PID_Ki, PID_Kd;
 double ROBOT_LENGTH;
-bool DEFAULT_LOOKAHEAD_DISTANCE;
+double DEFAULT_LOOKAHEAD_DISTANCE;
+bool LOAD_SHEDDING;
+double CYCLE_BUDGET;
 bool PARAMS_UPDATED;
 
+// Load shedding levels
+enum SheddingLevel
+{
+  SHED_NONE = 0,
+  SHED_CONTROLLER = 1  // heading-only steering instead of pure pursuit
+};
+
+// Age after which the speed target of the publisher is ignored [s]
+constexpr double kSpeedTargetTimeout = 0.5;
+
 void dynamicParamCallback(me5413_world::path_trackerConfig& config, uint32_t level)
 {
   SPEED_TARGET = config.speed_target;
@@ -28,31 +42,219 @@ void dynamicParamCallback(me5413_world::path_trackerConfig& config, uint32_t lev
   PID_Kd = config.PID_Kd;
   ROBOT_LENGTH = config.robot_length;
   DEFAULT_LOOKAHEAD_DISTANCE = config.lookahead_distance;
+  LOAD_SHEDDING = config.load_shedding;
+  CYCLE_BUDGET = config.cycle_budget;
  
   PARAMS_UPDATED = true;
 };
 
-PathTrackerNode::PathTrackerNode() : tf2_listener_(tf2_buffer_)
+PathTrackerNode::PathTrackerNode() : tf2_listener_(tf2_buffer_), metrics_server_(metrics_)
 {
   f = boost::bind(&dynamicParamCallback, _1, _2);
   server.setCallback(f);
+  AsyncLogger::global().setSink(&rosLogSink);
 
   this->sub_robot_odom_ = nh_.subscribe("/gazebo/ground_truth/state", 1, &PathTrackerNode::robotOdomCallback, this);
   this->sub_local_path_ = nh_.subscribe("/me5413_world/planning/local_path", 1, &PathTrackerNode::localPathCallback, this);
+  this->sub_speed_target_ = nh_.subscribe("/me5413_world/planning/speed_target", 1, &PathTrackerNode::speedTargetCallback, this);
   this->pub_cmd_vel_ = nh_.advertise<geometry_msgs::Twist>("/jackal_velocity_controller/cmd_vel", 1);
+  this->pub_load_shedding_ = nh_.advertise<me5413_world::LoadShedding>("/me5413_world/load_shedding", 10);
+  this->pub_cycle_timing_ = nh_.advertise<me5413_world::CycleTiming>("/me5413_world/cycle_timing", 100);
+  this->srv_reset_ = nh_.advertiseService("/me5413_world/path_tracker_node/reset", &PathTrackerNode::resetCallback, this);
 
   // Initialization
   this->robot_frame_ = "base_link";
   this->world_frame_ = "world";
 
-  this->pid_ = control::PID(0.1, 1.0, -1.0, PID_Kp, PID_Ki, PID_Kd);
+  this->pid_ = control::PID(0.1, 1.0, -1.0, PID_Kp, PID_Kd, PID_Ki);
+  this->speed_target_ = 0.0;
+  this->load_shedder_ = LoadShedder(SHED_CONTROLLER, CYCLE_BUDGET);
+
+  // Checkpoint for warm restarts, only restored if it is recent enough
+  ros::NodeHandle nh_private("~");
+  const std::string checkpoint_file = nh_private.param<std::string>("checkpoint_file", "");
+  nh_private.param<double>("checkpoint_max_age", this->checkpoint_max_age_, 5.0);
+  this->checkpoint_restored_ = checkpoint_file.empty();
+  if (!checkpoint_file.empty() && !this->checkpoint_.open(checkpoint_file))
+  {
+    ROS_WARN("Failed to open the checkpoint file %s", checkpoint_file.c_str());
+  }
+
+  setupMetrics();
 };
 
 void PathTrackerNode::localPathCallback(const nav_msgs::Path::ConstPtr& path)
 {
-  // Calculate absolute errors (wrt to world frame)
-  this->pose_world_goal_ = path->poses[11].pose;
-  this->pub_cmd_vel_.publish(computeControlOutputs(this->odom_world_robot_, this->pose_world_goal_));
+  const ros::WallTime time_cycle_start = ros::WallTime::now();
+  const ros::Time time_received = ros::Time::now();
+  if (!this->checkpoint_restored_)
+  {
+    restoreCheckpoint();
+  }
+
+  // The local path is cut short at the end of an open track, the goal is then its last pose
+  if (path->poses.empty())
+  {
+    ME5413_LOG_WARN_THROTTLE(1.0, "Received an empty local path");
+    return;
+  }
+  this->pose_world_goal_ = path->poses[std::min(kTrackerGoalIndex, int(path->poses.size()) - 1)].pose;
+  const geometry_msgs::Twist cmd_vel = computeControlOutputs(this->odom_world_robot_, this->pose_world_goal_);
+  this->pub_cmd_vel_.publish(cmd_vel);
+
+  saveCheckpoint();
+  const double cycle_time = (ros::WallTime::now() - time_cycle_start).toSec();
+  updateLoadShedding(cycle_time);
+  const double odom_age = this->odom_world_robot_.header.stamp.isZero()? -1.0 : (time_received - this->odom_world_robot_.header.stamp).toSec();
+  publishCycleTiming(cycle_time, (time_received - path->header.stamp).toSec(), odom_age);
+
+  this->metric_cycles_->increment();
+  this->metric_cycle_duration_->observe(cycle_time);
+  if (cycle_time > CYCLE_BUDGET)
+  {
+    this->metric_cycle_overruns_->increment();
+  }
+  this->metric_local_path_bytes_->observe(ros::serialization::serializationLength(*path));
+  this->metric_linear_cmd_->set(cmd_vel.linear.x);
+  this->metric_angular_cmd_->set(cmd_vel.angular.z);
+  this->metric_shedding_level_->set(this->load_shedder_.level());
+
+  return;
+};
+
+void PathTrackerNode::updateLoadShedding(const double cycle_time)
+{
+  if (!LOAD_SHEDDING)
+  {
+    if (this->load_shedder_.level() != SHED_NONE)
+    {
+      ME5413_LOG_INFO("Load shedding disabled, restoring all levels");
+    }
+    this->load_shedder_.reset();
+    return;
+  }
+
+  this->load_shedder_.setBudget(CYCLE_BUDGET);
+  if (!this->load_shedder_.update(ros::Time::now().toSec(), cycle_time))
+  {
+    return;
+  }
+
+  // Record the transition
+  const LoadSheddingTransition& transition = this->load_shedder_.transitions().back();
+  me5413_world::LoadShedding load_shedding;
+  load_shedding.header.stamp = ros::Time::now();
+  load_shedding.node = ros::this_node::getName();
+  load_shedding.from_level = transition.from_level;
+  load_shedding.to_level = transition.to_level;
+  load_shedding.cycle_time = transition.cycle_time;
+  load_shedding.budget = this->load_shedder_.budget();
+  this->pub_load_shedding_.publish(load_shedding);
+
+  ME5413_LOG_WARN("Load shedding level %d -> %d (cycle time %.4fs, budget %.4fs)",
+                  transition.from_level, transition.to_level, transition.cycle_time, this->load_shedder_.budget());
+
+  return;
+};
+
+void PathTrackerNode::publishCycleTiming(const double cycle_time, const double local_path_age, const double odom_age)
+{
+  // Nothing is built when no dashboard listens
+  if (this->pub_cycle_timing_.getNumSubscribers() == 0)
+  {
+    return;
+  }
+
+  me5413_world::CycleTiming timing;
+  timing.header.stamp = ros::Time::now();
+  timing.node = ros::this_node::getName();
+  timing.duration = cycle_time;
+  timing.budget = CYCLE_BUDGET;
+  timing.shedding_level = this->load_shedder_.level();
+  timing.local_path_age = local_path_age;
+  timing.odom_age = odom_age;
+  this->pub_cycle_timing_.publish(timing);
+
+  return;
+};
+
+void PathTrackerNode::saveCheckpoint()
+{
+  if (!this->checkpoint_.isOpen())
+  {
+    return;
+  }
+
+  TrackerCheckpoint checkpoint;
+  checkpoint.stamp = ros::Time::now().toSec();
+  checkpoint.pid_integral = this->pid_.getIntegral();
+  checkpoint.pid_pre_error = this->pid_.getPreviousError();
+  this->checkpoint_.save(checkpoint);
+
+  return;
+};
+
+void PathTrackerNode::restoreCheckpoint()
+{
+  this->checkpoint_restored_ = true;
+
+  TrackerCheckpoint checkpoint;
+  if (!this->checkpoint_.load(checkpoint))
+  {
+    return;
+  }
+
+  // A checkpoint from another run is of no use
+  const double age = ros::Time::now().toSec() - checkpoint.stamp;
+  if (age < 0.0 || age > this->checkpoint_max_age_)
+  {
+    ROS_INFO("Ignoring a checkpoint from %.1fs ago", age);
+    return;
+  }
+
+  this->pid_.setState(checkpoint.pid_integral, checkpoint.pid_pre_error);
+  ROS_INFO("Resumed the PID controller from a checkpoint");
+
+  return;
+};
+
+void PathTrackerNode::setupMetrics()
+{
+  this->metric_cycles_ = &this->metrics_.counter("me5413_tracker_cycles_total", "Tracker cycles");
+  this->metric_cycle_overruns_ = &this->metrics_.counter("me5413_tracker_cycle_overruns_total", "Tracker cycles longer than cycle_budget");
+  this->metric_cycle_duration_ = &this->metrics_.histogram("me5413_tracker_cycle_duration_seconds", "Duration of the tracker cycle",
+                                                          exponentialBuckets(1e-5, 2.0, 14));
+  this->metric_local_path_bytes_ = &this->metrics_.histogram("me5413_tracker_local_path_bytes", "Serialized size of the received local path",
+                                                            exponentialBuckets(1024, 2.0, 8));
+  this->metric_linear_cmd_ = &this->metrics_.gauge("me5413_tracker_linear_cmd_meters_per_second", "Last linear velocity command");
+  this->metric_angular_cmd_ = &this->metrics_.gauge("me5413_tracker_angular_cmd_radians_per_second", "Last angular velocity command");
+  this->metric_shedding_level_ = &this->metrics_.gauge("me5413_tracker_shedding_level", "Current load shedding level");
+
+  // Exporter on a background thread, disabled if no port is given
+  ros::NodeHandle nh_private("~");
+  const int metrics_port = nh_private.param<int>("metrics_port", 0);
+  const std::string metrics_address = nh_private.param<std::string>("metrics_address", "127.0.0.1");
+  if (metrics_port > 0 && !this->metrics_server_.start(metrics_address, metrics_port))
+  {
+    ROS_WARN("Failed to serve metrics on %s:%d", metrics_address.c_str(), metrics_port);
+  }
+
+  return;
+};
+
+bool PathTrackerNode::resetCallback(std_srvs::Empty::Request& req, std_srvs::Empty::Response& res)
+{
+  // Start the next episode without any integrated error
+  this->pid_.reset();
+  this->pub_cmd_vel_.publish(geometry_msgs::Twist());
+
+  return true;
+};
+
+void PathTrackerNode::speedTargetCallback(const std_msgs::Float32::ConstPtr& speed_target)
+{
+  this->speed_target_ = speed_target->data;
+  this->speed_target_stamp_ = ros::Time::now();
 
   return;
 };
@@ -62,6 +264,7 @@ void PathTrackerNode::robotOdomCallback(const nav_msgs::Odometry::ConstPtr& odom
   this->world_frame_ = odom->header.frame_id;
   this->robot_frame_ = odom->child_frame_id;
   this->odom_world_robot_ = *odom.get();
+  ME5413_PROBE1(tracker_odom_received, odom->header.stamp.toNSec());
 
   return;
 };
@@ -76,13 +279,19 @@ geometry_msgs::Twist PathTrackerNode::computeControlOutputs(const nav_msgs::Odom
   // Update PID controller parameters if they are updated dynamically
   if (PARAMS_UPDATED)
   {
-    this->pid_.updateSettings(PID_Kp, PID_Ki, PID_Kd);
+    this->pid_.updateSettings(PID_Kp, PID_Kd, PID_Ki);
     PARAMS_UPDATED = false;
   }
 
   // Compute linear speed using PID controller
+  // Speed profile of the racing line while the publisher sends it
   double target_speed = SPEED_TARGET;
+  if (!this->speed_target_stamp_.isZero() && (ros::Time::now() - this->speed_target_stamp_).toSec() < kSpeedTargetTimeout)
+  {
+    target_speed = this->speed_target_;
+  }
   double linear_speed = this->pid_.calculate(target_speed, velocity);
+  ME5413_PROBE3(pid_terms, toProbeMicro(this->pid_.getPTerm()), toProbeMicro(this->pid_.getITerm()), toProbeMicro(this->pid_.getDTerm()));
 
   //Implement Pure Pursuit Controller for Steering
   double steering = computeSteering(odom_robot, pose_goal);
@@ -90,6 +299,7 @@ geometry_msgs::Twist PathTrackerNode::computeControlOutputs(const nav_msgs::Odom
   geometry_msgs::Twist cmd_vel;
   cmd_vel.linear.x = linear_speed;
   cmd_vel.angular.z = steering;
+  ME5413_PROBE3(control_output, odom_robot.header.stamp.toNSec(), toProbeMicro(cmd_vel.linear.x), toProbeMicro(cmd_vel.angular.z));
 
   // std::cout << "robot velocity is " << velocity << " throttle is " << cmd_vel.linear.x << std::endl;
   // std::cout << "lateral error is " << lat_error << " heading_error is " << heading_error << " steering is " << cmd_vel.angular.z << std::endl;
@@ -99,38 +309,27 @@ geometry_msgs::Twist PathTrackerNode::computeControlOutputs(const nav_msgs::Odom
 
 double PathTrackerNode::computeSteering(const nav_msgs::Odometry& odom_robot, const geometry_msgs::Pose& pose_goal)
 {
-  // Compute heading error
-  double yaw_robot = tf2::getYaw(odom_robot.pose.pose.orientation);
-  double yaw_goal = tf2::getYaw(pose_goal.orientation);
-  double heading_error = unifyAngleRange(yaw_goal - yaw_robot); // Ensure heading error is within [-pi, pi]
-
-  // Compute lateral error
-  tf2::Vector3 point_robot, point_goal;
-  tf2::fromMsg(odom_robot.pose.pose.position, point_robot);
-  tf2::fromMsg(pose_goal.position, point_goal);
-  double dx = point_goal.getX() - point_robot.getX();
-  double dy = point_goal.getY() - point_robot.getY();
-  double alpha = std::atan2(dy, dx) - yaw_robot;
+  Pose2D robot, goal;
+  robot.x = odom_robot.pose.pose.position.x;
+  robot.y = odom_robot.pose.pose.position.y;
+  robot.yaw = tf2::getYaw(odom_robot.pose.pose.orientation);
+  goal.x = pose_goal.position.x;
+  goal.y = pose_goal.position.y;
+  goal.yaw = tf2::getYaw(pose_goal.orientation);
 
-  // Compute lookahead distance
-  double lookahead_distance = computeLookaheadDistance(odom_robot);
-
-  // Compute desired steering angle using the pure pursuit formula
-  double steering = std::atan2(2.0 * ROBOT_LENGTH * std::sin(alpha), lookahead_distance);
-
-  // Incorporate heading error
-  steering += heading_error;
-
-  // Ensure steering angle is within [-pi, pi]
-  steering = unifyAngleRange(steering);
+  // Cheaper steering law while shedding load
+  if (this->load_shedder_.level() >= SHED_CONTROLLER)
+  {
+    return computeHeadingSteering(robot, goal);
+  }
 
-return steering;
+  // Pure pursuit towards the goal, plus the heading error
+  return me5413_world::computeSteering(robot, goal, ROBOT_LENGTH, computeLookaheadDistance(odom_robot));
 }
 
 double PathTrackerNode::computeLookaheadDistance(const nav_msgs::Odometry& odom_robot)
 {
-  double velocity = odom_robot.twist.twist.linear.x;
-  return std::max(1.0, velocity * DEFAULT_LOOKAHEAD_DISTANCE);
+  return me5413_world::computeLookaheadDistance(odom_robot.twist.twist.linear.x, DEFAULT_LOOKAHEAD_DISTANCE);
 }
 
 } // namespace me5413_world
@@ -0,0 +1,239 @@
+/** path_tracking_plugin.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Gazebo model plugin that tracks the figure 8 track in-process, for transport-free evaluation
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "me5413_world/path_tracking_plugin.hpp"
+
+namespace me5413_world
+{
+
+PathTrackingPlugin::PathTrackingPlugin() :
+  linear_cmd_(0.0),
+  angular_cmd_(0.0),
+  finished_(false),
+  episode_id_(0),
+  num_time_steps_(0),
+  sum_sqr_position_error_(0.0),
+  sum_sqr_heading_error_(0.0),
+  sum_sqr_speed_error_(0.0)
+{};
+
+template <typename T>
+T PathTrackingPlugin::getParam(const sdf::ElementPtr& sdf, const std::string& name, const T& default_value) const
+{
+  return sdf->HasElement(name)? sdf->Get<T>(name) : default_value;
+};
+
+void PathTrackingPlugin::Load(gazebo::physics::ModelPtr model, sdf::ElementPtr sdf)
+{
+  this->model_ = model;
+  this->world_ = model->GetWorld();
+
+  // Track settings (same defaults as path_publisher.cfg)
+  this->speed_target_ = getParam<double>(sdf, "speedTarget", 0.5);
+  this->track_A_axis_ = getParam<double>(sdf, "trackAAxis", 8.0);
+  this->track_B_axis_ = getParam<double>(sdf, "trackBAxis", 8.0);
+  this->track_wp_num_ = getParam<int>(sdf, "trackWpNum", 500);
+  this->local_prev_wp_num_ = getParam<int>(sdf, "localPrevWpNum", 10);
+
+  // Controller settings (same defaults as path_tracker.cfg)
+  this->control_period_ = getParam<double>(sdf, "controlPeriod", 0.1);
+  this->robot_length_ = getParam<double>(sdf, "robotLength", 0.5);
+  this->lookahead_distance_ = getParam<double>(sdf, "lookaheadDistance", 0.5);
+  this->wheel_radius_ = getParam<double>(sdf, "wheelRadius", 0.098);
+  this->wheel_separation_ = getParam<double>(sdf, "wheelSeparation", 0.37559);
+  this->pid_Kp_ = getParam<double>(sdf, "pidKp", 0.5);
+  this->pid_Ki_ = getParam<double>(sdf, "pidKi", 0.2);
+  this->pid_Kd_ = getParam<double>(sdf, "pidKd", 0.2);
+
+  // Episode settings
+  this->num_episodes_ = getParam<int>(sdf, "numEpisodes", 1);
+  this->episode_timeout_ = getParam<double>(sdf, "episodeTimeout", 300.0);
+  this->results_file_ = getParam<std::string>(sdf, "resultsFile", "");
+
+  // Wheel joints
+  std::string name;
+  std::istringstream left_joints(getParam<std::string>(sdf, "leftJoints", "front_left_wheel rear_left_wheel"));
+  while (left_joints >> name)
+  {
+    gazebo::physics::JointPtr joint = this->model_->GetJoint(name);
+    if (joint) { this->left_wheels_.push_back(joint); }
+    else { gzerr << "[PathTrackingPlugin] Joint " << name << " not found\n"; }
+  }
+  std::istringstream right_joints(getParam<std::string>(sdf, "rightJoints", "front_right_wheel rear_right_wheel"));
+  while (right_joints >> name)
+  {
+    gazebo::physics::JointPtr joint = this->model_->GetJoint(name);
+    if (joint) { this->right_wheels_.push_back(joint); }
+    else { gzerr << "[PathTrackingPlugin] Joint " << name << " not found\n"; }
+  }
+
+  // Initialization
+  this->pipeline_ = PurePursuitPipeline(
+    LemniscatePath<double>(this->track_A_axis_, this->track_B_axis_, this->track_wp_num_),
+    ForwardSearchProjector<double>(),
+    SpeedScaledLookahead<double>(this->lookahead_distance_),
+    PurePursuitSteering<double>(this->robot_length_),
+    PIDSpeedController<double>(this->control_period_, this->pid_Kp_, this->pid_Ki_, this->pid_Kd_),
+    this->local_prev_wp_num_);
+  this->pose_start_ = this->model_->WorldPose();
+  this->time_last_control_ = this->world_->SimTime();
+  this->time_episode_start_ = this->world_->SimTime();
+  this->wall_episode_start_ = std::chrono::steady_clock::now();
+
+  this->update_connection_ = gazebo::event::Events::ConnectWorldUpdateBegin(
+    std::bind(&PathTrackingPlugin::onUpdate, this, std::placeholders::_1));
+
+  gzmsg << "[PathTrackingPlugin] Tracking " << this->pipeline_.path().size() << " waypoints for "
+        << this->num_episodes_ << " episode(s)\n";
+};
+
+void PathTrackingPlugin::onUpdate(const gazebo::common::UpdateInfo& info)
+{
+  if (!this->finished_ && (info.simTime - this->time_last_control_).Double() >= this->control_period_)
+  {
+    this->time_last_control_ = info.simTime;
+    controlStep();
+  }
+
+  // Joint velocities have to be applied on every physics step
+  applyCommand(this->linear_cmd_, this->angular_cmd_);
+
+  return;
+};
+
+void PathTrackingPlugin::controlStep()
+{
+  const Pose2D robot = getRobotPose();
+  const ignition::math::Vector3d velocity = this->model_->WorldLinearVel();
+
+  // Progress along the track and control outputs, in one inlined cycle
+  TrackingInput<double> input;
+  input.robot = robot;
+  input.forward_speed = velocity.X();
+  input.speed = velocity.Length();
+  const TrackingOutput<double> output = this->pipeline_.step(input, this->speed_target_);
+
+  const std::vector<Pose2D>& global_path = this->pipeline_.path();
+  const double time_elapsed = (this->world_->SimTime() - this->time_episode_start_).Double();
+  if (output.id_next >= int(global_path.size()) - 1 || time_elapsed > this->episode_timeout_)
+  {
+    finishEpisode();
+    return;
+  }
+
+  // Same goal as the metrics of the publisher node
+  const Pose2D& goal_metric = global_path[output.id_metric];
+
+  // Calculate errors
+  const std::pair<double, double> abs_errors = calculatePoseError(robot, goal_metric);
+  const double speed_error = velocity.Length() - this->speed_target_;
+  this->sum_sqr_position_error_ += std::pow(abs_errors.first, 2);
+  this->sum_sqr_heading_error_ += std::pow(abs_errors.second, 2);
+  this->sum_sqr_speed_error_ += std::pow(speed_error, 2);
+  this->num_time_steps_++;
+
+  this->linear_cmd_ = output.linear_cmd;
+  this->angular_cmd_ = output.angular_cmd;
+
+  return;
+};
+
+void PathTrackingPlugin::applyCommand(const double linear_speed, const double angular_speed)
+{
+  // Differential drive kinematics
+  const double w_left = (linear_speed - angular_speed * this->wheel_separation_ / 2.0) / this->wheel_radius_;
+  const double w_right = (linear_speed + angular_speed * this->wheel_separation_ / 2.0) / this->wheel_radius_;
+
+  for (const gazebo::physics::JointPtr& joint : this->left_wheels_)
+  {
+    joint->SetVelocity(0, w_left);
+  }
+  for (const gazebo::physics::JointPtr& joint : this->right_wheels_)
+  {
+    joint->SetVelocity(0, w_right);
+  }
+
+  return;
+};
+
+void PathTrackingPlugin::finishEpisode()
+{
+  const double num_steps = std::max(this->num_time_steps_, 1LL);
+  const double rms_position_error = std::sqrt(this->sum_sqr_position_error_/num_steps);
+  const double rms_heading_error = std::sqrt(this->sum_sqr_heading_error_/num_steps);
+  const double rms_speed_error = std::sqrt(this->sum_sqr_speed_error_/num_steps);
+  const double sim_time = (this->world_->SimTime() - this->time_episode_start_).Double();
+  const double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wall_episode_start_).count();
+  const bool completed = sim_time <= this->episode_timeout_;
+
+  gzmsg << "[PathTrackingPlugin] Episode " << this->episode_id_ << (completed? " completed" : " timed out")
+        << " in " << sim_time << "s (wall " << wall_time << "s)"
+        << ", RMS position error: " << rms_position_error << "m"
+        << ", RMS heading error: " << rms_heading_error << "deg"
+        << ", RMS speed error: " << rms_speed_error << "m/s\n";
+
+  if (!this->results_file_.empty())
+  {
+    std::ofstream results(this->results_file_, std::ios::app);
+    results << this->episode_id_ << "," << completed << "," << sim_time << "," << wall_time << ","
+            << rms_position_error << "," << rms_heading_error << "," << rms_speed_error << "\n";
+  }
+
+  this->episode_id_++;
+  if (this->episode_id_ < this->num_episodes_)
+  {
+    resetEpisode();
+  }
+  else
+  {
+    this->linear_cmd_ = 0.0;
+    this->angular_cmd_ = 0.0;
+    this->finished_ = true;
+  }
+
+  return;
+};
+
+void PathTrackingPlugin::resetEpisode()
+{
+  // Teleport the robot back to where it was spawned
+  this->model_->SetWorldPose(this->pose_start_);
+  this->model_->ResetPhysicsStates();
+
+  this->pipeline_.reset();
+  this->linear_cmd_ = 0.0;
+  this->angular_cmd_ = 0.0;
+  this->num_time_steps_ = 0;
+  this->sum_sqr_position_error_ = 0.0;
+  this->sum_sqr_heading_error_ = 0.0;
+  this->sum_sqr_speed_error_ = 0.0;
+  this->time_episode_start_ = this->world_->SimTime();
+  this->wall_episode_start_ = std::chrono::steady_clock::now();
+
+  return;
+};
+
+Pose2D PathTrackingPlugin::getRobotPose() const
+{
+  const ignition::math::Pose3d pose = this->model_->WorldPose();
+
+  Pose2D robot;
+  robot.x = pose.Pos().X();
+  robot.y = pose.Pos().Y();
+  robot.yaw = pose.Rot().Yaw();
+
+  return robot;
+};
+
+GZ_REGISTER_MODEL_PLUGIN(PathTrackingPlugin)
+
+} // namespace me5413_world
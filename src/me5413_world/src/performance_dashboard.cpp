@@ -0,0 +1,364 @@
+/** performance_dashboard.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * rqt plugin showing rolling histograms of the cycle durations, message ages, control rate and
+ * tracking errors of the running nodes, cheap enough to leave open during a run
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include <pluginlib/class_list_macros.h>
+#include <QPainter>
+#include <QFontMetrics>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+#include "me5413_world/performance_dashboard.hpp"
+
+namespace me5413_world
+{
+
+constexpr int kRefreshPeriod = 250;     // [ms], repainting more often would not be readable anyway
+constexpr size_t kCapacity = 8192;      // samples kept per histogram
+constexpr double kWindows[] = {10.0, 30.0, 60.0};  // [s]
+
+HistogramPlot::HistogramPlot(const QString& title, const QString& unit, const double scale, QWidget* parent) :
+  QWidget(parent),
+  title_(title),
+  unit_(unit),
+  scale_(scale),
+  min_value_(0.0),
+  max_value_(1.0),
+  log_scale_(false),
+  count_(0),
+  p50_(NAN), p95_(NAN), p99_(NAN),
+  marker_(NAN)
+{
+  setMinimumSize(240, 120);
+};
+
+void HistogramPlot::setData(const RollingHistogram& histogram)
+{
+  this->bins_ = histogram.bins();
+  this->min_value_ = histogram.minValue();
+  this->max_value_ = histogram.maxValue();
+  this->log_scale_ = histogram.logScale();
+  this->count_ = histogram.count();
+  this->p50_ = histogram.percentile(0.50);
+  this->p95_ = histogram.percentile(0.95);
+  this->p99_ = histogram.percentile(0.99);
+};
+
+double HistogramPlot::position(const double value) const
+{
+  double ratio = 0.0;
+  if (this->log_scale_)
+  {
+    ratio = std::log(std::max(value, this->min_value_) / this->min_value_) / std::log(this->max_value_ / this->min_value_);
+  }
+  else if (this->max_value_ > this->min_value_)
+  {
+    ratio = (value - this->min_value_) / (this->max_value_ - this->min_value_);
+  }
+
+  return std::min(std::max(ratio, 0.0), 1.0);
+};
+
+void HistogramPlot::paintEvent(QPaintEvent*)
+{
+  QPainter painter(this);
+  painter.fillRect(rect(), palette().base());
+  const int text_height = painter.fontMetrics().height();
+  const QRect area = rect().adjusted(4, 2 * text_height + 4, -4, -text_height - 4);
+  if (area.width() <= 0 || area.height() <= 0)
+  {
+    return;
+  }
+
+  // Title and percentiles
+  painter.setPen(palette().text().color());
+  painter.drawText(4, text_height, this->title_ + " [" + this->unit_ + "]");
+  QString summary = "no data";
+  if (this->count_ > 0)
+  {
+    summary = QString("n %1   p50 %2   p95 %3   p99 %4").arg(this->count_)
+              .arg(this->p50_ * this->scale_, 0, 'g', 3)
+              .arg(this->p95_ * this->scale_, 0, 'g', 3)
+              .arg(this->p99_ * this->scale_, 0, 'g', 3);
+  }
+  painter.drawText(4, 2 * text_height, summary);
+
+  // Bars, scaled to the fullest bin
+  const uint32_t max_count = this->bins_.empty()? 0 : *std::max_element(this->bins_.begin(), this->bins_.end());
+  const double bar_width = double(area.width()) / std::max(this->bins_.size(), size_t(1));
+  for (size_t i = 0; i < this->bins_.size() && max_count > 0; i++)
+  {
+    if (this->bins_[i] == 0)
+    {
+      continue;
+    }
+    const double height = std::max(1.0, area.height() * double(this->bins_[i]) / max_count);
+    painter.fillRect(QRectF(area.left() + i * bar_width, area.bottom() - height, std::max(bar_width - 1.0, 1.0), height),
+                     palette().highlight());
+  }
+
+  // p50 and p99, then the marker
+  if (this->count_ > 0)
+  {
+    painter.setPen(QPen(palette().text().color(), 1, Qt::DashLine));
+    for (const double value : {this->p50_, this->p99_})
+    {
+      const double x = area.left() + position(value) * area.width();
+      painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+    }
+  }
+  if (!std::isnan(this->marker_))
+  {
+    painter.setPen(QPen(Qt::red, 2));
+    const double x = area.left() + position(this->marker_) * area.width();
+    painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+  }
+
+  // Range of the axis
+  painter.setPen(palette().text().color());
+  const QRect labels(area.left(), area.bottom() + 2, area.width(), text_height);
+  painter.drawText(labels, Qt::AlignLeft, QString::number(this->min_value_ * this->scale_, 'g', 3));
+  painter.drawText(labels, Qt::AlignHCenter, this->log_scale_? "log scale" : "");
+  painter.drawText(labels, Qt::AlignRight, QString::number(this->max_value_ * this->scale_, 'g', 3));
+};
+
+PerformanceDashboard::PerformanceDashboard() :
+  widget_(nullptr),
+  status_label_(nullptr),
+  window_box_(nullptr),
+  pause_box_(nullptr),
+  timer_(nullptr),
+  rtf_received_(false)
+{
+  setObjectName("PerformanceDashboard");
+};
+
+void PerformanceDashboard::initPlugin(qt_gui_cpp::PluginContext& context)
+{
+  this->widget_ = new QWidget();
+  this->widget_->setWindowTitle("Performance Dashboard");
+  if (context.serialNumber() > 1)
+  {
+    this->widget_->setWindowTitle(this->widget_->windowTitle() + " (" + QString::number(context.serialNumber()) + ")");
+  }
+
+  // Controls and diagnostics
+  QVBoxLayout* layout = new QVBoxLayout(this->widget_);
+  QHBoxLayout* controls = new QHBoxLayout();
+  this->window_box_ = new QComboBox();
+  for (const double window : kWindows)
+  {
+    this->window_box_->addItem(QString("Last %1 s").arg(window));
+  }
+  this->pause_box_ = new QCheckBox("Pause");
+  this->status_label_ = new QLabel("Waiting for data...");
+  controls->addWidget(this->window_box_);
+  controls->addWidget(this->pause_box_);
+  controls->addStretch();
+  layout->addLayout(controls);
+  layout->addWidget(this->status_label_);
+
+  // Durations are binned on a log scale, from 10 us to 100 ms, as in the Prometheus histograms
+  this->panels_.resize(NUM_PANELS);
+  addPanel(TRACKER_CYCLE, "Tracker cycle", "ms", 1000.0, RollingHistogram(1e-5, 0.1, 60, true, kWindows[0], kCapacity));
+  addPanel(PUBLISHER_CYCLE, "Publisher cycle", "ms", 1000.0, RollingHistogram(1e-5, 0.1, 60, true, kWindows[0], kCapacity));
+  addPanel(LOCAL_PATH_AGE, "Local path age", "ms", 1000.0, RollingHistogram(1e-4, 1.0, 60, true, kWindows[0], kCapacity));
+  addPanel(ODOM_AGE, "Odometry age", "ms", 1000.0, RollingHistogram(1e-4, 1.0, 60, true, kWindows[0], kCapacity));
+  addPanel(CONTROL_RATE, "Control rate", "Hz", 1.0, RollingHistogram(0.0, 100.0, 50, false, kWindows[0], kCapacity));
+  addPanel(POSITION_ERROR, "Position error", "m", 1.0, RollingHistogram(0.0, 2.0, 50, false, kWindows[0], kCapacity));
+  addPanel(HEADING_ERROR, "Heading error", "deg", 1.0, RollingHistogram(0.0, 45.0, 45, false, kWindows[0], kCapacity));
+  addPanel(SPEED_ERROR, "Speed error", "m/s", 1.0, RollingHistogram(0.0, 1.0, 50, false, kWindows[0], kCapacity));
+  QGridLayout* grid = new QGridLayout();
+  for (int i = 0; i < NUM_PANELS; i++)
+  {
+    grid->addWidget(this->panels_[i].plot, i / 2, i % 2);
+  }
+  layout->addLayout(grid, 1);
+  context.addWidget(this->widget_);
+
+  connect(this->window_box_, SIGNAL(currentIndexChanged(int)), this, SLOT(windowChanged(int)));
+  this->timer_ = new QTimer(this->widget_);
+  connect(this->timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+  this->timer_->start(kRefreshPeriod);
+
+  // Only small or low-rate topics, so the dashboard adds little traffic when it runs on another machine. The ages of
+  // the local path and the odometry come with the cycle timing of the tracker, instead of the full messages
+  ros::NodeHandle& nh = getNodeHandle();
+  this->subs_.push_back(nh.subscribe("/me5413_world/cycle_timing", 100, &PerformanceDashboard::cycleTimingCallback, this));
+  this->subs_.push_back(nh.subscribe("/me5413_world/load_shedding", 10, &PerformanceDashboard::loadSheddingCallback, this));
+  this->subs_.push_back(nh.subscribe("/me5413_world/rtf_governor", 1, &PerformanceDashboard::rtfGovernorCallback, this));
+  this->subs_.push_back(nh.subscribe("/jackal_velocity_controller/cmd_vel", 10, &PerformanceDashboard::cmdVelCallback, this));
+  this->subs_.push_back(nh.subscribe<std_msgs::Float32>("/me5413_world/planning/abs_position_error", 10,
+      boost::bind(&PerformanceDashboard::errorCallback, this, _1, POSITION_ERROR)));
+  this->subs_.push_back(nh.subscribe<std_msgs::Float32>("/me5413_world/planning/abs_heading_error", 10,
+      boost::bind(&PerformanceDashboard::errorCallback, this, _1, HEADING_ERROR)));
+  this->subs_.push_back(nh.subscribe<std_msgs::Float32>("/me5413_world/planning/abs_speed_error", 10,
+      boost::bind(&PerformanceDashboard::errorCallback, this, _1, SPEED_ERROR)));
+};
+
+void PerformanceDashboard::shutdownPlugin()
+{
+  this->timer_->stop();
+  for (ros::Subscriber& sub : this->subs_)
+  {
+    sub.shutdown();
+  }
+  this->subs_.clear();
+};
+
+void PerformanceDashboard::saveSettings(qt_gui_cpp::Settings&, qt_gui_cpp::Settings& instance_settings) const
+{
+  instance_settings.setValue("window_index", this->window_box_->currentIndex());
+};
+
+void PerformanceDashboard::restoreSettings(const qt_gui_cpp::Settings&, const qt_gui_cpp::Settings& instance_settings)
+{
+  if (instance_settings.contains("window_index"))
+  {
+    this->window_box_->setCurrentIndex(instance_settings.value("window_index").toInt());
+  }
+};
+
+void PerformanceDashboard::addPanel(const PanelId id, const QString& title, const QString& unit, const double scale,
+                                    const RollingHistogram& histogram)
+{
+  Panel& panel = this->panels_[id];
+  panel.histogram = histogram;
+  panel.plot = new HistogramPlot(title, unit, scale);
+  panel.shown_version = histogram.version() - 1;
+  panel.marker = NAN;
+};
+
+void PerformanceDashboard::addSample(const PanelId id, const double value)
+{
+  // The window is in wall time, so that it keeps rolling when the simulation is paused or slow
+  const double now = ros::WallTime::now().toSec();
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->panels_[id].histogram.add(now, value);
+};
+
+void PerformanceDashboard::windowChanged(int index)
+{
+  if (index < 0 || index >= int(sizeof(kWindows) / sizeof(kWindows[0])))
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  for (Panel& panel : this->panels_)
+  {
+    panel.histogram.setWindow(kWindows[index]);
+  }
+};
+
+void PerformanceDashboard::refresh()
+{
+  if (this->pause_box_->isChecked())
+  {
+    return;
+  }
+
+  // Copy what changed under the lock, paint outside of it
+  const double now = ros::WallTime::now().toSec();
+  QString status;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    for (Panel& panel : this->panels_)
+    {
+      panel.histogram.expire(now);
+      if (panel.histogram.version() == panel.shown_version)
+      {
+        continue;
+      }
+      panel.plot->setData(panel.histogram);
+      panel.plot->setMarker(panel.marker);
+      panel.plot->update();
+      panel.shown_version = panel.histogram.version();
+    }
+
+    for (const std::pair<const std::string, int>& node : this->shedding_levels_)
+    {
+      const std::map<std::string, int>::const_iterator transitions = this->num_transitions_.find(node.first);
+      status += QString("%1: shedding level %2 (%3 transitions)   ").arg(QString::fromStdString(node.first)).arg(node.second)
+                .arg((transitions == this->num_transitions_.end())? 0 : transitions->second);
+    }
+    if (this->rtf_received_)
+    {
+      status += QString("RTF %1 / %2, physics level %3 of %4").arg(this->rtf_status_.real_time_factor, 0, 'f', 2)
+                .arg(this->rtf_status_.target_real_time_factor, 0, 'f', 2)
+                .arg(this->rtf_status_.level).arg(this->rtf_status_.num_levels - 1);
+    }
+  }
+  if (!status.isEmpty())
+  {
+    this->status_label_->setText(status);
+  }
+};
+
+void PerformanceDashboard::cycleTimingCallback(const me5413_world::CycleTiming::ConstPtr& timing)
+{
+  const bool is_tracker = (timing->node.find("tracker") != std::string::npos);
+  const PanelId id = is_tracker? TRACKER_CYCLE : PUBLISHER_CYCLE;
+  addSample(id, timing->duration);
+  if (timing->local_path_age >= 0.0)
+  {
+    addSample(LOCAL_PATH_AGE, timing->local_path_age);
+  }
+  if (timing->odom_age >= 0.0)
+  {
+    addSample(ODOM_AGE, timing->odom_age);
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  if (this->panels_[id].marker != timing->budget)
+  {
+    // Redraw with the new budget
+    this->panels_[id].marker = timing->budget;
+    this->panels_[id].shown_version--;
+  }
+  this->shedding_levels_[timing->node] = timing->shedding_level;
+};
+
+void PerformanceDashboard::loadSheddingCallback(const me5413_world::LoadShedding::ConstPtr& load_shedding)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->num_transitions_[load_shedding->node]++;
+  this->shedding_levels_[load_shedding->node] = load_shedding->to_level;
+};
+
+void PerformanceDashboard::rtfGovernorCallback(const me5413_world::RtfGovernorStatus::ConstPtr& status)
+{
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->rtf_status_ = *status;
+  this->rtf_received_ = true;
+};
+
+void PerformanceDashboard::cmdVelCallback(const geometry_msgs::Twist::ConstPtr&)
+{
+  // Twist has no header, the rate is measured on arrival, in simulated time like the controller
+  const ros::Time now = ros::Time::now();
+  const double period = (now - this->last_cmd_vel_time_).toSec();
+  if (!this->last_cmd_vel_time_.isZero() && period > 0.0)
+  {
+    addSample(CONTROL_RATE, 1.0 / period);
+  }
+  this->last_cmd_vel_time_ = now;
+};
+
+void PerformanceDashboard::errorCallback(const std_msgs::Float32::ConstPtr& error, const PanelId id)
+{
+  addSample(id, std::fabs(error->data));
+};
+
+} // namespace me5413_world
+
+PLUGINLIB_EXPORT_CLASS(me5413_world::PerformanceDashboard, rqt_gui_cpp::Plugin)
@@ -0,0 +1,264 @@
+/** python_bindings.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * pybind11 bindings of the path generation, projection, metric and control kernels,
+ * so offline analysis runs exactly the production code at native speed
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include "me5413_world/pid.hpp"
+#include "me5413_world/thread_pool.hpp"
+#include "me5413_world/tracking_utils.hpp"
+
+namespace py = pybind11;
+
+namespace me5413_world
+{
+
+// Arrays of poses are (N, 3) float64 arrays of [x, y, yaw] rows, other dtypes or layouts are converted once
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> DoubleArray;
+static_assert(sizeof(Pose2D) == 3 * sizeof(double), "Pose2D has to map onto a row of 3 doubles");
+
+// Independent batch items are split across the process-wide pool in chunks of this size
+constexpr int kBatchGrainSize = 4096;
+
+// View an (N, 3) array as poses, without copying
+const Pose2D* asPoses(const DoubleArray& array, const char* name)
+{
+  if (array.ndim() != 2 || array.shape(1) != 3)
+  {
+    throw std::invalid_argument(std::string(name) + " must be an (N, 3) array of [x, y, yaw]");
+  }
+  return reinterpret_cast<const Pose2D*>(array.data());
+}
+
+// Read a single [x, y, yaw] pose
+Pose2D asPose(const DoubleArray& array, const char* name)
+{
+  if (array.size() != 3)
+  {
+    throw std::invalid_argument(std::string(name) + " must be a pose [x, y, yaw]");
+  }
+  Pose2D pose;
+  pose.x = array.data()[0];
+  pose.y = array.data()[1];
+  pose.yaw = array.data()[2];
+  return pose;
+}
+
+// Hand the poses over to numpy as an (N, 3) array, without copying
+py::array_t<double> toArray(std::vector<Pose2D>&& poses)
+{
+  std::vector<Pose2D>* data = new std::vector<Pose2D>(std::move(poses));
+  py::capsule owner(data, [](void* p) { delete static_cast<std::vector<Pose2D>*>(p); });
+
+  const std::vector<py::ssize_t> shape = {py::ssize_t(data->size()), 3};
+  const std::vector<py::ssize_t> strides = {py::ssize_t(sizeof(Pose2D)), py::ssize_t(sizeof(double))};
+  return py::array_t<double>(shape, strides, reinterpret_cast<const double*>(data->data()), owner);
+}
+
+// The kernels trust id_start, pybind11 raises std::out_of_range as IndexError
+void checkStartIndex(const int id_start, const py::ssize_t num_wp)
+{
+  if (id_start < 0 || id_start >= num_wp)
+  {
+    throw std::out_of_range("id_start " + std::to_string(id_start) + " is outside of a path of "
+                            + std::to_string(num_wp) + " waypoints");
+  }
+}
+
+void checkSameLength(const py::ssize_t a, const py::ssize_t b)
+{
+  if (a != b)
+  {
+    throw std::invalid_argument("Batch inputs must have the same length");
+  }
+}
+
+PYBIND11_MODULE(me5413_kernels, m)
+{
+  m.doc() = "Path generation, projection, metric and control kernels of me5413_world";
+
+  // Path generation
+  m.def("create_lemniscate_path", [](const double A, const double B, const double t_res)
+  {
+    return toArray(createLemniscatePath(A, B, t_res));
+  }, py::arg("A"), py::arg("B"), py::arg("t_res"),
+  "Figure 8 track as an (N, 3) array of [x, y, yaw]");
+
+  m.def("compute_arc_length", [](const DoubleArray& path)
+  {
+    const Pose2D* poses = asPoses(path, "path");
+    const int num_wp = path.shape(0);
+    py::array_t<double> s(num_wp);
+    double* s_data = s.mutable_data();
+    {
+      py::gil_scoped_release release;
+      computeArcLength(poses, num_wp, s_data);
+    }
+    return s;
+  }, py::arg("path"),
+  "Cumulative arc length [m] at every waypoint");
+
+  m.def("count_waypoints_ahead", [](const py::array_t<double, py::array::c_style | py::array::forcecast>& s,
+                                     const int id_start, const double distance, const bool wrap)
+  {
+    checkStartIndex(id_start, s.size());
+    const std::vector<double> s_vec(s.data(), s.data() + s.size());
+    return countWaypointsAhead(s_vec, id_start, distance, wrap);
+  }, py::arg("s"), py::arg("id_start"), py::arg("distance"), py::arg("wrap") = false,
+  "Number of waypoints after id_start needed to cover distance [m]");
+
+  // Projection
+  m.def("closest_waypoint", [](const double x, const double y, const DoubleArray& path, const int id_start)
+  {
+    const Pose2D* poses = asPoses(path, "path");
+    checkStartIndex(id_start, path.shape(0));
+    return closestWaypoint(x, y, poses, path.shape(0), id_start);
+  }, py::arg("x"), py::arg("y"), py::arg("path"), py::arg("id_start") = 0);
+
+  m.def("next_waypoint", [](const DoubleArray& robot, const DoubleArray& path, const int id_start)
+  {
+    const Pose2D* poses = asPoses(path, "path");
+    checkStartIndex(id_start, path.shape(0));
+    return nextWaypoint(asPose(robot, "robot"), poses, path.shape(0), id_start);
+  }, py::arg("robot"), py::arg("path"), py::arg("id_start") = 0);
+
+  m.def("next_waypoints", [](const DoubleArray& robots, const DoubleArray& path, const int id_start)
+  {
+    const Pose2D* robot_poses = asPoses(robots, "robots");
+    const Pose2D* path_poses = asPoses(path, "path");
+    checkStartIndex(id_start, path.shape(0));
+    const int num_robots = robots.shape(0);
+    const int num_wp = path.shape(0);
+    py::array_t<int> ids(num_robots);
+    int* ids_data = ids.mutable_data();
+    {
+      py::gil_scoped_release release;
+      ThreadPool::global().parallelFor(0, num_robots, kBatchGrainSize, [&](const int begin, const int end)
+      {
+        for (int i = begin; i < end; i++)
+        {
+          ids_data[i] = nextWaypoint(robot_poses[i], path_poses, num_wp, id_start);
+        }
+      });
+    }
+    return ids;
+  }, py::arg("robots"), py::arg("path"), py::arg("id_start") = 0,
+  "Next waypoint of every pose, each searched independently from id_start");
+
+  m.def("track_progress", [](const DoubleArray& trajectory, const DoubleArray& path, const int id_start)
+  {
+    const Pose2D* robot_poses = asPoses(trajectory, "trajectory");
+    const Pose2D* path_poses = asPoses(path, "path");
+    checkStartIndex(id_start, path.shape(0));
+    const int num_robots = trajectory.shape(0);
+    const int num_wp = path.shape(0);
+    py::array_t<int> ids(num_robots);
+    int* ids_data = ids.mutable_data();
+    {
+      py::gil_scoped_release release;
+      int current_id = id_start;
+      for (int i = 0; i < num_robots; i++)
+      {
+        ids_data[i] = nextWaypoint(robot_poses[i], path_poses, num_wp, current_id);
+        current_id = std::max(current_id, std::min(ids_data[i], num_wp - 1) - 1);
+      }
+    }
+    return ids;
+  }, py::arg("trajectory"), py::arg("path"), py::arg("id_start") = 0,
+  "Next waypoint along a driven trajectory, with the same progress tracking as path_publisher_node");
+
+  // Metrics
+  m.def("calculate_pose_errors", [](const DoubleArray& robots, const DoubleArray& goals)
+  {
+    const Pose2D* robot_poses = asPoses(robots, "robots");
+    const Pose2D* goal_poses = asPoses(goals, "goals");
+    checkSameLength(robots.shape(0), goals.shape(0));
+    const int num_robots = robots.shape(0);
+    py::array_t<double> errors(std::vector<py::ssize_t>{num_robots, 2});
+    double* errors_data = errors.mutable_data();
+    {
+      py::gil_scoped_release release;
+      ThreadPool::global().parallelFor(0, num_robots, kBatchGrainSize, [&](const int begin, const int end)
+      {
+        for (int i = begin; i < end; i++)
+        {
+          const std::pair<double, double> error = calculatePoseError(robot_poses[i], goal_poses[i]);
+          errors_data[2 * i] = error.first;
+          errors_data[2 * i + 1] = error.second;
+        }
+      });
+    }
+    return errors;
+  }, py::arg("robots"), py::arg("goals"),
+  "(M, 2) array of position errors [m] and heading errors [deg]");
+
+  // Control laws
+  m.def("compute_lookahead_distance", py::vectorize(&computeLookaheadDistance<double>),
+        py::arg("velocity"), py::arg("lookahead_gain"));
+
+  m.def("compute_steering", [](const DoubleArray& robots, const DoubleArray& goals, const double robot_length, const DoubleArray& lookahead_distances)
+  {
+    const Pose2D* robot_poses = asPoses(robots, "robots");
+    const Pose2D* goal_poses = asPoses(goals, "goals");
+    checkSameLength(robots.shape(0), goals.shape(0));
+    checkSameLength(robots.shape(0), lookahead_distances.size());
+    const int num_robots = robots.shape(0);
+    const double* lookahead_data = lookahead_distances.data();
+    py::array_t<double> steering(num_robots);
+    double* steering_data = steering.mutable_data();
+    {
+      py::gil_scoped_release release;
+      ThreadPool::global().parallelFor(0, num_robots, kBatchGrainSize, [&](const int begin, const int end)
+      {
+        for (int i = begin; i < end; i++)
+        {
+          steering_data[i] = computeSteering(robot_poses[i], goal_poses[i], robot_length, lookahead_data[i]);
+        }
+      });
+    }
+    return steering;
+  }, py::arg("robots"), py::arg("goals"), py::arg("robot_length"), py::arg("lookahead_distances"),
+  "Pure pursuit steering of every robot towards its goal");
+
+  py::class_<control::PID>(m, "PID")
+    .def(py::init<double, double, double, double, double, double>(),
+         py::arg("dt"), py::arg("max"), py::arg("min"), py::arg("Kp"), py::arg("Kd"), py::arg("Ki"))
+    .def("update_settings", &control::PID::updateSettings, py::arg("Kp"), py::arg("Kd"), py::arg("Ki"))
+    .def("reset", &control::PID::reset)
+    .def("calculate", &control::PID::calculate, py::arg("setpoint"), py::arg("pv"))
+    .def("calculate_batch", [](control::PID& pid, const DoubleArray& setpoints, const DoubleArray& pvs)
+    {
+      checkSameLength(setpoints.size(), pvs.size());
+      const int num_steps = setpoints.size();
+      const double* setpoints_data = setpoints.data();
+      const double* pvs_data = pvs.data();
+      py::array_t<double> outputs(num_steps);
+      double* outputs_data = outputs.mutable_data();
+      {
+        py::gil_scoped_release release;
+        for (int i = 0; i < num_steps; i++)
+        {
+          outputs_data[i] = pid.calculate(setpoints_data[i], pvs_data[i]);
+        }
+      }
+      return outputs;
+    }, py::arg("setpoints"), py::arg("pvs"),
+    "Runs the controller over consecutive time steps")
+    .def_property_readonly("integral", &control::PID::getIntegral)
+    .def_property_readonly("previous_error", &control::PID::getPreviousError)
+    .def("set_state", &control::PID::setState, py::arg("integral"), py::arg("pre_error"));
+}
+
+} // namespace me5413_world
@@ -0,0 +1,618 @@
+/** racing_line.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Minimum curvature racing line, banded QP solver and speed profile
+ */
+
+#include <set>
+#include <cmath>
+#include <algorithm>
+
+#include "me5413_world/racing_line.hpp"
+
+namespace me5413_world
+{
+
+constexpr int kLineBandwidth = 2;  // the curvature at a knot couples the offsets of its two neighbours
+constexpr double kRidge = 1e-6;    // [1/m^4] weight of the squared offsets, far below the curvature of any corner
+constexpr double kMaxInnerOffset = 0.25;  // fraction of the radius of a turn the line may cut in
+constexpr double kMultiplierTolerance = 1e-9;  // relative to the largest gradient, below which a bound is kept
+// [1/m^2] weights of the length against the integral of the squared curvature, the fastest line is kept
+constexpr double kLengthWeights[] = {0.0, 0.003, 0.01, 0.03, 0.1, 0.3, 1.0, 3.0, 10.0};
+
+namespace
+{
+
+// Distinct waypoints of a closed path, without the last one if it repeats the first
+int numDistinctWaypoints(const std::vector<Pose2D>& path)
+{
+  const int num_wp = path.size();
+  if (num_wp > 1 && std::hypot(path.back().x - path.front().x, path.back().y - path.front().y) < 1e-6)
+  {
+    return num_wp - 1;
+  }
+  return num_wp;
+}
+
+// Signed curvature [1/m] of the circle through three points
+double mengerCurvature(const Pose2D& a, const Pose2D& b, const Pose2D& c)
+{
+  const double cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+  const double lengths = std::hypot(b.x - a.x, b.y - a.y) * std::hypot(c.x - b.x, c.y - b.y) * std::hypot(c.x - a.x, c.y - a.y);
+  return (lengths > 0.0)? 2.0 * cross / lengths : 0.0;
+}
+
+double maxCurvature(const std::vector<Pose2D>& path)
+{
+  const int n = numDistinctWaypoints(path);
+  double max_curvature = 0.0;
+  for (int i = 0; i < n && n >= 3; i++)
+  {
+    max_curvature = std::max(max_curvature, std::fabs(mengerCurvature(path[(i + n - 1) % n], path[i], path[(i + 1) % n])));
+  }
+  return max_curvature;
+}
+
+// Waypoints oriented towards the next one, the last one keeps the heading of the last segment
+void orientWaypoints(std::vector<Pose2D>& path)
+{
+  for (int i = 0; i + 1 < int(path.size()); i++)
+  {
+    path[i].yaw = std::atan2(path[i + 1].y - path[i].y, path[i + 1].x - path[i].x);
+  }
+  if (path.size() > 1)
+  {
+    path.back().yaw = path[path.size() - 2].yaw;
+  }
+}
+
+} // namespace
+
+bool CyclicBandedCholesky::factorize(const int n, const int bandwidth, const std::vector<double>& band)
+{
+  this->size_ = 0;
+  if (n <= 2 * bandwidth || int(band.size()) != n * (bandwidth + 1))
+  {
+    return false;
+  }
+  this->bandwidth_ = bandwidth;
+  this->band_.assign(n * (bandwidth + 1), 0.0);
+  this->border_.assign(bandwidth * n, 0.0);
+  const int first_border_row = n - bandwidth;
+
+  // Entry of A, the band only holds the upper half
+  auto matrix = [&](const int i, const int j)
+  {
+    const int k_up = ((j - i) % n + n) % n;
+    const int k_down = ((i - j) % n + n) % n;
+    return (k_up <= bandwidth)? band[i * (bandwidth + 1) + k_up] : (k_down <= bandwidth)? band[j * (bandwidth + 1) + k_down] : 0.0;
+  };
+  auto row_start = [&](const int i) { return (i < first_border_row)? std::max(0, i - bandwidth) : 0; };
+
+  this->size_ = n;
+  for (int i = 0; i < n; i++)
+  {
+    for (int j = row_start(i); j <= i; j++)
+    {
+      double sum = matrix(i, j);
+      for (int k = std::max(row_start(i), row_start(j)); k < j; k++)
+      {
+        sum -= factor(i, k) * factor(j, k);
+      }
+      if (i != j)
+      {
+        factor(i, j) = sum / factor(j, j);
+      }
+      else if (sum > 0.0)
+      {
+        factor(i, i) = std::sqrt(sum);
+      }
+      else
+      {
+        this->size_ = 0;
+        return false;
+      }
+    }
+  }
+
+  return true;
+};
+
+void CyclicBandedCholesky::solve(std::vector<double>& x) const
+{
+  const int n = this->size_;
+  const int first_border_row = n - this->bandwidth_;
+
+  // L y = b
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = (i < first_border_row)? std::max(0, i - this->bandwidth_) : 0; k < i; k++)
+    {
+      x[i] -= factor(i, k) * x[k];
+    }
+    x[i] /= factor(i, i);
+  }
+
+  // L^T x = y, the column of L below the diagonal is the band then the border rows
+  for (int i = n - 1; i >= 0; i--)
+  {
+    for (int j = i + 1; j <= std::min(i + this->bandwidth_, first_border_row - 1); j++)
+    {
+      x[i] -= factor(j, i) * x[j];
+    }
+    for (int j = std::max(first_border_row, i + 1); j < n; j++)
+    {
+      x[i] -= factor(j, i) * x[j];
+    }
+    x[i] /= factor(i, i);
+  }
+};
+
+double& CyclicBandedCholesky::factor(const int i, const int j)
+{
+  const int first_border_row = this->size_ - this->bandwidth_;
+  return (i >= first_border_row)? this->border_[(i - first_border_row) * this->size_ + j] : this->band_[i * (this->bandwidth_ + 1) + (i - j)];
+};
+
+double CyclicBandedCholesky::factor(const int i, const int j) const
+{
+  const int first_border_row = this->size_ - this->bandwidth_;
+  return (i >= first_border_row)? this->border_[(i - first_border_row) * this->size_ + j] : this->band_[i * (this->bandwidth_ + 1) + (i - j)];
+};
+
+namespace
+{
+
+// Waypoints of the centreline whose offsets are optimized
+struct Knots
+{
+  std::vector<int> ids;
+  std::vector<double> gaps;        // [m] along the centreline to the next knot
+  std::vector<double> curvatures;  // [1/m] positive when turning left
+  std::vector<double> lower;       // [m] bounds of the offsets
+  std::vector<double> upper;
+};
+
+// Offsets of the knots minimizing the integral of the squared curvature plus length_weight times the length of the
+// line, both to second order in the offsets. Moving the line by a along the normals changes the curvature by
+// a'' + k^2 a and the length element by (-k a + a'^2 / 2) ds, so the objective is a' H a + 2 g' a + constant with
+// H cyclic pentadiagonal, stored as its upper band
+bool solveKnotOffsets(const Knots& knots, const double length_weight, const int max_iterations, std::vector<double>& alpha,
+                      int& num_iterations, bool& converged, std::string& error)
+{
+  const int m = knots.ids.size();
+  const int row = kLineBandwidth + 1;
+  std::vector<double> hessian(m * row, 0.0);
+  std::vector<double> gradient(m, 0.0);
+  for (int j = 0; j < m; j++)
+  {
+    const int ids[3] = {(j + m - 1) % m, j, (j + 1) % m};
+    const double h_before = knots.gaps[ids[0]];
+    const double h_after = knots.gaps[j];
+    const double curvature = knots.curvatures[j];
+    const double scale = std::sqrt(0.5 * (h_before + h_after));
+    const double weights[3] = {scale * 2.0 / (h_before * (h_before + h_after)),
+                               scale * (curvature * curvature - 2.0 / (h_before * h_after)),
+                               scale * 2.0 / (h_after * (h_before + h_after))};
+    for (int p = 0; p < 3; p++)
+    {
+      gradient[ids[p]] += weights[p] * scale * curvature;
+      for (int q = p; q < 3; q++)
+      {
+        hessian[ids[p] * row + (q - p)] += weights[p] * weights[q];
+      }
+    }
+
+    // Length of the segment to the next knot
+    const double stretch = 0.5 * length_weight / h_after;
+    hessian[j * row] += stretch;
+    hessian[ids[2] * row] += stretch;
+    hessian[j * row + 1] -= stretch;
+    gradient[j] -= 0.25 * length_weight * (h_before + h_after) * curvature;
+
+    // A tiny ridge keeps the system definite along the offsets that barely change the objective
+    hessian[j * row] += kRidge * 0.5 * (h_before + h_after);
+  }
+
+  // Offsets minimizing the objective with the knots of a working set fixed on a bound (1 on the upper bound, -1 on
+  // the lower one), from the reduced system of the others, still cyclic banded
+  std::vector<double> reduced(hessian.size()), product(m);
+  CyclicBandedCholesky solver;
+  auto fixed = [&](const std::vector<int>& bound, const int j) { return (bound[j] > 0)? knots.upper[j] : knots.lower[j]; };
+  auto solve_reduced = [&](const std::vector<int>& bound, std::vector<double>& x)
+  {
+    for (int j = 0; j < m; j++)
+    {
+      x[j] = bound[j]? fixed(bound, j) : -gradient[j];
+    }
+    for (int j = 0; j < m; j++)
+    {
+      reduced[j * row] = bound[j]? 1.0 : hessian[j * row];
+      for (int k = 1; k < row; k++)
+      {
+        const int other = (j + k) % m;
+        reduced[j * row + k] = (bound[j] || bound[other])? 0.0 : hessian[j * row + k];
+        if (bound[other] && !bound[j])
+        {
+          x[j] -= hessian[j * row + k] * fixed(bound, other);
+        }
+        else if (bound[j] && !bound[other])
+        {
+          x[other] -= hessian[j * row + k] * fixed(bound, j);
+        }
+      }
+    }
+    if (!solver.factorize(m, kLineBandwidth, reduced))
+    {
+      error = "the curvature system is not positive definite";
+      return false;
+    }
+    solver.solve(x);
+    return true;
+  };
+  // Gradient H a + g of the objective, minus the multipliers of the bounds: positive on the upper bound and
+  // negative on the lower one
+  auto compute_gradient = [&](const std::vector<double>& x)
+  {
+    for (int j = 0; j < m; j++)
+    {
+      product[j] = hessian[j * row] * x[j] + gradient[j];
+    }
+    for (int j = 0; j < m; j++)
+    {
+      for (int k = 1; k < row; k++)
+      {
+        const int other = (j + k) % m;
+        product[j] += hessian[j * row + k] * x[other];
+        product[other] += hessian[j * row + k] * x[j];
+      }
+    }
+  };
+
+  // Primal-dual active set on min a' H a / 2 + g' a subject to the bounds: the offsets past a bound are fixed on it,
+  // and released when their multiplier pushes them back inwards. It usually settles in a few tens of iterations,
+  // but may cycle between active sets
+  std::vector<int> bound(m, 0), next_bound(m, 0);
+  std::set<std::vector<int>> visited;
+  alpha.assign(m, 0.0);
+  converged = false;
+  for (num_iterations = 1; num_iterations <= max_iterations; num_iterations++)
+  {
+    if (!solve_reduced(bound, alpha))
+    {
+      return false;
+    }
+    compute_gradient(alpha);
+    for (int j = 0; j < m; j++)
+    {
+      if (bound[j])
+      {
+        next_bound[j] = (bound[j] * product[j] <= 0.0)? bound[j] : 0;
+      }
+      else
+      {
+        next_bound[j] = (alpha[j] > knots.upper[j])? 1 : (alpha[j] < knots.lower[j])? -1 : 0;
+      }
+    }
+    if (next_bound == bound)
+    {
+      converged = true;
+      return true;
+    }
+    visited.insert(bound);
+    if (visited.count(next_bound))
+    {
+      break;
+    }
+    bound.swap(next_bound);
+  }
+  num_iterations = std::min(num_iterations, max_iterations);
+
+  // Finish with a primal active set method from the offsets clamped to the bounds. It only takes feasible steps that
+  // decrease the objective, adding the first bound in the way, and releases one bound at a time at the minimizer of
+  // the working set, so it cannot cycle
+  for (int j = 0; j < m; j++)
+  {
+    alpha[j] = std::min(std::max(alpha[j], knots.lower[j]), knots.upper[j]);
+    bound[j] = (alpha[j] >= knots.upper[j])? 1 : (alpha[j] <= knots.lower[j])? -1 : 0;
+  }
+  double max_gradient = 0.0;
+  for (int j = 0; j < m; j++)
+  {
+    max_gradient = std::max(max_gradient, std::fabs(gradient[j]));
+  }
+  const double tolerance = kMultiplierTolerance * std::max(max_gradient, 1.0);
+  std::vector<double> target(m);
+  for (int k = 0; k < max_iterations + 2 * m; k++)
+  {
+    num_iterations++;
+    if (!solve_reduced(bound, target))
+    {
+      return false;
+    }
+    double step = 1.0;
+    int id_blocking = -1;
+    for (int j = 0; j < m; j++)
+    {
+      const double delta = target[j] - alpha[j];
+      const double room = (delta > 0.0)? knots.upper[j] - alpha[j] : knots.lower[j] - alpha[j];
+      if (!bound[j] && delta != 0.0 && room / delta < step)
+      {
+        step = std::max(room / delta, 0.0);
+        id_blocking = j;
+      }
+    }
+    for (int j = 0; j < m; j++)
+    {
+      alpha[j] = bound[j]? alpha[j] : alpha[j] + step * (target[j] - alpha[j]);
+    }
+    if (id_blocking >= 0)
+    {
+      bound[id_blocking] = (target[id_blocking] > alpha[id_blocking])? 1 : -1;
+      alpha[id_blocking] = fixed(bound, id_blocking);
+      continue;
+    }
+
+    // Minimizer of the working set, the bound whose multiplier pulls inwards the most is released
+    compute_gradient(alpha);
+    int id_released = -1;
+    double worst = tolerance;
+    for (int j = 0; j < m; j++)
+    {
+      if (bound[j] && bound[j] * product[j] > worst)
+      {
+        worst = bound[j] * product[j];
+        id_released = j;
+      }
+    }
+    if (id_released < 0)
+    {
+      converged = true;
+      return true;
+    }
+    bound[id_released] = 0;
+  }
+
+  return true;
+}
+
+} // namespace
+
+bool optimizeRacingLine(const std::vector<Pose2D>& centreline, const RacingLineOptions& options, RacingLine& line,
+                        std::string& error)
+{
+  line = RacingLine();
+  const int n = numDistinctWaypoints(centreline);
+  if (n <= 2 * kLineBandwidth + 1)
+  {
+    error = "the centreline needs more than " + std::to_string(2 * kLineBandwidth + 1) + " waypoints";
+    return false;
+  }
+  if (options.corridor_width < 0.0 || !(options.knot_spacing > 0.0))
+  {
+    error = "negative corridor width or knot spacing";
+    return false;
+  }
+
+  // Distinct waypoints of the centreline and the length of the segment after each one, the racing line keeps one
+  // waypoint per waypoint of the centreline
+  std::vector<Pose2D> points(centreline.begin(), centreline.begin() + n);
+  std::vector<double> s(n + 1, 0.0);
+  for (int i = 0; i < n; i++)
+  {
+    const double ds = std::hypot(points[(i + 1) % n].x - points[i].x, points[(i + 1) % n].y - points[i].y);
+    if (!(ds > 0.0))
+    {
+      error = "waypoint " + std::to_string(i) + " of the centreline is repeated";
+      return false;
+    }
+    s[i + 1] = s[i] + ds;
+  }
+
+  // Unit normals, to the left of the central difference, and the bounds of the offsets: within the corridor, and
+  // never so far inside a turn that the line would fold over
+  const double half_width = 0.5 * options.corridor_width;
+  std::vector<double> nx(n), ny(n), lower(n, -half_width), upper(n, half_width);
+  for (int i = 0; i < n; i++)
+  {
+    const int previous = (i + n - 1) % n;
+    const int next = (i + 1) % n;
+    const double tx = points[next].x - points[previous].x;
+    const double ty = points[next].y - points[previous].y;
+    const double norm = std::hypot(tx, ty);
+    if (!(norm > 0.0))
+    {
+      error = "the centreline turns back on itself at waypoint " + std::to_string(i);
+      return false;
+    }
+    nx[i] = -ty / norm;
+    ny[i] = tx / norm;
+
+    const double curvature = mengerCurvature(points[previous], points[i], points[next]);
+    if (curvature > 0.0)
+    {
+      upper[i] = std::min(upper[i], kMaxInnerOffset / curvature);
+    }
+    else if (curvature < 0.0)
+    {
+      lower[i] = std::max(lower[i], kMaxInnerOffset / curvature);
+    }
+  }
+
+  // The offsets are optimized at knots every knot_spacing along the centreline, at the closest waypoints, and
+  // interpolated in between: a smooth line needs no more, and the active set method settles in a number of
+  // iterations that grows with the number of knots. Their number only depends on the length of the track, unless
+  // the waypoints are sparser than the knots
+  const int num_knots = std::min(n, std::max(2 * kLineBandwidth + 2, int(std::lround(s[n] / options.knot_spacing))));
+  Knots knots;
+  for (int j = 0; j < num_knots; j++)
+  {
+    const double target = s[n] * j / num_knots;
+    int id = std::lower_bound(s.begin(), s.end(), target) - s.begin();
+    if (id > 0 && target - s[id - 1] < s[id] - target)
+    {
+      id--;
+    }
+    if (id < n && (knots.ids.empty() || id > knots.ids.back()))
+    {
+      knots.ids.push_back(id);
+    }
+  }
+  const int m = knots.ids.size();
+  if (m <= 2 * kLineBandwidth + 1)
+  {
+    error = "the centreline is too uneven to place " + std::to_string(2 * kLineBandwidth + 2) + " knots";
+    return false;
+  }
+  for (int j = 0; j < m; j++)
+  {
+    const int id = knots.ids[j];
+    knots.gaps.push_back((j + 1 < m)? s[knots.ids[j + 1]] - s[id] : s[n] - s[id]);
+    knots.curvatures.push_back(mengerCurvature(points[knots.ids[(j + m - 1) % m]], points[id], points[knots.ids[(j + 1) % m]]));
+    knots.lower.push_back(lower[id]);
+    knots.upper.push_back(upper[id]);
+  }
+
+  // Line through the offsets of the knots, on a periodic monotone cubic (PCHIP) that never overshoots them, so the
+  // clamping to the bounds never folds the line, with its speed profile
+  const bool closed = (n < int(centreline.size()));
+  std::vector<double> slopes(m);
+  auto build_line = [&](const std::vector<double>& alpha, RacingLine& candidate)
+  {
+    for (int j = 0; j < m; j++)
+    {
+      const int previous = (j + m - 1) % m;
+      const double h0 = knots.gaps[previous];
+      const double h1 = knots.gaps[j];
+      const double d0 = (alpha[j] - alpha[previous]) / h0;
+      const double d1 = (alpha[(j + 1) % m] - alpha[j]) / h1;
+      slopes[j] = (d0 * d1 > 0.0)? 3.0 * (h0 + h1) / ((2.0 * h1 + h0) / d0 + (h1 + 2.0 * h0) / d1) : 0.0;
+    }
+
+    candidate.offsets.resize(n);
+    for (int j = 0; j < m; j++)
+    {
+      const double a0 = alpha[j];
+      const double a1 = alpha[(j + 1) % m];
+      const double h = knots.gaps[j];
+      const int end = (j + 1 < m)? knots.ids[j + 1] : n;  // the first knot is the first waypoint
+      for (int i = knots.ids[j]; i < end; i++)
+      {
+        const double t = (s[i] - s[knots.ids[j]]) / h;
+        const double offset = (2.0 * t * t * t - 3.0 * t * t + 1.0) * a0 + (t * t * t - 2.0 * t * t + t) * h * slopes[j]
+                              + (-2.0 * t * t * t + 3.0 * t * t) * a1 + (t * t * t - t * t) * h * slopes[(j + 1) % m];
+        candidate.offsets[i] = std::min(std::max(offset, lower[i]), upper[i]);
+      }
+    }
+
+    candidate.path.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+      candidate.path[i].x = points[i].x + candidate.offsets[i] * nx[i];
+      candidate.path[i].y = points[i].y + candidate.offsets[i] * ny[i];
+    }
+    if (closed)
+    {
+      candidate.path.push_back(candidate.path.front());
+      candidate.offsets.push_back(candidate.offsets.front());
+    }
+    orientWaypoints(candidate.path);
+    candidate.speeds = computeSpeedProfile(candidate.path, options);
+    candidate.lap_time = computeLapTime(candidate.path, candidate.speeds);
+  };
+
+  // From the pure minimum curvature line to the shortest one, the fastest is kept
+  std::vector<double> alpha;
+  bool found = false;
+  for (const double length_weight : kLengthWeights)
+  {
+    RacingLine candidate;
+    if (!solveKnotOffsets(knots, length_weight, options.max_iterations, alpha, candidate.num_iterations,
+                          candidate.converged, error))
+    {
+      return false;
+    }
+    build_line(alpha, candidate);
+    candidate.length_weight = length_weight;
+    if (!found || candidate.lap_time < line.lap_time)
+    {
+      line = std::move(candidate);
+      found = true;
+    }
+  }
+
+  if (closed)
+  {
+    points.push_back(points.front());
+  }
+  orientWaypoints(points);
+  line.max_curvature = maxCurvature(line.path);
+  line.centreline_lap_time = computeLapTime(points, computeSpeedProfile(points, options));
+  line.centreline_max_curvature = maxCurvature(points);
+
+  return true;
+};
+
+std::vector<double> computeSpeedProfile(const std::vector<Pose2D>& path, const RacingLineOptions& options)
+{
+  const int n = numDistinctWaypoints(path);
+  std::vector<double> speeds(path.size(), options.max_speed);
+  if (n < 3)
+  {
+    return speeds;
+  }
+
+  // Lateral limit from the curvature, then accelerating forwards and braking backwards around the loop twice,
+  // so that the slowest corner constrains every waypoint whatever the start
+  std::vector<double> ds(n);
+  for (int i = 0; i < n; i++)
+  {
+    const int next = (i + 1) % n;
+    ds[i] = std::hypot(path[next].x - path[i].x, path[next].y - path[i].y);
+    const double curvature = std::fabs(mengerCurvature(path[(i + n - 1) % n], path[i], path[next]));
+    if (curvature > 0.0)
+    {
+      speeds[i] = std::min(speeds[i], std::sqrt(options.max_lateral_accel / curvature));
+    }
+  }
+  for (int k = 0; k < 2 * n; k++)
+  {
+    const int i = k % n;
+    const int next = (i + 1) % n;
+    speeds[next] = std::min(speeds[next], std::sqrt(speeds[i] * speeds[i] + 2.0 * options.max_accel * ds[i]));
+  }
+  for (int k = 2 * n - 1; k >= 0; k--)
+  {
+    const int i = k % n;
+    const int previous = (i + n - 1) % n;
+    speeds[previous] = std::min(speeds[previous], std::sqrt(speeds[i] * speeds[i] + 2.0 * options.max_decel * ds[previous]));
+  }
+  if (n < int(path.size()))
+  {
+    speeds.back() = speeds.front();
+  }
+
+  return speeds;
+};
+
+double computeLapTime(const std::vector<Pose2D>& path, const std::vector<double>& speeds)
+{
+  const int n = numDistinctWaypoints(path);
+  double lap_time = 0.0;
+  for (int i = 0; i < n && n > 1; i++)
+  {
+    const int next = (i + 1) % n;
+    const double speed = 0.5 * (speeds[i] + speeds[next]);
+    if (speed > 0.0)
+    {
+      lap_time += std::hypot(path[next].x - path[i].x, path[next].y - path[i].y) / speed;
+    }
+  }
+
+  return lap_time;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,726 @@
+/** route_graph.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Route graph loading, shortest path queries and contraction hierarchy preprocessing
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+
+#include "me5413_world/route_graph.hpp"
+
+namespace me5413_world
+{
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+// Nodes settled by a witness search, beyond it a shortcut is added anyway. Estimating the priority of a node only
+// needs a rough count of its shortcuts
+constexpr int kWitnessSettleLimit = 100;
+constexpr int kSimulationSettleLimit = 15;
+
+typedef std::pair<double, int> HeapEntry;
+typedef std::greater<HeapEntry> MinHeap;
+
+int RouteGraph::addNode(const std::string& name, const double x, const double y)
+{
+  if (this->node_ids_.count(name) > 0)
+  {
+    return -1;
+  }
+  const int id = this->nodes_.size();
+  this->nodes_.push_back(RouteNode{name, x, y});
+  this->node_ids_[name] = id;
+  this->finalized_ = false;
+
+  return id;
+};
+
+bool RouteGraph::addEdge(const int from, const int to, const std::vector<RoutePoint>& via, const bool one_way)
+{
+  if (from < 0 || to < 0 || from >= numNodes() || to >= numNodes())
+  {
+    return false;
+  }
+
+  // The polyline is never shorter than the straight line between its ends
+  double length = 0.0;
+  RoutePoint previous{this->nodes_[from].x, this->nodes_[from].y};
+  for (const RoutePoint& point : via)
+  {
+    length += std::hypot(point.x - previous.x, point.y - previous.y);
+    previous = point;
+  }
+  length += std::hypot(this->nodes_[to].x - previous.x, this->nodes_[to].y - previous.y);
+
+  const int first_point = this->points_.size();
+  this->points_.insert(this->points_.end(), via.begin(), via.end());
+  this->arcs_.push_back(RouteArc{from, to, length, first_point, int(via.size()), false});
+  if (!one_way)
+  {
+    this->arcs_.push_back(RouteArc{to, from, length, first_point, int(via.size()), true});
+  }
+  this->finalized_ = false;
+
+  return true;
+};
+
+void RouteGraph::finalize()
+{
+  // Counting sort of the arcs by tail
+  this->out_offsets_.assign(this->nodes_.size() + 1, 0);
+  for (const RouteArc& arc : this->arcs_)
+  {
+    this->out_offsets_[arc.from + 1]++;
+  }
+  for (size_t i = 1; i < this->out_offsets_.size(); i++)
+  {
+    this->out_offsets_[i] += this->out_offsets_[i - 1];
+  }
+  this->out_arcs_.resize(this->arcs_.size());
+  std::vector<int> next(this->out_offsets_.begin(), this->out_offsets_.end() - 1);
+  for (size_t i = 0; i < this->arcs_.size(); i++)
+  {
+    this->out_arcs_[next[this->arcs_[i].from]++] = i;
+  }
+  this->finalized_ = true;
+};
+
+int RouteGraph::findNode(const std::string& name) const
+{
+  const std::unordered_map<std::string, int>::const_iterator it = this->node_ids_.find(name);
+  return (it == this->node_ids_.end())? -1 : it->second;
+};
+
+bool loadRouteGraph(const std::string& file_path, RouteGraph& graph, std::string& error)
+{
+  std::ifstream file(file_path);
+  if (!file)
+  {
+    error = "cannot open " + file_path;
+    return false;
+  }
+
+  graph = RouteGraph();
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line))
+  {
+    line_number++;
+    std::istringstream tokens(line.substr(0, line.find('#')));
+    const std::string where = file_path + ":" + std::to_string(line_number) + ": ";
+    std::string keyword;
+    if (!(tokens >> keyword))
+    {
+      continue;
+    }
+
+    if (keyword == "node")
+    {
+      std::string name;
+      double x, y;
+      if (!(tokens >> name >> x >> y))
+      {
+        error = where + "expected node <name> <x> <y>";
+        return false;
+      }
+      if (graph.addNode(name, x, y) < 0)
+      {
+        error = where + "node " + name + " is declared twice";
+        return false;
+      }
+    }
+    else if (keyword == "edge")
+    {
+      std::string from, to, token;
+      if (!(tokens >> from >> to))
+      {
+        error = where + "expected edge <from> <to> [oneway] [<x> <y> ...]";
+        return false;
+      }
+      bool one_way = false;
+      std::vector<double> values;
+      while (tokens >> token)
+      {
+        char* end = nullptr;
+        const double value = std::strtod(token.c_str(), &end);
+        if (token == "oneway" && values.empty())
+        {
+          one_way = true;
+        }
+        else if (*end == '\0')
+        {
+          values.push_back(value);
+        }
+        else
+        {
+          error = where + "unexpected " + token;
+          return false;
+        }
+      }
+      if (values.size() % 2 != 0)
+      {
+        error = where + "the intermediate points need both x and y";
+        return false;
+      }
+      std::vector<RoutePoint> via;
+      for (size_t i = 0; i < values.size(); i += 2)
+      {
+        via.push_back(RoutePoint{values[i], values[i + 1]});
+      }
+      if (!graph.addEdge(graph.findNode(from), graph.findNode(to), via, one_way))
+      {
+        error = where + "unknown node in edge " + from + " " + to + ", nodes are declared before their edges";
+        return false;
+      }
+    }
+    else
+    {
+      error = where + "unknown declaration " + keyword;
+      return false;
+    }
+  }
+  graph.finalize();
+
+  return true;
+};
+
+RouteSearch::RouteSearch(const RouteGraph& graph) :
+  graph_(graph),
+  dist_(graph.numNodes(), kInfinity),
+  parent_arc_(graph.numNodes(), -1),
+  visited_(graph.numNodes(), 0),
+  search_id_(0),
+  num_settled_(0)
+{};
+
+bool RouteSearch::dijkstra(const int source, const int target, Route& route)
+{
+  return search(source, target, false, route);
+};
+
+bool RouteSearch::astar(const int source, const int target, Route& route)
+{
+  return search(source, target, true, route);
+};
+
+bool RouteSearch::search(const int source, const int target, const bool use_heuristic, Route& route)
+{
+  route.arcs.clear();
+  route.length = 0.0;
+  this->num_settled_ = 0;
+  const int num_nodes = this->graph_.numNodes();
+  if (source < 0 || target < 0 || source >= num_nodes || target >= num_nodes)
+  {
+    return false;
+  }
+
+  // Start a new search, the state of the previous ones is stale rather than cleared
+  if (++this->search_id_ == 0)
+  {
+    std::fill(this->visited_.begin(), this->visited_.end(), 0);
+    this->search_id_ = 1;
+  }
+  const RouteNode& goal = this->graph_.node(target);
+  auto heuristic = [&](const int node)
+  {
+    return use_heuristic? std::hypot(this->graph_.node(node).x - goal.x, this->graph_.node(node).y - goal.y) : 0.0;
+  };
+
+  this->heap_.clear();
+  this->dist_[source] = 0.0;
+  this->parent_arc_[source] = -1;
+  this->visited_[source] = this->search_id_;
+  this->heap_.emplace_back(heuristic(source), source);
+  const std::vector<int>& out_arcs = this->graph_.outArcs();
+  while (!this->heap_.empty())
+  {
+    std::pop_heap(this->heap_.begin(), this->heap_.end(), MinHeap());
+    const HeapEntry entry = this->heap_.back();
+    this->heap_.pop_back();
+    const int node = entry.second;
+    if (entry.first > this->dist_[node] + heuristic(node))
+    {
+      continue;  // stale entry of a node reached again with a shorter distance
+    }
+    this->num_settled_++;
+    if (node == target)
+    {
+      break;
+    }
+
+    for (int i = this->graph_.outBegin(node); i < this->graph_.outEnd(node); i++)
+    {
+      const RouteArc& arc = this->graph_.arc(out_arcs[i]);
+      const double dist = this->dist_[node] + arc.length;
+      if (this->visited_[arc.to] != this->search_id_ || dist < this->dist_[arc.to])
+      {
+        this->visited_[arc.to] = this->search_id_;
+        this->dist_[arc.to] = dist;
+        this->parent_arc_[arc.to] = out_arcs[i];
+        this->heap_.emplace_back(dist + heuristic(arc.to), arc.to);
+        std::push_heap(this->heap_.begin(), this->heap_.end(), MinHeap());
+      }
+    }
+  }
+  if (this->visited_[target] != this->search_id_)
+  {
+    return false;
+  }
+
+  for (int node = target; node != source; node = this->graph_.arc(this->parent_arc_[node]).from)
+  {
+    route.arcs.push_back(this->parent_arc_[node]);
+  }
+  std::reverse(route.arcs.begin(), route.arcs.end());
+  route.length = this->dist_[target];
+
+  return true;
+};
+
+void ContractionHierarchy::build(const RouteGraph& graph)
+{
+  this->graph_ = &graph;
+  const int num_nodes = graph.numNodes();
+
+  // The arcs of the graph keep their ids, shortcuts come after them
+  this->arcs_.clear();
+  std::vector<std::vector<int>> out(num_nodes), in(num_nodes);
+  for (int i = 0; i < graph.numArcs(); i++)
+  {
+    const RouteArc& arc = graph.arc(i);
+    this->arcs_.push_back(Arc{arc.from, arc.to, arc.length, -1, -1});
+    if (arc.from != arc.to)
+    {
+      out[arc.from].push_back(i);
+      in[arc.to].push_back(i);
+    }
+  }
+  this->num_original_arcs_ = this->arcs_.size();
+
+  std::vector<bool> contracted(num_nodes, false);
+  std::vector<int> num_contracted_neighbors(num_nodes, 0);
+  std::vector<double> witness_dist(num_nodes, kInfinity);
+  std::vector<uint32_t> witness_visited(num_nodes, 0);
+  uint32_t witness_id = 0;
+  std::vector<HeapEntry> heap;
+
+  // Shortest arc to each remaining neighbour, parallel arcs are dropped
+  auto neighbours = [&](const std::vector<int>& arcs, const bool outgoing, std::vector<std::pair<int, int>>& best)
+  {
+    best.clear();
+    for (const int a : arcs)
+    {
+      const int other = outgoing? this->arcs_[a].to : this->arcs_[a].from;
+      if (!contracted[other])
+      {
+        best.emplace_back(other, a);
+      }
+    }
+    std::sort(best.begin(), best.end(), [this](const std::pair<int, int>& l, const std::pair<int, int>& r)
+    {
+      return (l.first != r.first)? l.first < r.first : this->arcs_[l.second].length < this->arcs_[r.second].length;
+    });
+    best.erase(std::unique(best.begin(), best.end(), [](const std::pair<int, int>& l, const std::pair<int, int>& r)
+    {
+      return l.first == r.first;
+    }), best.end());
+  };
+
+  // Distances from u among the remaining nodes without v, until the targets are settled or farther than max_dist
+  std::vector<bool> is_target(num_nodes, false);
+  auto witnessSearch = [&](const int u, const int v, const double max_dist, int num_targets, const int settle_limit)
+  {
+    if (++witness_id == 0)
+    {
+      std::fill(witness_visited.begin(), witness_visited.end(), 0);
+      witness_id = 1;
+    }
+    heap.clear();
+    witness_dist[u] = 0.0;
+    witness_visited[u] = witness_id;
+    heap.emplace_back(0.0, u);
+    int num_settled = 0;
+    while (!heap.empty() && num_settled < settle_limit)
+    {
+      std::pop_heap(heap.begin(), heap.end(), MinHeap());
+      const HeapEntry entry = heap.back();
+      heap.pop_back();
+      if (entry.first > witness_dist[entry.second])
+      {
+        continue;
+      }
+      if (entry.first > max_dist || (is_target[entry.second] && --num_targets == 0))
+      {
+        break;
+      }
+      num_settled++;
+      for (const int a : out[entry.second])
+      {
+        const int w = this->arcs_[a].to;
+        const double dist = entry.first + this->arcs_[a].length;
+        if (w == v || contracted[w] || (witness_visited[w] == witness_id && dist >= witness_dist[w]))
+        {
+          continue;
+        }
+        witness_visited[w] = witness_id;
+        witness_dist[w] = dist;
+        heap.emplace_back(dist, w);
+        std::push_heap(heap.begin(), heap.end(), MinHeap());
+      }
+    }
+  };
+
+  // Shortcuts needed to remove v, only counted if simulate
+  std::vector<std::pair<int, int>> ins, outs;
+  auto contract = [&](const int v, const bool simulate)
+  {
+    neighbours(in[v], false, ins);
+    neighbours(out[v], true, outs);
+    int num_shortcuts = 0;
+    for (const std::pair<int, int>& to : outs)
+    {
+      is_target[to.first] = true;
+    }
+    for (const std::pair<int, int>& from : ins)
+    {
+      double max_dist = 0.0;
+      for (const std::pair<int, int>& to : outs)
+      {
+        max_dist = std::max(max_dist, this->arcs_[from.second].length + this->arcs_[to.second].length);
+      }
+      witnessSearch(from.first, v, max_dist, outs.size(), simulate? kSimulationSettleLimit : kWitnessSettleLimit);
+      for (const std::pair<int, int>& to : outs)
+      {
+        const double length = this->arcs_[from.second].length + this->arcs_[to.second].length;
+        if (to.first == from.first || (witness_visited[to.first] == witness_id && witness_dist[to.first] <= length))
+        {
+          continue;
+        }
+        num_shortcuts++;
+        if (!simulate)
+        {
+          const int id = this->arcs_.size();
+          this->arcs_.push_back(Arc{from.first, to.first, length, from.second, to.second});
+          out[from.first].push_back(id);
+          in[to.first].push_back(id);
+        }
+      }
+    }
+    for (const std::pair<int, int>& to : outs)
+    {
+      is_target[to.first] = false;
+    }
+    return num_shortcuts;
+  };
+
+  // Edge difference plus the neighbours already contracted, to spread the contraction over the graph
+  auto priority = [&](const int v)
+  {
+    const int num_shortcuts = contract(v, true);
+    return double(num_shortcuts - int(ins.size() + outs.size()) + num_contracted_neighbors[v]);
+  };
+
+  // Nodes are queued again when their priority changes, older entries are skipped
+  std::vector<HeapEntry> queue;
+  std::vector<double> queued_priority(num_nodes);
+  for (int v = 0; v < num_nodes; v++)
+  {
+    queued_priority[v] = priority(v);
+    queue.emplace_back(queued_priority[v], v);
+  }
+  std::make_heap(queue.begin(), queue.end(), MinHeap());
+  this->rank_.assign(num_nodes, 0);
+  int next_rank = 0;
+  std::vector<int> affected;
+  while (!queue.empty())
+  {
+    std::pop_heap(queue.begin(), queue.end(), MinHeap());
+    const HeapEntry entry = queue.back();
+    queue.pop_back();
+    const int v = entry.second;
+    if (contracted[v] || entry.first != queued_priority[v])
+    {
+      continue;
+    }
+
+    contract(v, false);
+    contracted[v] = true;
+    this->rank_[v] = next_rank++;
+
+    // Arcs to v are no longer needed by the contraction, the neighbours get a new priority
+    affected.clear();
+    for (const std::pair<int, int>& neighbour : ins)
+    {
+      std::vector<int>& arcs = out[neighbour.first];
+      arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [&](const int a) { return this->arcs_[a].to == v; }),
+                 arcs.end());
+      affected.push_back(neighbour.first);
+    }
+    for (const std::pair<int, int>& neighbour : outs)
+    {
+      std::vector<int>& arcs = in[neighbour.first];
+      arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [&](const int a) { return this->arcs_[a].from == v; }),
+                 arcs.end());
+      affected.push_back(neighbour.first);
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+    for (const int u : affected)
+    {
+      num_contracted_neighbors[u]++;
+    }
+    for (const int u : affected)
+    {
+      queued_priority[u] = priority(u);
+      queue.emplace_back(queued_priority[u], u);
+      std::push_heap(queue.begin(), queue.end(), MinHeap());
+    }
+  }
+
+  // Upward graphs: the forward search only takes arcs to higher ranks, the backward one arcs from higher ranks
+  for (int d = 0; d < 2; d++)
+  {
+    std::vector<std::vector<UpwardArc>> lists(num_nodes);
+    for (int a = 0; a < int(this->arcs_.size()); a++)
+    {
+      const Arc& arc = this->arcs_[a];
+      if (arc.from == arc.to)
+      {
+        continue;
+      }
+      const bool upward = this->rank_[arc.from] < this->rank_[arc.to];
+      if (d == 0 && upward)
+      {
+        lists[arc.from].push_back(UpwardArc{arc.to, arc.length, a});
+      }
+      else if (d == 1 && !upward)
+      {
+        lists[arc.to].push_back(UpwardArc{arc.from, arc.length, a});
+      }
+    }
+    this->up_offsets_[d].assign(num_nodes + 1, 0);
+    this->up_arcs_[d].clear();
+    for (int v = 0; v < num_nodes; v++)
+    {
+      this->up_arcs_[d].insert(this->up_arcs_[d].end(), lists[v].begin(), lists[v].end());
+      this->up_offsets_[d][v + 1] = this->up_arcs_[d].size();
+    }
+    this->directions_[d].dist.assign(num_nodes, kInfinity);
+    this->directions_[d].parent_arc.assign(num_nodes, -1);
+    this->directions_[d].visited.assign(num_nodes, 0);
+  }
+  this->search_id_ = 0;
+};
+
+bool ContractionHierarchy::query(const int source, const int target, Route& route)
+{
+  route.arcs.clear();
+  route.length = 0.0;
+  this->num_settled_ = 0;
+  const int num_nodes = this->rank_.size();
+  if (source < 0 || target < 0 || source >= num_nodes || target >= num_nodes)
+  {
+    return false;
+  }
+  if (source == target)
+  {
+    return true;
+  }
+
+  if (++this->search_id_ == 0)
+  {
+    for (Direction& direction : this->directions_)
+    {
+      std::fill(direction.visited.begin(), direction.visited.end(), 0);
+    }
+    this->search_id_ = 1;
+  }
+  const int starts[2] = {source, target};
+  for (int d = 0; d < 2; d++)
+  {
+    Direction& direction = this->directions_[d];
+    direction.heap.clear();
+    direction.dist[starts[d]] = 0.0;
+    direction.parent_arc[starts[d]] = -1;
+    direction.visited[starts[d]] = this->search_id_;
+    direction.heap.emplace_back(0.0, starts[d]);
+  }
+
+  // Both searches climb until neither can improve on the best meeting point
+  double best = kInfinity;
+  int meeting = -1;
+  while (true)
+  {
+    const double keys[2] = {this->directions_[0].heap.empty()? kInfinity : this->directions_[0].heap.front().first,
+                            this->directions_[1].heap.empty()? kInfinity : this->directions_[1].heap.front().first};
+    const int d = (keys[0] <= keys[1])? 0 : 1;
+    if (keys[d] >= best)
+    {
+      break;
+    }
+
+    Direction& direction = this->directions_[d];
+    const Direction& other = this->directions_[1 - d];
+    std::pop_heap(direction.heap.begin(), direction.heap.end(), MinHeap());
+    const HeapEntry entry = direction.heap.back();
+    direction.heap.pop_back();
+    const int node = entry.second;
+    if (entry.first > direction.dist[node])
+    {
+      continue;
+    }
+    this->num_settled_++;
+    if (other.visited[node] == this->search_id_ && entry.first + other.dist[node] < best)
+    {
+      best = entry.first + other.dist[node];
+      meeting = node;
+    }
+
+    // Stall on demand: a higher node of this search reaches the node by a shorter way, so no shortest path
+    // climbs through it
+    bool stalled = false;
+    for (int i = this->up_offsets_[1 - d][node]; i < this->up_offsets_[1 - d][node + 1] && !stalled; i++)
+    {
+      const UpwardArc& arc = this->up_arcs_[1 - d][i];
+      stalled = direction.visited[arc.head] == this->search_id_ && direction.dist[arc.head] + arc.length < entry.first;
+    }
+    if (stalled)
+    {
+      continue;
+    }
+
+    for (int i = this->up_offsets_[d][node]; i < this->up_offsets_[d][node + 1]; i++)
+    {
+      const UpwardArc& arc = this->up_arcs_[d][i];
+      const double dist = entry.first + arc.length;
+      if (direction.visited[arc.head] != this->search_id_ || dist < direction.dist[arc.head])
+      {
+        direction.visited[arc.head] = this->search_id_;
+        direction.dist[arc.head] = dist;
+        direction.parent_arc[arc.head] = arc.arc;
+        direction.heap.emplace_back(dist, arc.head);
+        std::push_heap(direction.heap.begin(), direction.heap.end(), MinHeap());
+      }
+    }
+  }
+  if (meeting < 0)
+  {
+    return false;
+  }
+
+  // Source to meeting point, then meeting point to target, with the shortcuts expanded
+  std::vector<int> hierarchy_arcs;
+  for (int node = meeting; node != source; node = this->arcs_[this->directions_[0].parent_arc[node]].from)
+  {
+    hierarchy_arcs.push_back(this->directions_[0].parent_arc[node]);
+  }
+  std::reverse(hierarchy_arcs.begin(), hierarchy_arcs.end());
+  for (int node = meeting; node != target; node = this->arcs_[this->directions_[1].parent_arc[node]].to)
+  {
+    hierarchy_arcs.push_back(this->directions_[1].parent_arc[node]);
+  }
+  for (const int arc : hierarchy_arcs)
+  {
+    unpack(arc, route.arcs);
+  }
+  route.length = best;
+
+  return true;
+};
+
+void ContractionHierarchy::unpack(const int arc, std::vector<int>& graph_arcs) const
+{
+  // Depth first, the first half of a shortcut comes out first
+  std::vector<int> stack(1, arc);
+  while (!stack.empty())
+  {
+    const Arc& top = this->arcs_[stack.back()];
+    if (top.child_first < 0)
+    {
+      graph_arcs.push_back(stack.back());
+      stack.pop_back();
+      continue;
+    }
+    stack.back() = top.child_second;
+    stack.push_back(top.child_first);
+  }
+};
+
+std::vector<Pose2D> stitchRoutes(const RouteGraph& graph, const std::vector<Route>& legs, const double spacing)
+{
+  // Polyline through every arc, without repeating the shared nodes
+  std::vector<RoutePoint> polyline;
+  auto append = [&polyline](const RoutePoint& point)
+  {
+    if (polyline.empty() || std::hypot(point.x - polyline.back().x, point.y - polyline.back().y) > 1e-9)
+    {
+      polyline.push_back(point);
+    }
+  };
+  for (const Route& leg : legs)
+  {
+    for (const int id : leg.arcs)
+    {
+      const RouteArc& arc = graph.arc(id);
+      append(RoutePoint{graph.node(arc.from).x, graph.node(arc.from).y});
+      for (int i = 0; i < arc.num_points; i++)
+      {
+        append(graph.points()[arc.first_point + (arc.reversed? arc.num_points - 1 - i : i)]);
+      }
+      append(RoutePoint{graph.node(arc.to).x, graph.node(arc.to).y});
+    }
+  }
+
+  // Evenly spaced waypoints, the last one on the final node
+  std::vector<Pose2D> path;
+  if (spacing <= 0.0 || polyline.size() < 2)
+  {
+    for (const RoutePoint& point : polyline)
+    {
+      path.push_back(Pose2D{point.x, point.y, 0.0});
+    }
+  }
+  else
+  {
+    double s_next = 0.0;
+    double s_segment = 0.0;
+    for (size_t i = 0; i + 1 < polyline.size(); i++)
+    {
+      const double dx = polyline[i + 1].x - polyline[i].x;
+      const double dy = polyline[i + 1].y - polyline[i].y;
+      const double length = std::hypot(dx, dy);
+      for (; s_next < s_segment + length; s_next += spacing)
+      {
+        const double ratio = (s_next - s_segment) / length;
+        path.push_back(Pose2D{polyline[i].x + ratio * dx, polyline[i].y + ratio * dy, 0.0});
+      }
+      s_segment += length;
+    }
+    if (s_segment - (s_next - spacing) > 1e-3 * spacing)
+    {
+      path.push_back(Pose2D{polyline.back().x, polyline.back().y, 0.0});
+    }
+  }
+
+  // Oriented towards the next waypoint, the last one keeps the heading of the last segment
+  for (int i = 0; i + 1 < int(path.size()); i++)
+  {
+    path[i].yaw = std::atan2(path[i + 1].y - path[i].y, path[i + 1].x - path[i].x);
+  }
+  if (path.size() > 1)
+  {
+    path.back().yaw = path[path.size() - 2].yaw;
+  }
+
+  return path;
+};
+
+} // namespace me5413_world
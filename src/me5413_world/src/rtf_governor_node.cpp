@@ -0,0 +1,243 @@
+/** rtf_governor_node.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * ROS Node that holds Gazebo at a target real-time factor, trading physics accuracy for speed
+ * within configured bounds through the physics properties services
+ */
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "me5413_world/rtf_governor_node.hpp"
+
+namespace me5413_world
+{
+
+constexpr int kIterationStep = 10;   // solver iterations dropped per level
+constexpr double kStepGrowth = 1.25; // step size growth per level, once the iterations are at their minimum
+constexpr int kOverrunWindows = 2;
+constexpr int kHeadroomWindows = 5;
+
+// Process id of the first process with the given name, -1 if there is none on this machine
+int findProcess(const std::string& name)
+{
+  DIR* proc = opendir("/proc");
+  if (proc == nullptr)
+  {
+    return -1;
+  }
+  int pid = -1;
+  while (const dirent* entry = readdir(proc))
+  {
+    const int id = std::atoi(entry->d_name);
+    if (id <= 0)
+    {
+      continue;
+    }
+    std::ifstream comm(std::string("/proc/") + entry->d_name + "/comm");
+    std::string comm_name;
+    if (std::getline(comm, comm_name) && comm_name == name)
+    {
+      pid = id;
+      break;
+    }
+  }
+  closedir(proc);
+
+  return pid;
+};
+
+RtfGovernorNode::RtfGovernorNode() : gazebo_pid_(-1), window_cpu_start_(-1.0)
+{
+  this->pub_status_ = nh_.advertise<me5413_world::RtfGovernorStatus>("/me5413_world/rtf_governor", 1, true);
+  this->client_get_physics_ = nh_.serviceClient<gazebo_msgs::GetPhysicsProperties>("/gazebo/get_physics_properties");
+  this->client_set_physics_ = nh_.serviceClient<gazebo_msgs::SetPhysicsProperties>("/gazebo/set_physics_properties");
+
+  ros::NodeHandle nh_private("~");
+  nh_private.param<double>("target_rtf", this->target_rtf_, 1.0);
+  nh_private.param<double>("tolerance", this->tolerance_, 0.05);
+  const double window = nh_private.param<double>("window", 2.0);
+
+  // The most accurate settings default to the ones of the world file
+  ROS_INFO("Waiting for the Gazebo physics services...");
+  this->client_get_physics_.waitForExistence();
+  this->client_set_physics_.waitForExistence();
+  if (!readPhysics())
+  {
+    ROS_ERROR("Failed to read the Gazebo physics properties, the RTF governor is disabled");
+    return;
+  }
+  const double min_step_size = nh_private.param<double>("min_step_size", this->physics_.time_step);
+  const double max_step_size = nh_private.param<double>("max_step_size", 4.0 * min_step_size);
+  const int max_iterations = nh_private.param<int>("max_solver_iterations", this->physics_.ode_config.sor_pgs_iters);
+  const int min_iterations = nh_private.param<int>("min_solver_iterations", std::min(20, max_iterations));
+  buildLadder(min_step_size, max_step_size, min_iterations, max_iterations);
+  this->shedder_ = LoadShedder(this->ladder_.size() - 1, min_step_size / this->target_rtf_, kOverrunWindows, kHeadroomWindows);
+  applySettings(0);
+
+  // Without the CPU time of gzserver, only falling behind the target can be detected
+  this->gazebo_pid_ = findProcess("gzserver");
+  if (this->gazebo_pid_ < 0)
+  {
+    ROS_WARN("gzserver is not running on this machine, the RTF governor will not restore accuracy once it is reduced");
+  }
+
+  startWindow();
+  this->timer_ = nh_.createWallTimer(ros::WallDuration(window), &RtfGovernorNode::timerCallback, this);
+};
+
+bool RtfGovernorNode::readPhysics()
+{
+  gazebo_msgs::GetPhysicsProperties srv;
+  if (!this->client_get_physics_.call(srv) || !srv.response.success)
+  {
+    return false;
+  }
+  this->physics_ = srv.response;
+
+  return true;
+};
+
+void RtfGovernorNode::buildLadder(const double min_step_size, const double max_step_size, const int min_iterations, const int max_iterations)
+{
+  // Fewer solver iterations first, then longer steps
+  this->ladder_.clear();
+  for (int iterations = max_iterations; iterations > min_iterations; iterations -= kIterationStep)
+  {
+    this->ladder_.push_back(PhysicsSettings{min_step_size, iterations});
+  }
+  this->ladder_.push_back(PhysicsSettings{min_step_size, min_iterations});
+  for (double step_size = kStepGrowth * min_step_size; step_size < 0.99 * max_step_size; step_size *= kStepGrowth)
+  {
+    this->ladder_.push_back(PhysicsSettings{step_size, min_iterations});
+  }
+  if (max_step_size > min_step_size)
+  {
+    this->ladder_.push_back(PhysicsSettings{max_step_size, min_iterations});
+  }
+};
+
+bool RtfGovernorNode::applySettings(const int level)
+{
+  const PhysicsSettings& settings = this->ladder_[level];
+
+  // Gazebo sleeps between steps to hold the target, and runs flat out when it cannot
+  gazebo_msgs::SetPhysicsProperties srv;
+  srv.request.time_step = settings.max_step_size;
+  srv.request.max_update_rate = this->target_rtf_ / settings.max_step_size;
+  srv.request.gravity = this->physics_.gravity;
+  srv.request.ode_config = this->physics_.ode_config;
+  srv.request.ode_config.sor_pgs_iters = settings.solver_iterations;
+  if (!this->client_set_physics_.call(srv) || !srv.response.success)
+  {
+    ROS_WARN("Failed to set the Gazebo physics properties: %s", srv.response.status_message.c_str());
+    return false;
+  }
+  this->shedder_.setBudget(settings.max_step_size / this->target_rtf_);
+
+  return true;
+};
+
+void RtfGovernorNode::startWindow()
+{
+  this->window_sim_start_ = ros::Time::now();
+  this->window_wall_start_ = ros::WallTime::now();
+  this->window_cpu_start_ = gazeboCpuTime();
+};
+
+double RtfGovernorNode::gazeboCpuTime() const
+{
+  if (this->gazebo_pid_ < 0)
+  {
+    return -1.0;
+  }
+  std::ifstream file("/proc/" + std::to_string(this->gazebo_pid_) + "/stat");
+  std::string stat;
+  if (!std::getline(file, stat))
+  {
+    return -1.0;
+  }
+
+  // utime and stime are the 14th and 15th fields, the 2nd one is the name in parentheses and may contain spaces
+  const size_t name_end = stat.rfind(')');
+  unsigned long utime, stime;
+  if (name_end == std::string::npos ||
+      std::sscanf(stat.c_str() + name_end + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+  {
+    return -1.0;
+  }
+
+  return double(utime + stime) / sysconf(_SC_CLK_TCK);
+};
+
+void RtfGovernorNode::timerCallback(const ros::WallTimerEvent&)
+{
+  const ros::Time sim_now = ros::Time::now();
+  const ros::WallTime wall_now = ros::WallTime::now();
+  const double sim_elapsed = (sim_now - this->window_sim_start_).toSec();
+  const double wall_elapsed = (wall_now - this->window_wall_start_).toSec();
+  if (this->window_sim_start_.isZero() || sim_elapsed <= 0.0 || wall_elapsed <= 0.0)
+  {
+    // No clock yet, or paused
+    startWindow();
+    return;
+  }
+
+  const int level = this->shedder_.level();
+  const PhysicsSettings& settings = this->ladder_[level];
+  const double num_steps = sim_elapsed / settings.max_step_size;
+  const double rtf = sim_elapsed / wall_elapsed;
+  const double wall_per_step = wall_elapsed / num_steps;
+  const double cpu_now = gazeboCpuTime();
+  const double cpu_per_step = (cpu_now >= 0.0 && this->window_cpu_start_ >= 0.0)? (cpu_now - this->window_cpu_start_) / num_steps : -1.0;
+
+  // Falling behind the target is an overrun, whatever the cause. On target, Gazebo sleeps between steps, so only its CPU time
+  // (sensors included, so it errs on the safe side) tells whether a more accurate level would fit. Without it the level is held
+  double step_cost = wall_per_step;
+  if (rtf >= (1.0 - this->tolerance_) * this->target_rtf_)
+  {
+    step_cost = (cpu_per_step >= 0.0)? cpu_per_step : 0.75 * this->shedder_.budget();
+  }
+
+  if (this->shedder_.update(wall_now.toSec(), step_cost))
+  {
+    const PhysicsSettings& chosen = this->ladder_[this->shedder_.level()];
+    ROS_INFO("RTF %.2f (target %.2f), %.3f ms per step: max step size %.3f ms, %d solver iterations",
+             rtf, this->target_rtf_, 1000.0 * step_cost, 1000.0 * chosen.max_step_size, chosen.solver_iterations);
+    applySettings(this->shedder_.level());
+  }
+
+  me5413_world::RtfGovernorStatus status;
+  const PhysicsSettings& current = this->ladder_[this->shedder_.level()];
+  status.header.stamp = sim_now;
+  status.real_time_factor = rtf;
+  status.target_real_time_factor = this->target_rtf_;
+  status.step_cost = (cpu_per_step >= 0.0)? cpu_per_step : wall_per_step;
+  status.level = this->shedder_.level();
+  status.num_levels = this->ladder_.size();
+  status.max_step_size = current.max_step_size;
+  status.real_time_update_rate = this->target_rtf_ / current.max_step_size;
+  status.solver_iterations = current.solver_iterations;
+  this->pub_status_.publish(status);
+
+  startWindow();
+};
+
+} // namespace me5413_world
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "rtf_governor_node");
+  me5413_world::RtfGovernorNode rtf_governor_node;
+  ros::spin();  // spin the ros node.
+
+  return 0;
+}
@@ -0,0 +1,422 @@
+/** thread_pool.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Implementation of the work-stealing thread pool and the task graph
+ */
+
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <sstream>
+#include <exception>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "me5413_world/thread_pool.hpp"
+
+namespace me5413_world
+{
+
+// Pool and index of the calling worker thread
+static thread_local const ThreadPool* worker_pool = nullptr;
+static thread_local int worker_id = -1;
+
+ThreadPool::ThreadPool(const int num_threads, const std::vector<int>& cpus) :
+  num_pending_(0),
+  next_queue_(0),
+  stopping_(false)
+{
+  const int num_workers = (num_threads > 0)? num_threads : std::max(int(std::thread::hardware_concurrency()), 1);
+  for (int i = 0; i < num_workers; i++)
+  {
+    std::unique_ptr<Worker> worker(new Worker());
+    worker->num_tasks = 0;
+    worker->num_steals = 0;
+    worker->busy_ns = 0;
+    this->workers_.push_back(std::move(worker));
+  }
+
+  // Start the threads once all the queues exist, they steal from each other
+  for (int i = 0; i < num_workers; i++)
+  {
+    this->workers_[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+#ifdef __linux__
+    if (!cpus.empty())
+    {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpus[i % cpus.size()], &cpu_set);
+      pthread_setaffinity_np(this->workers_[i]->thread.native_handle(), sizeof(cpu_set_t), &cpu_set);
+    }
+#endif
+  }
+};
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->sleep_mutex_);
+    this->stopping_ = true;
+  }
+  this->wake_.notify_all();
+
+  // Workers finish the queued tasks before they exit
+  for (const std::unique_ptr<Worker>& worker : this->workers_)
+  {
+    worker->thread.join();
+  }
+};
+
+// Number of workers of the global pool, all hardware threads by default
+static int globalNumThreads()
+{
+  const char* num_threads = std::getenv("ME5413_NUM_THREADS");
+  return num_threads? std::atoi(num_threads) : 0;
+}
+
+// CPUs the workers of the global pool are pinned to, none by default
+static std::vector<int> globalCpus()
+{
+  std::vector<int> cpus;
+  const char* cpu_affinity = std::getenv("ME5413_CPU_AFFINITY");
+  if (cpu_affinity != nullptr)
+  {
+    std::istringstream cpu_list(cpu_affinity);
+    std::string cpu;
+    while (std::getline(cpu_list, cpu, ','))
+    {
+      cpus.push_back(std::atoi(cpu.c_str()));
+    }
+  }
+
+  return cpus;
+}
+
+ThreadPool& ThreadPool::global()
+{
+  static ThreadPool pool(globalNumThreads(), globalCpus());
+  return pool;
+};
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  // Workers keep their own tasks for locality, outside threads spread them round-robin
+  const int id = workerId();
+  const int queue = (id >= 0)? id : int(this->next_queue_++ % this->workers_.size());
+  {
+    std::lock_guard<std::mutex> lock(this->workers_[queue]->mutex);
+    this->workers_[queue]->tasks.push_back(std::move(task));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->sleep_mutex_);
+    this->num_pending_++;
+  }
+  this->wake_.notify_one();
+};
+
+void ThreadPool::parallelFor(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body)
+{
+  if (end <= begin)
+  {
+    return;
+  }
+
+  const int grain = std::max(grain_size, 1);
+  const int num_chunks = (end - begin + grain - 1) / grain;
+  if (num_chunks == 1)
+  {
+    body(begin, end);
+    return;
+  }
+
+  // The chunks only reference this frame, which outlives them since we wait for all of them
+  std::atomic<int> num_remaining(num_chunks);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  const auto run_chunk = [&](const int chunk_begin)
+  {
+    try
+    {
+      body(chunk_begin, std::min(chunk_begin + grain, end));
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+    num_remaining--;
+  };
+
+  for (int chunk = 1; chunk < num_chunks; chunk++)
+  {
+    const int chunk_begin = begin + chunk * grain;
+    submit([&run_chunk, chunk_begin]() { run_chunk(chunk_begin); });
+  }
+  run_chunk(begin);
+
+  // Help with whatever is queued until our chunks are done
+  while (num_remaining > 0)
+  {
+    if (!runPendingTask())
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+};
+
+bool ThreadPool::runPendingTask()
+{
+  const int id = workerId();
+  std::function<void()> task;
+  bool stolen = false;
+  if (!popTask(id, task, stolen))
+  {
+    return false;
+  }
+
+  execute(id, task, stolen);
+  return true;
+};
+
+std::vector<WorkerStats> ThreadPool::stats() const
+{
+  std::vector<WorkerStats> stats;
+  for (const std::unique_ptr<Worker>& worker : this->workers_)
+  {
+    WorkerStats worker_stats;
+    worker_stats.num_tasks = worker->num_tasks;
+    worker_stats.num_steals = worker->num_steals;
+    worker_stats.busy_time = worker->busy_ns * 1e-9;
+    stats.push_back(worker_stats);
+  }
+
+  return stats;
+};
+
+void ThreadPool::resetStats()
+{
+  for (const std::unique_ptr<Worker>& worker : this->workers_)
+  {
+    worker->num_tasks = 0;
+    worker->num_steals = 0;
+    worker->busy_ns = 0;
+  }
+};
+
+void ThreadPool::workerLoop(const int id)
+{
+  worker_pool = this;
+  worker_id = id;
+
+  while (true)
+  {
+    std::function<void()> task;
+    bool stolen = false;
+    if (popTask(id, task, stolen))
+    {
+      execute(id, task, stolen);
+      continue;
+    }
+
+    // Sleep until something is queued, a task taken by another worker in between only costs one more loop
+    std::unique_lock<std::mutex> lock(this->sleep_mutex_);
+    this->wake_.wait(lock, [this]() { return this->stopping_ || this->num_pending_ > 0; });
+    if (this->stopping_ && this->num_pending_ == 0)
+    {
+      return;
+    }
+  }
+};
+
+bool ThreadPool::popTask(const int id, std::function<void()>& task, bool& stolen)
+{
+  const int num_workers = this->workers_.size();
+
+  if (id >= 0)
+  {
+    Worker& worker = *this->workers_[id];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty())
+    {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+      this->num_pending_--;
+      stolen = false;
+      return true;
+    }
+  }
+
+  for (int i = 1; i <= num_workers; i++)
+  {
+    const int victim = (std::max(id, 0) + i) % num_workers;
+    if (victim == id)
+    {
+      continue;
+    }
+
+    Worker& worker = *this->workers_[victim];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty())
+    {
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+      this->num_pending_--;
+      stolen = true;
+      return true;
+    }
+  }
+
+  return false;
+};
+
+void ThreadPool::execute(const int id, std::function<void()>& task, const bool stolen)
+{
+  // Only the workers keep statistics, outside threads helping in parallelFor do not
+  if (id < 0)
+  {
+    task();
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  task();
+  const auto end = std::chrono::steady_clock::now();
+
+  Worker& worker = *this->workers_[id];
+  worker.num_tasks++;
+  worker.num_steals += stolen;
+  worker.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+};
+
+int ThreadPool::workerId() const
+{
+  return (worker_pool == this)? worker_id : -1;
+};
+
+int TaskGraph::addTask(std::function<void()> task)
+{
+  this->tasks_.push_back(std::move(task));
+  this->successors_.push_back(std::vector<int>());
+  this->num_dependencies_.push_back(0);
+
+  return this->tasks_.size() - 1;
+};
+
+void TaskGraph::addDependency(const int before, const int after)
+{
+  this->successors_[before].push_back(after);
+  this->num_dependencies_[after]++;
+};
+
+bool TaskGraph::run(ThreadPool& pool)
+{
+  const int num_tasks = this->tasks_.size();
+  if (num_tasks == 0)
+  {
+    return true;
+  }
+
+  // Check for cycles first (Kahn's algorithm), a cycle would never finish
+  std::vector<int> num_waiting = this->num_dependencies_;
+  std::vector<int> ready;
+  for (int i = 0; i < num_tasks; i++)
+  {
+    if (num_waiting[i] == 0)
+    {
+      ready.push_back(i);
+    }
+  }
+  const std::vector<int> roots = ready;
+  int num_sorted = 0;
+  while (!ready.empty())
+  {
+    const int id = ready.back();
+    ready.pop_back();
+    num_sorted++;
+    for (const int successor : this->successors_[id])
+    {
+      if (--num_waiting[successor] == 0)
+      {
+        ready.push_back(successor);
+      }
+    }
+  }
+  if (num_sorted != num_tasks)
+  {
+    return false;
+  }
+
+  std::unique_ptr<std::atomic<int>[]> num_pending(new std::atomic<int>[num_tasks]);
+  for (int i = 0; i < num_tasks; i++)
+  {
+    num_pending[i] = this->num_dependencies_[i];
+  }
+  std::atomic<int> num_remaining(num_tasks);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  // Each finished task queues the successors it was the last dependency of
+  std::function<void(int)> schedule;
+  schedule = [&](const int id)
+  {
+    pool.submit([&, id]()
+    {
+      try
+      {
+        this->tasks_[id]();
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+      for (const int successor : this->successors_[id])
+      {
+        if (--num_pending[successor] == 0)
+        {
+          schedule(successor);
+        }
+      }
+      num_remaining--;
+    });
+  };
+  for (const int id : roots)
+  {
+    schedule(id);
+  }
+
+  while (num_remaining > 0)
+  {
+    if (!pool.runPendingTask())
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+  return true;
+};
+
+} // namespace me5413_world
@@ -0,0 +1,24 @@
+/** tracking_pipeline.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Explicit instantiations of the tracking pipelines used by the plugin and the benchmarks
+ */
+
+#include "me5413_world/tracking_pipeline.hpp"
+
+namespace me5413_world
+{
+
+template class TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, SpeedScaledLookahead<double>,
+                                PurePursuitSteering<double>, PIDSpeedController<double>>;
+template class TrackingPipeline<double, LemniscatePath<double>, ForwardSearchProjector<double>, FixedLookahead<double>,
+                                HeadingSteering<double>, PIDSpeedController<double>>;
+template class TrackingPipeline<float, LemniscatePath<float>, ForwardSearchProjector<float>, SpeedScaledLookahead<float>,
+                                PurePursuitSteering<float>, PIDSpeedController<float>>;
+template class TrackingPipeline<Q16_16, LemniscatePath<Q16_16>, ForwardSearchProjector<Q16_16>, SpeedScaledLookahead<Q16_16>,
+                                PurePursuitSteering<Q16_16>, PIDSpeedController<Q16_16>>;
+
+} // namespace me5413_world
@@ -0,0 +1,390 @@
+/** transport_benchmark.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Implementation of the transport benchmark, shared by its node and its nodelet
+ */
+
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+
+#include "me5413_world/transport_benchmark.hpp"
+#include "me5413_world/tracking_utils.hpp"
+
+namespace me5413_world
+{
+
+double processCpuTime()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+};
+
+// Value at quantile q of sorted values
+static double quantile(const std::vector<double>& sorted, const double q)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  return sorted[std::min(sorted.size() - 1, size_t(q * sorted.size()))];
+}
+
+TransportReceiver::TransportReceiver(ros::NodeHandle& nh, const std::string& name, const int warmup_messages, const bool subscribe) :
+  name_(name),
+  warmup_messages_(warmup_messages)
+{
+  if (subscribe)
+  {
+    // Deep enough queues to count late messages instead of dropping them
+    this->sub_path_ = nh.subscribe("transport_benchmark/path", 100, &TransportReceiver::pathCallback, this);
+    this->sub_odom_ = nh.subscribe("transport_benchmark/odometry", 100, &TransportReceiver::odomCallback, this);
+  }
+};
+
+void TransportReceiver::pathCallback(const nav_msgs::Path::ConstPtr& path)
+{
+  handle(path->header, path->poses.size());
+};
+
+void TransportReceiver::odomCallback(const nav_msgs::Odometry::ConstPtr& odom)
+{
+  handle(odom->header, 1);
+};
+
+void TransportReceiver::handle(const std_msgs::Header& header, const int num_poses)
+{
+  const ros::WallTime now = ros::WallTime::now();
+  const double latency = (now - ros::WallTime(header.stamp.sec, header.stamp.nsec)).toSec();
+
+  // The case and the index of the message within it are carried in the frame id
+  int case_id, index;
+  if (std::sscanf(header.frame_id.c_str(), "%d/%d", &case_id, &index) != 2 || index < this->warmup_messages_)
+  {
+    return;
+  }
+
+  if (this->cases_.empty() || this->cases_.back().case_id != case_id)
+  {
+    CaseStats stats;
+    stats.case_id = case_id;
+    stats.num_poses = num_poses;
+    stats.count = 0;
+    stats.cpu_first = processCpuTime();
+    stats.time_first = now.toSec();
+    this->cases_.push_back(stats);
+  }
+
+  CaseStats& stats = this->cases_.back();
+  stats.count++;
+  stats.latencies.push_back(latency);
+  stats.cpu_last = processCpuTime();
+  stats.time_last = now.toSec();
+};
+
+std::string TransportReceiver::toJson() const
+{
+  std::ostringstream json;
+  json << "{\"name\": \"" << this->name_ << "\", \"cases\": [";
+  for (int i = 0; i < int(this->cases_.size()); i++)
+  {
+    const CaseStats& stats = this->cases_[i];
+    std::vector<double> sorted = stats.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (const double latency : sorted)
+    {
+      mean += latency / sorted.size();
+    }
+    // Intervals between the first and the last message
+    const double num_intervals = std::max<double>(1.0, stats.count - 1);
+
+    json << (i > 0? ", " : "") << "{\"id\": " << stats.case_id
+         << ", \"num_poses\": " << stats.num_poses
+         << ", \"received\": " << stats.count
+         << ", \"rate\": " << num_intervals / std::max(1e-9, stats.time_last - stats.time_first)
+         << ", \"latency_us\": {\"mean\": " << 1e6 * mean
+         << ", \"p50\": " << 1e6 * quantile(sorted, 0.5)
+         << ", \"p90\": " << 1e6 * quantile(sorted, 0.9)
+         << ", \"p99\": " << 1e6 * quantile(sorted, 0.99)
+         << ", \"max\": " << 1e6 * (sorted.empty()? 0.0 : sorted.back())
+         << "}, \"process_cpu_per_message_us\": " << 1e6 * (stats.cpu_last - stats.cpu_first) / num_intervals << "}";
+  }
+  json << "]}";
+
+  return json.str();
+};
+
+TransportBenchmark::TransportBenchmark(ros::NodeHandle& nh, ros::NodeHandle& nh_private) :
+  nh_(nh),
+  case_id_(-1),
+  case_start_(0.0),
+  case_cpu_start_(0.0),
+  index_(0),
+  finished_(false)
+{
+  nh_private.param<std::string>("layout", this->layout_, "processes");
+  nh_private.param<std::string>("role", this->role_, "sender");
+  nh_private.param<std::string>("output_dir", this->output_dir_, "/tmp");
+  nh_private.param<int>("num_subscribers", this->num_subscribers_, 1);
+  nh_private.param<double>("case_duration", this->case_duration_, 5.0);
+  const int warmup_messages = nh_private.param<int>("warmup_messages", 5);
+  std::vector<int> path_sizes;
+  std::vector<double> rates;
+  nh_private.param<std::vector<int>>("path_sizes", path_sizes, {500, 2000, 5000, 20000});
+  nh_private.param<std::vector<double>>("rates", rates, {10.0, 50.0});
+
+  // One results file per node or nodelet
+  this->name_ = nh_private.getNamespace();
+  std::replace(this->name_.begin(), this->name_.end(), '/', '_');
+
+  if (this->role_ == "receiver")
+  {
+    this->receivers_.emplace_back(new TransportReceiver(this->nh_, this->name_, warmup_messages, true));
+    this->sub_done_ = this->nh_.subscribe("transport_benchmark/done", 1, &TransportBenchmark::doneCallback, this);
+    return;
+  }
+
+  // Odometry first, then the paths from the smallest
+  std::sort(path_sizes.begin(), path_sizes.end());
+  for (const double rate : rates)
+  {
+    TransportCase odom_case = {"odometry", 1, rate, 0};
+    this->cases_.push_back(odom_case);
+    for (const int num_poses : path_sizes)
+    {
+      TransportCase path_case = {"path", num_poses, rate, 0};
+      this->cases_.push_back(path_case);
+    }
+  }
+  this->num_sent_.assign(this->cases_.size(), 0);
+  this->send_cpu_.assign(this->cases_.size(), 0.0);
+  this->send_time_.assign(this->cases_.size(), 0.0);
+
+  if (this->role_ == "direct")
+  {
+    // Receivers in the same object, called without any ROS transport
+    for (int i = 0; i < this->num_subscribers_; i++)
+    {
+      this->receivers_.emplace_back(new TransportReceiver(this->nh_, "direct_" + std::to_string(i), warmup_messages, false));
+    }
+  }
+  else
+  {
+    this->pub_path_ = this->nh_.advertise<nav_msgs::Path>("transport_benchmark/path", 100);
+    this->pub_odom_ = this->nh_.advertise<nav_msgs::Odometry>("transport_benchmark/odometry", 100);
+    this->pub_done_ = this->nh_.advertise<std_msgs::Empty>("transport_benchmark/done", 1, true);
+  }
+
+  // Poll for the subscribers until the sweep starts
+  this->timer_ = this->nh_.createWallTimer(ros::WallDuration(0.1), &TransportBenchmark::timerCallback, this);
+};
+
+bool TransportBenchmark::subscribersReady() const
+{
+  if (this->role_ == "direct")
+  {
+    return true;
+  }
+  return int(this->pub_path_.getNumSubscribers()) >= this->num_subscribers_ &&
+         int(this->pub_odom_.getNumSubscribers()) >= this->num_subscribers_;
+};
+
+void TransportBenchmark::timerCallback(const ros::WallTimerEvent&)
+{
+  if (this->finished_)
+  {
+    return;
+  }
+  if (this->case_id_ < 0)
+  {
+    if (subscribersReady())
+    {
+      startCase(0);
+    }
+    return;
+  }
+
+  if (ros::WallTime::now().toSec() - this->case_start_ < this->case_duration_)
+  {
+    send();
+    return;
+  }
+
+  this->send_cpu_[this->case_id_] = processCpuTime() - this->case_cpu_start_;
+  if (this->case_id_ + 1 < int(this->cases_.size()))
+  {
+    startCase(this->case_id_ + 1);
+  }
+  else
+  {
+    finish();
+  }
+};
+
+void TransportBenchmark::startCase(const int case_id)
+{
+  TransportCase& transport_case = this->cases_[case_id];
+  if (transport_case.type == "path")
+  {
+    // The track of the publisher, resampled to the size of the case
+    this->path_template_ = nav_msgs::Path();
+    tf2::Quaternion q;
+    for (const Pose2D& wp : createLemniscatePath(10.0, 10.0, 1.0 / transport_case.num_poses))
+    {
+      geometry_msgs::PoseStamped pose;
+      pose.header.frame_id = "world";
+      pose.pose.position.x = wp.x;
+      pose.pose.position.y = wp.y;
+      q.setRPY(0.0, 0.0, wp.yaw);
+      pose.pose.orientation = tf2::toMsg(q);
+      this->path_template_.poses.push_back(pose);
+    }
+    this->path_template_.poses.resize(transport_case.num_poses);
+    this->path_template_.header.frame_id = "0000/000000";
+    transport_case.bytes = ros::serialization::serializationLength(this->path_template_);
+  }
+  else
+  {
+    this->odom_template_ = nav_msgs::Odometry();
+    this->odom_template_.header.frame_id = "0000/000000";
+    this->odom_template_.child_frame_id = "base_link";
+    this->odom_template_.pose.pose.orientation.w = 1.0;
+    transport_case.bytes = ros::serialization::serializationLength(this->odom_template_);
+  }
+
+  ROS_INFO("Transport benchmark case %d: %s, %d poses (%d bytes) at %.0fHz",
+           case_id, transport_case.type.c_str(), transport_case.num_poses, transport_case.bytes, transport_case.rate);
+  this->case_id_ = case_id;
+  this->index_ = 0;
+  this->case_start_ = ros::WallTime::now().toSec();
+  this->case_cpu_start_ = processCpuTime();
+  this->timer_.setPeriod(ros::WallDuration(1.0 / transport_case.rate));
+};
+
+void TransportBenchmark::send()
+{
+  const TransportCase& transport_case = this->cases_[this->case_id_];
+  const std::string frame_id = std::to_string(this->case_id_) + "/" + std::to_string(this->index_++);
+  const ros::WallTime time_start = ros::WallTime::now();
+
+  // A fresh message every time, subscribers in the same process keep a pointer to it
+  if (transport_case.type == "path")
+  {
+    nav_msgs::PathPtr path(new nav_msgs::Path(this->path_template_));
+    path->header.frame_id = frame_id;
+    const ros::WallTime now = ros::WallTime::now();
+    path->header.stamp = ros::Time(now.sec, now.nsec);
+    if (this->role_ == "direct")
+    {
+      for (std::unique_ptr<TransportReceiver>& receiver : this->receivers_)
+      {
+        receiver->pathCallback(path);
+      }
+    }
+    else
+    {
+      this->pub_path_.publish(path);
+    }
+  }
+  else
+  {
+    nav_msgs::OdometryPtr odom(new nav_msgs::Odometry(this->odom_template_));
+    odom->header.frame_id = frame_id;
+    const ros::WallTime now = ros::WallTime::now();
+    odom->header.stamp = ros::Time(now.sec, now.nsec);
+    if (this->role_ == "direct")
+    {
+      for (std::unique_ptr<TransportReceiver>& receiver : this->receivers_)
+      {
+        receiver->odomCallback(odom);
+      }
+    }
+    else
+    {
+      this->pub_odom_.publish(odom);
+    }
+  }
+
+  this->send_time_[this->case_id_] += (ros::WallTime::now() - time_start).toSec();
+  this->num_sent_[this->case_id_]++;
+};
+
+void TransportBenchmark::finish()
+{
+  this->finished_ = true;
+  this->timer_.stop();
+
+  if (this->role_ == "direct")
+  {
+    std::ostringstream receivers;
+    for (int i = 0; i < int(this->receivers_.size()); i++)
+    {
+      receivers << (i > 0? ", " : "") << this->receivers_[i]->toJson();
+    }
+    writeResults("direct", "\"sender\": " + senderJson() + ", \"receivers\": [" + receivers.str() + "]");
+  }
+  else
+  {
+    this->pub_done_.publish(std_msgs::Empty());
+    writeResults("sender", "\"sender\": " + senderJson());
+  }
+
+  // Leave the receivers time to write their results
+  this->timer_ = this->nh_.createWallTimer(ros::WallDuration(2.0), [](const ros::WallTimerEvent&) { ros::requestShutdown(); }, true);
+};
+
+void TransportBenchmark::doneCallback(const std_msgs::Empty::ConstPtr&)
+{
+  writeResults("receiver", "\"receivers\": [" + this->receivers_.front()->toJson() + "]");
+};
+
+std::string TransportBenchmark::senderJson() const
+{
+  std::ostringstream json;
+  json << "{\"cases\": [";
+  for (int i = 0; i < int(this->cases_.size()); i++)
+  {
+    const TransportCase& transport_case = this->cases_[i];
+    const double num_sent = std::max<double>(1.0, this->num_sent_[i]);
+    json << (i > 0? ", " : "") << "{\"id\": " << i
+         << ", \"type\": \"" << transport_case.type << "\""
+         << ", \"num_poses\": " << transport_case.num_poses
+         << ", \"bytes\": " << transport_case.bytes
+         << ", \"rate\": " << transport_case.rate
+         << ", \"sent\": " << this->num_sent_[i]
+         << ", \"send_time_per_message_us\": " << 1e6 * this->send_time_[i] / num_sent
+         << ", \"process_cpu_per_message_us\": " << 1e6 * this->send_cpu_[i] / num_sent << "}";
+  }
+  json << "]}";
+
+  return json.str();
+};
+
+void TransportBenchmark::writeResults(const std::string& role, const std::string& json) const
+{
+  const std::string file = this->output_dir_ + "/transport_" + this->layout_ + this->name_ + ".json";
+
+  std::ofstream output(file);
+  output << "{\"layout\": \"" << this->layout_ << "\", \"role\": \"" << role << "\", \"num_subscribers\": "
+         << this->num_subscribers_ << ", " << json << "}\n";
+  if (output)
+  {
+    ROS_INFO("Transport benchmark results written to %s", file.c_str());
+  }
+  else
+  {
+    ROS_WARN("Failed to write the transport benchmark results to %s", file.c_str());
+  }
+};
+
+} // namespace me5413_world
@@ -0,0 +1,20 @@
+/** transport_benchmark_node.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Transport benchmark as a standalone node, for the "processes" and "direct" layouts
+ */
+
+#include "me5413_world/transport_benchmark.hpp"
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "transport_benchmark_node");
+  ros::NodeHandle nh;
+  ros::NodeHandle nh_private("~");
+  me5413_world::TransportBenchmark transport_benchmark(nh, nh_private);
+  ros::spin();  // spin the ros node.
+  return 0;
+}
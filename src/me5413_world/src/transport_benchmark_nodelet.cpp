@@ -0,0 +1,33 @@
+/** transport_benchmark_nodelet.cpp
+ *
+ * Copyright (C) 2024 Shuo SUN & Advanced Robotics Center, National University of Singapore
+ *
+ * MIT License
+ *
+ * Transport benchmark as a nodelet, for the "nodelets" layout where messages are passed by pointer
+ */
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "me5413_world/transport_benchmark.hpp"
+
+namespace me5413_world
+{
+
+class TransportBenchmarkNodelet : public nodelet::Nodelet
+{
+ private:
+  void onInit() override
+  {
+    this->transport_benchmark_.reset(new TransportBenchmark(getNodeHandle(), getPrivateNodeHandle()));
+  };
+
+  std::unique_ptr<TransportBenchmark> transport_benchmark_;
+};
+
+} // namespace me5413_world
+
+PLUGINLIB_EXPORT_CLASS(me5413_world::TransportBenchmarkNodelet, nodelet::Nodelet)